@@ -1,4 +1,5 @@
 QT -= gui
+QT += concurrent
 
 TEMPLATE = lib
 
@@ -7,8 +8,27 @@ CONFIG += staticlib
 
 HEADERS += \
     include/QAead.h \
+    include/QBatchRunner.h \
     include/QBlockCipher.h \
+    include/QCipherTuner.h \
+    include/QCmac.h \
+    include/QCryptoPipeline.h \
+    include/QCtrKeystream.h \
+    include/QEcc.h \
+    include/QEncryptedLog.h \
+    include/QEncryptedStore.h \
+    include/QEnvelope.h \
+    include/QFileSync.h \
+    include/QGcm.h \
+    include/QKeyCache.h \
+    include/QKeyedAesSiv.h \
+    include/QKeyedBlockCipher.h \
+    include/QPageCodec.h \
+    include/QPasswordHasher.h \
+    include/QRandomPool.h \
     include/QRsa.h \
+    include/QRsaKey.h \
+    include/QRsaKeyPool.h \
     include/QSimpleCrypto_global.h \
     include/QX509.h \
     include/QX509Store.h
@@ -16,7 +36,23 @@ HEADERS += \
 SOURCES += \
     sources/QAead.cpp \
     sources/QBlockCipher.cpp \
+    sources/QCipherTuner.cpp \
+    sources/QCmac.cpp \
+    sources/QCryptoPipeline.cpp \
+    sources/QCtrKeystream.cpp \
+    sources/QEcc.cpp \
+    sources/QEncryptedLog.cpp \
+    sources/QEncryptedStore.cpp \
+    sources/QEnvelope.cpp \
+    sources/QKeyCache.cpp \
+    sources/QKeyedAesSiv.cpp \
+    sources/QKeyedBlockCipher.cpp \
+    sources/QPageCodec.cpp \
+    sources/QPasswordHasher.cpp \
+    sources/QRandomPool.cpp \
     sources/QRsa.cpp \
+    sources/QRsaKey.cpp \
+    sources/QRsaKeyPool.cpp \
     sources/QX509.cpp \
     sources/QX509Store.cpp
 
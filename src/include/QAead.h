@@ -11,8 +11,11 @@
 
 #include "QSimpleCrypto_global.h"
 
+#include <QFile>
 #include <QObject>
+#include <QVector>
 
+#include <limits>
 #include <memory>
 
 #include <openssl/aes.h>
@@ -20,11 +23,35 @@
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 
+#include "QBatchRunner.h"
+#include "QFileSync.h"
+#include "QGcm.h"
+#include "QKeyedAesSiv.h"
+#include "QRandomPool.h"
+
 namespace QSimpleCrypto {
 class QSIMPLECRYPTO_EXPORT QAead {
+
+///
+/// \brief aeadBatchNonceLength - Nonce length used by batch functions.
+///
+#define aeadBatchNonceLength 12
+
+///
+/// \brief aeadBatchTagLength - Tag length used by batch functions.
+///
+#define aeadBatchTagLength 16
+
 public:
     QAead();
 
+    ///
+    /// \brief generateNonce - Function generates random nonce (initialization vector) for AEAD ciphers.
+    /// \param size - Nonce size in bytes. Example: 12 for GCM.
+    /// \return Returns nonce (random bytes).
+    ///
+    [[nodiscard]] static QByteArray generateNonce(const quint16& size = 12);
+
     ///
     /// \brief encryptAesGcm - Function encrypts data with AES GCM algorithm.
     /// \param data - Data that will be encrypted.
@@ -72,6 +99,126 @@ public:
     /// \return Returns decrypted data on success or "" on failure.
     ///
     [[nodiscard]] QByteArray decryptAesCcm(const QByteArray& data, const QByteArray& key, const QByteArray& iv, const QByteArray& tag, const QByteArray& aad = "", const EVP_CIPHER* cipher = EVP_aes_256_ccm());
+
+    ///
+    /// \brief encryptFileAesGcm - Function encrypts file with AES GCM algorithm and writes result to another file.
+    /// \param inputFilePath - Path to file that will be encrypted.
+    /// \param outputFilePath - Path to file where encrypted data will be saved. File will be overwritten.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGG"
+    /// \param tag - Authorization tag. Tag length is taken from its size and computed tag is written into it. Example: QByteArray(16, 0).
+    /// \param aad - Additional authenticated data.
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+    /// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+    /// \details Files are memory mapped and processed by windows, so memory usage doesn't depend on file size.
+    /// \return Returns 'true' on success. Output file is left untouched on failure.
+    ///
+    bool encryptFileAesGcm(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv, QByteArray& tag,
+        const QByteArray& aad = "", const EVP_CIPHER* cipher = EVP_aes_256_gcm(), const qint64 windowSize = fileMapWindowSize);
+
+    ///
+    /// \brief decryptFileAesGcm - Function decrypts file with AES GCM algorithm and writes result to another file.
+    /// \param inputFilePath - Path to file that will be decrypted.
+    /// \param outputFilePath - Path to file where decrypted data will be saved. File is replaced only after tag is verified.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGG"
+    /// \param tag - Authorization tag received from encryptFileAesGcm.
+    /// \param aad - Additional authenticated data.
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+    /// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+    /// \details Files are memory mapped and processed by windows, so memory usage doesn't depend on file size.
+    /// \return Returns 'true' on success. Output file is left untouched on failure, including tag mismatch.
+    ///
+    bool decryptFileAesGcm(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv, const QByteArray& tag,
+        const QByteArray& aad = "", const EVP_CIPHER* cipher = EVP_aes_256_gcm(), const qint64 windowSize = fileMapWindowSize);
+
+    ///
+    /// \brief encryptAesGcmBatch - Function encrypts column of values with AES GCM algorithm.
+    /// \param values - Arena with all values stored one after another.
+    /// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+    /// \param resultOffsets - Offsets of encrypted values in returned arena, in the same format.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param aad - Additional authenticated data, shared by all values. Example: column name.
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \details Every encrypted value is random 12 bytes nonce, cipher text and 16 bytes tag. Output arena is allocated once and key schedule is initialized once per thread.
+    /// \return Returns arena with encrypted values.
+    ///
+    [[nodiscard]] QByteArray encryptAesGcmBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& key, const QByteArray& aad = "", const EVP_CIPHER* cipher = EVP_aes_256_gcm(), const qint32 threadCount = 1);
+
+    ///
+    /// \brief decryptAesGcmBatch - Function decrypts column of values encrypted with encryptAesGcmBatch.
+    /// \param values - Arena with all encrypted values stored one after another.
+    /// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+    /// \param resultOffsets - Offsets of decrypted values in returned arena, in the same format.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param aad - Additional authenticated data, shared by all values. Example: column name.
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \return Returns arena with decrypted values. Throws, if any tag doesn't match.
+    ///
+    [[nodiscard]] QByteArray decryptAesGcmBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& key, const QByteArray& aad = "", const EVP_CIPHER* cipher = EVP_aes_256_gcm(), const qint32 threadCount = 1);
+
+    ///
+    /// \brief encryptAesSiv - Function encrypts data with deterministic AES-SIV algorithm (RFC 5297).
+    /// \param data - Data that will be encrypted.
+    /// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+    /// \param aad - Additional authenticated data. Example: column name.
+    /// \details Same data, key and aad always give the same result, so encrypted values can be indexed and compared for equality.
+    ///          Use QKeyedAesSiv directly to reuse expanded key between calls.
+    /// \return Returns 16 bytes synthetic IV followed by cipher text.
+    ///
+    [[nodiscard]] QByteArray encryptAesSiv(const QByteArray& data, const QByteArray& key, const QByteArray& aad = "");
+
+    ///
+    /// \brief decryptAesSiv - Function decrypts data encrypted with AES-SIV algorithm (RFC 5297).
+    /// \param data - Synthetic IV followed by cipher text.
+    /// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+    /// \param aad - Additional authenticated data. Example: column name.
+    /// \return Returns decrypted data. Throws, if authentication fails.
+    ///
+    [[nodiscard]] QByteArray decryptAesSiv(const QByteArray& data, const QByteArray& key, const QByteArray& aad = "");
+
+    ///
+    /// \brief encryptAesSivBatch - Function encrypts column of values with deterministic AES-SIV algorithm.
+    /// \param values - Arena with all values stored one after another.
+    /// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+    /// \param resultOffsets - Offsets of encrypted values in returned arena, in the same format.
+    /// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+    /// \param aad - Additional authenticated data, shared by all values. Example: column name.
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \details Every encrypted value is synthetic IV followed by cipher text. Output arena is allocated once and key is expanded once.
+    /// \return Returns arena with encrypted values.
+    ///
+    [[nodiscard]] QByteArray encryptAesSivBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& key, const QByteArray& aad = "", const qint32 threadCount = 1);
+
+    ///
+    /// \brief decryptAesSivBatch - Function decrypts column of values encrypted with encryptAesSivBatch.
+    /// \param values - Arena with all encrypted values stored one after another.
+    /// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+    /// \param resultOffsets - Offsets of decrypted values in returned arena, in the same format.
+    /// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+    /// \param aad - Additional authenticated data, shared by all values. Example: column name.
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \return Returns arena with decrypted values. Throws, if any value fails authentication.
+    ///
+    [[nodiscard]] QByteArray decryptAesSivBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& key, const QByteArray& aad = "", const qint32 threadCount = 1);
+
+private:
+    ///
+    /// \brief transformFile - Function runs initialized GCM context over memory mapped windows of input file.
+    /// \param context - Initialized OpenSSL EVP_CIPHER_CTX with iv and aad already provided.
+    /// \param inputFilePath - Path to source file.
+    /// \param outputFilePath - Path to destination file. Result is written to "<outputFilePath>.part" and renamed over destination on success.
+    /// \param tag - Tag that is written (encryption) or checked (decryption) before finalization.
+    /// \param windowSize - Size of memory mapped window.
+    /// \return Returns 'true' on success.
+    ///
+    bool transformFile(EVP_CIPHER_CTX* context, const QByteArray& inputFilePath, const QByteArray& outputFilePath, QByteArray& tag, const qint64 windowSize);
 };
 } // namespace QSimpleCrypto
 
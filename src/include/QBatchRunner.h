@@ -0,0 +1,86 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QBATCHRUNNER_H
+#define QBATCHRUNNER_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+
+#include <exception>
+
+namespace QSimpleCrypto {
+class QSIMPLECRYPTO_EXPORT QBatchRunner {
+
+///
+/// \brief batchMinItemsPerThread - Minimal number of batch items that is worth to give to separate thread.
+///
+#define batchMinItemsPerThread 64
+
+public:
+    ///
+    /// \brief threadCount - Function calculates number of threads for batch.
+    /// \param requested - Requested thread count. '0' means QThread::idealThreadCount().
+    /// \param items - Number of items in batch.
+    /// \param minItemsPerThread - Minimal number of items for one thread.
+    /// \return Returns number of threads, at least one.
+    ///
+    static qint32 threadCount(const qint32 requested, const qint64 items, const qint64 minItemsPerThread = batchMinItemsPerThread)
+    {
+        const qint64 threads = requested > 0 ? requested : QThread::idealThreadCount();
+        return static_cast<qint32>(qBound<qint64>(1, qMin(threads, items / qMax<qint64>(1, minItemsPerThread)), 1024));
+    }
+
+    ///
+    /// \brief run - Function splits items to contiguous ranges and runs function for every range.
+    /// \param items - Number of items in batch.
+    /// \param threads - Number of ranges. Ranges are processed on Qt global thread pool, when there are more than one.
+    /// \param function - Function that accepts range of items '(qint64 begin, qint64 end)'.
+    /// \details First exception thrown by function is rethrown to caller after all ranges are finished.
+    ///
+    template <typename Function>
+    static void run(const qint64 items, const qint32 threads, Function function)
+    {
+        if (threads <= 1 || items <= 1) {
+            function(0, items);
+            return;
+        }
+
+        QVector<QPair<qint64, qint64>> ranges;
+        const qint64 step = (items + threads - 1) / threads;
+        for (qint64 begin = 0; begin < items; begin += step) {
+            ranges.append(qMakePair(begin, qMin(items, begin + step)));
+        }
+
+        /* QtConcurrent wraps unknown exceptions, so first one is stored and rethrown as is */
+        QMutex exceptionMutex;
+        std::exception_ptr exception;
+
+        QtConcurrent::blockingMap(ranges, [&](const QPair<qint64, qint64>& range) {
+            try {
+                function(range.first, range.second);
+            } catch (...) {
+                QMutexLocker locker(&exceptionMutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+        });
+
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+} // namespace QSimpleCrypto
+
+#endif // QBATCHRUNNER_H
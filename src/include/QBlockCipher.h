@@ -11,8 +11,12 @@
 
 #include "QSimpleCrypto_global.h"
 
+#include <QFile>
+#include <QFileInfo>
 #include <QObject>
+#include <QVector>
 
+#include <limits>
 #include <memory>
 
 #include <openssl/aes.h>
@@ -20,6 +24,11 @@
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 
+#include "QBatchRunner.h"
+#include "QFileSync.h"
+#include "QKeyedBlockCipher.h"
+#include "QRandomPool.h"
+
 namespace QSimpleCrypto {
 class QSIMPLECRYPTO_EXPORT QBlockCipher {
 
@@ -27,6 +36,21 @@ class QSIMPLECRYPTO_EXPORT QBlockCipher {
 #define aes192Rounds 12
 #define aes256Rounds 14
 
+///
+/// \brief scryptCost - Default scrypt CPU/memory cost parameter N. With scryptBlockSize it takes 32 MiB per derivation.
+///
+#define scryptCost 32768
+
+///
+/// \brief scryptBlockSize - Default scrypt block size parameter r.
+///
+#define scryptBlockSize 8
+
+///
+/// \brief scryptParallelism - Default scrypt parallelization parameter p.
+///
+#define scryptParallelism 1
+
 public:
     QBlockCipher();
 
@@ -37,6 +61,20 @@ public:
     ///
     [[nodiscard]] static QByteArray generateSalt(const quint16& size = 16);
 
+    ///
+    /// \brief generateKey - Function generates random AES key.
+    /// \param size - Key size in bytes. Example: 16, 24, 32.
+    /// \return Returns key (random bytes).
+    ///
+    [[nodiscard]] static QByteArray generateKey(const quint16& size = 32);
+
+    ///
+    /// \brief generateIv - Function generates random initialization vector.
+    /// \param size - IV size in bytes. Example: 16.
+    /// \return Returns initialization vector (random bytes).
+    ///
+    [[nodiscard]] static QByteArray generateIv(const quint16& size = AES_BLOCK_SIZE);
+
     ///
     /// \brief encryptAesBlockCipher - Function encrypts data with Aes Block Cipher algorithm.
     /// \param data - Data that will be encrypted.
@@ -68,6 +106,196 @@ public:
     [[nodiscard]] QByteArray decryptAesBlockCipher(const QByteArray& data, const QByteArray& key, const QByteArray& iv = "",
         const QByteArray& password = "", const QByteArray& salt = "", const qint32 rounds = aes256Rounds,
         const EVP_CIPHER* cipher = EVP_aes_256_cbc(), const EVP_MD* md = EVP_sha512());
+
+    ///
+    /// \brief encryptFileAesBlockCipher - Function encrypts file with Aes Block Cipher algorithm and writes result to another file.
+    /// \param inputFilePath - Path to file that will be encrypted.
+    /// \param outputFilePath - Path to file where encrypted data will be saved. File will be overwritten.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+    /// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+    /// \details Key and iv are used as is, without password based derivation. Files are memory mapped and processed by windows, so memory usage doesn't depend on file size.
+    /// \return Returns 'true' on success. Output file is replaced only on success and left untouched on failure.
+    ///
+    bool encryptFileAesBlockCipher(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv = "",
+        const EVP_CIPHER* cipher = EVP_aes_256_cbc(), const qint64 windowSize = fileMapWindowSize);
+
+    ///
+    /// \brief decryptFileAesBlockCipher - Function decrypts file with Aes Block Cipher algorithm and writes result to another file.
+    /// \param inputFilePath - Path to file that will be decrypted.
+    /// \param outputFilePath - Path to file where decrypted data will be saved. File will be overwritten.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+    /// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+    /// \details Key and iv are used as is, without password based derivation. Files are memory mapped and processed by windows, so memory usage doesn't depend on file size.
+    /// \return Returns 'true' on success. Output file is replaced only on success and left untouched on failure.
+    ///
+    bool decryptFileAesBlockCipher(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv = "",
+        const EVP_CIPHER* cipher = EVP_aes_256_cbc(), const qint64 windowSize = fileMapWindowSize);
+
+    ///
+    /// \brief encryptAesBlockCipherInPlace - Function encrypts data with stream-like Aes Block Cipher mode in place.
+    /// \param data - Data that will be encrypted. Encrypted data replaces it and has the same size.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+    /// \details Key and iv are used as is, without password based derivation. No additional buffer is allocated.
+    /// \return Returns 'true' on success.
+    ///
+    bool encryptAesBlockCipherInPlace(QByteArray& data, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher = EVP_aes_256_ctr());
+
+    ///
+    /// \brief encryptAesBlockCipherInPlace - Function encrypts raw buffer with stream-like Aes Block Cipher mode in place.
+    /// \param data - Pointer to data that will be encrypted.
+    /// \param size - Size of data.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+    /// \return Returns 'true' on success.
+    ///
+    bool encryptAesBlockCipherInPlace(unsigned char* data, const qint64 size, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher = EVP_aes_256_ctr());
+
+    ///
+    /// \brief decryptAesBlockCipherInPlace - Function decrypts data with stream-like Aes Block Cipher mode in place.
+    /// \param data - Data that will be decrypted. Decrypted data replaces it and has the same size.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+    /// \details Key and iv are used as is, without password based derivation. No additional buffer is allocated.
+    /// \return Returns 'true' on success.
+    ///
+    bool decryptAesBlockCipherInPlace(QByteArray& data, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher = EVP_aes_256_ctr());
+
+    ///
+    /// \brief decryptAesBlockCipherInPlace - Function decrypts raw buffer with stream-like Aes Block Cipher mode in place.
+    /// \param data - Pointer to data that will be decrypted.
+    /// \param size - Size of data.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+    /// \return Returns 'true' on success.
+    ///
+    bool decryptAesBlockCipherInPlace(unsigned char* data, const qint64 size, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher = EVP_aes_256_ctr());
+
+    ///
+    /// \brief encryptAesBlockCipherBatch - Function encrypts column of values with Aes Block Cipher algorithm.
+    /// \param values - Arena with all values stored one after another.
+    /// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+    /// \param resultOffsets - Offsets of encrypted values in returned arena, in the same format.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \details Every encrypted value is random IV followed by cipher text. Output arena is allocated once and key schedule is initialized once per thread.
+    /// \return Returns arena with encrypted values.
+    ///
+    [[nodiscard]] QByteArray encryptAesBlockCipherBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& key, const EVP_CIPHER* cipher = EVP_aes_256_cbc(), const qint32 threadCount = 1);
+
+    ///
+    /// \brief decryptAesBlockCipherBatch - Function decrypts column of values encrypted with encryptAesBlockCipherBatch.
+    /// \param values - Arena with all encrypted values stored one after another.
+    /// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+    /// \param resultOffsets - Offsets of decrypted values in returned arena, in the same format.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \return Returns arena with decrypted values.
+    ///
+    [[nodiscard]] QByteArray decryptAesBlockCipherBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& key, const EVP_CIPHER* cipher = EVP_aes_256_cbc(), const qint32 threadCount = 1);
+
+    ///
+    /// \brief wrapKey - Function wraps key with AES Key Wrap algorithm (RFC 3394 or RFC 5649).
+    /// \param key - Key that will be wrapped. For RFC 3394 size must be multiple of 8 and at least 16 bytes.
+    /// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap() for RFC 3394 and EVP_aes_256_wrap_pad() for RFC 5649.
+    /// \return Returns wrapped key.
+    ///
+    [[nodiscard]] QByteArray wrapKey(const QByteArray& key, const QByteArray& kek, const EVP_CIPHER* cipher = EVP_aes_256_wrap());
+
+    ///
+    /// \brief unwrapKey - Function unwraps key wrapped with AES Key Wrap algorithm (RFC 3394 or RFC 5649).
+    /// \param wrappedKey - Wrapped key.
+    /// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap().
+    /// \return Returns unwrapped key. Throws, if integrity check fails.
+    ///
+    [[nodiscard]] QByteArray unwrapKey(const QByteArray& wrappedKey, const QByteArray& kek, const EVP_CIPHER* cipher = EVP_aes_256_wrap());
+
+    ///
+    /// \brief wrapKeysBatch - Function wraps many keys with one key encryption key.
+    /// \param keys - Arena with all keys stored one after another.
+    /// \param offsets - Offsets of keys in arena. Key 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is keys count plus one.
+    /// \param resultOffsets - Offsets of wrapped keys in returned arena, in the same format.
+    /// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap().
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \details Key schedule is initialized once per thread and output arena is allocated once.
+    /// \return Returns arena with wrapped keys.
+    ///
+    [[nodiscard]] QByteArray wrapKeysBatch(const QByteArray& keys, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& kek, const EVP_CIPHER* cipher = EVP_aes_256_wrap(), const qint32 threadCount = 1);
+
+    ///
+    /// \brief unwrapKeysBatch - Function unwraps many keys wrapped with one key encryption key.
+    /// \param wrappedKeys - Arena with all wrapped keys stored one after another.
+    /// \param offsets - Offsets of wrapped keys in arena, in the same format as for wrapKeysBatch.
+    /// \param resultOffsets - Offsets of unwrapped keys in returned arena, in the same format.
+    /// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap().
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \return Returns arena with unwrapped keys. Throws, if any integrity check fails.
+    ///
+    [[nodiscard]] QByteArray unwrapKeysBatch(const QByteArray& wrappedKeys, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+        const QByteArray& kek, const EVP_CIPHER* cipher = EVP_aes_256_wrap(), const qint32 threadCount = 1);
+
+    ///
+    /// \brief deriveKeyScrypt - Function derives key from password with memory-hard scrypt algorithm (RFC 7914).
+    /// \param password - Password.
+    /// \param salt - Random delta. Example: bytes generated with QSimpleCrypto::QBlockCipher::generateSalt.
+    /// \param keyLength - Size of derived key in bytes.
+    /// \param cost - CPU/memory cost parameter N. Must be power of two.
+    /// \param blockSize - Block size parameter r.
+    /// \param parallelism - Parallelization parameter p.
+    /// \details Derivation allocates scryptMemory(cost, blockSize, parallelism) bytes.
+    /// \return Returns derived key.
+    ///
+    [[nodiscard]] QByteArray deriveKeyScrypt(const QByteArray& password, const QByteArray& salt, const qint32 keyLength = 32,
+        const quint64 cost = scryptCost, const quint64 blockSize = scryptBlockSize, const quint64 parallelism = scryptParallelism);
+
+    ///
+    /// \brief scryptMemory - Function calculates memory used by one scrypt derivation.
+    /// \param cost - CPU/memory cost parameter N.
+    /// \param blockSize - Block size parameter r.
+    /// \param parallelism - Parallelization parameter p.
+    /// \return Returns memory size in bytes.
+    ///
+    [[nodiscard]] static qint64 scryptMemory(const quint64 cost = scryptCost, const quint64 blockSize = scryptBlockSize, const quint64 parallelism = scryptParallelism);
+
+private:
+    ///
+    /// \brief transformInPlace - Function runs stream-like cipher over buffer, writing output over input.
+    /// \param data - Pointer to data.
+    /// \param size - Size of data.
+    /// \param key - AES key.
+    /// \param iv - Initialization vector.
+    /// \param cipher - OpenSSL EVP_CIPHER (cfb, ofb, ctr).
+    /// \param encrypt - 'true' for encryption and 'false' for decryption.
+    /// \return Returns 'true' on success.
+    ///
+    bool transformInPlace(unsigned char* data, const qint64 size, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher, const bool encrypt);
+
+    ///
+    /// \brief transformFile - Function runs initialized cipher context over memory mapped windows of input file.
+    /// \param context - Initialized OpenSSL EVP_CIPHER_CTX.
+    /// \param inputFilePath - Path to source file.
+    /// \param outputFilePath - Path to destination file.
+    /// \param windowSize - Size of memory mapped window.
+    /// \return Returns 'true' on success.
+    ///
+    bool transformFile(EVP_CIPHER_CTX* context, const QByteArray& inputFilePath, const QByteArray& outputFilePath, const qint64 windowSize);
 };
 } // namespace QSimpleCrypto
 
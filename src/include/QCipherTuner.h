@@ -0,0 +1,119 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QCIPHERTUNER_H
+#define QCIPHERTUNER_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QThread>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+#include "QBatchRunner.h"
+#include "QCryptoPipeline.h"
+#include "QKeyedBlockCipher.h"
+#include "QRandomPool.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QCipherTuner class - Picks chunk size and thread count, that give best cipher throughput on current host.
+/// \details Short timed probe runs AES-256-CTR and AES-256-GCM kernels over candidate chunk sizes, then over candidate thread counts.
+///          Result is saved to INI cache file together with host fingerprint, so later runs read it instead of probing.
+///          Chosen values are meant for QCryptoPipeline buffer size, file window sizes and 'threadCount' of batch functions.
+///
+class QSIMPLECRYPTO_EXPORT QCipherTuner {
+
+///
+/// \brief tunerProbeSize - Number of bytes processed by every probe candidate.
+///
+#define tunerProbeSize (16 * 1024 * 1024)
+
+///
+/// \brief tunerMinChunkSize - Smallest chunk size candidate.
+///
+#define tunerMinChunkSize (16 * 1024)
+
+///
+/// \brief tunerMaxChunkSize - Largest chunk size candidate.
+///
+#define tunerMaxChunkSize (4 * 1024 * 1024)
+
+public:
+    ///
+    /// \brief The Settings struct - Tuned values and throughput measured with them. Throughput is in bytes per second.
+    ///
+    struct Settings {
+        qint32 chunkSize = pipelineBufferSize;
+        qint32 threadCount = 1;
+        qint64 streamingThroughput = 0; /* One thread with chosen chunk size */
+        qint64 parallelThroughput = 0; /* Chosen number of threads with chosen chunk size */
+        bool probed = false; /* 'true' if values were measured by this call, 'false' if read from cache */
+    };
+
+    ///
+    /// \brief tune - Function reads tuned values from cache file, or probes them and saves them to cache file.
+    /// \param cachePath - Path to INI cache file. Empty path means defaultCachePath().
+    /// \param forceProbe - If 'true', cache file is ignored and overwritten.
+    /// \details Cached values are used only if host fingerprint (host name, CPU architecture, core count and OpenSSL version) matches.
+    ///          Failure to write cache file is not an error, next run probes again.
+    /// \return Returns tuned values.
+    ///
+    [[nodiscard]] static Settings tune(const QString& cachePath = QString(), const bool forceProbe = false);
+
+    ///
+    /// \brief probe - Function measures throughput of candidates and picks best chunk size and thread count.
+    /// \param probeSize - Number of bytes processed by every candidate. Example: tunerProbeSize.
+    /// \details Smaller chunk size and fewer threads are preferred, when they are within few percent of best throughput.
+    /// \return Returns tuned values.
+    ///
+    [[nodiscard]] static Settings probe(const qint64 probeSize = tunerProbeSize);
+
+    ///
+    /// \brief defaultCachePath - Function returns path of cache file in user cache directory.
+    /// \return Returns path to cache file.
+    ///
+    [[nodiscard]] static QString defaultCachePath();
+
+private:
+    ///
+    /// \brief fingerprint - Function describes host, so cache copied from another machine is not trusted.
+    /// \return Returns host fingerprint.
+    ///
+    static QString fingerprint();
+
+    ///
+    /// \brief streamingThroughput - Function measures single thread throughput of cipher kernels with chunk size.
+    /// \param key - AES-256 key.
+    /// \param chunkSize - Size of chunk passed to cipher at once.
+    /// \param bytes - Number of bytes processed by every kernel.
+    /// \return Returns throughput in bytes per second.
+    ///
+    static qint64 streamingThroughput(const QByteArray& key, const qint32 chunkSize, const qint64 bytes);
+
+    ///
+    /// \brief parallelThroughput - Function measures throughput of cipher kernels running on several threads.
+    /// \param key - AES-256 key.
+    /// \param chunkSize - Size of chunk passed to cipher at once.
+    /// \param threads - Number of threads.
+    /// \param bytes - Number of bytes processed by every thread.
+    /// \return Returns throughput of all threads together in bytes per second.
+    ///
+    static qint64 parallelThroughput(const QByteArray& key, const qint32 chunkSize, const qint32 threads, const qint64 bytes);
+};
+} // namespace QSimpleCrypto
+
+#endif // QCIPHERTUNER_H
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QCMAC_H
+#define QCMAC_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+#include <QVector>
+
+#include <memory>
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+#include "QBatchRunner.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QCmac class - Message authentication code AES-CMAC (RFC 4493) bound to one key.
+/// \details Key is set once on template context, and every message is computed on a duplicate of the template.
+///          Object is not thread safe, use 'clone()' to get separate copy for each thread.
+///
+class QSIMPLECRYPTO_EXPORT QCmac {
+
+///
+/// \brief cmacTagLength - Length of AES-CMAC tag.
+///
+#define cmacTagLength 16
+
+public:
+    ///
+    /// \brief QCmac - Initializes AES-CMAC context for key.
+    /// \param key - AES key. Size selects cipher: 16 bytes for AES-128, 24 for AES-192 and 32 for AES-256.
+    ///
+    QCmac(const QByteArray& key);
+
+    QCmac(QCmac&& other) noexcept = default;
+    QCmac& operator=(QCmac&& other) noexcept = default;
+
+    ///
+    /// \brief clone - Function copies keyed template, without setting key again.
+    /// \return Returns independent copy, that can be used from another thread.
+    ///
+    [[nodiscard]] QCmac clone() const;
+
+    ///
+    /// \brief update - Function adds data to current message.
+    /// \param data - Part of message.
+    ///
+    void update(const QByteArray& data);
+
+    ///
+    /// \brief update - Function adds raw buffer to current message.
+    /// \param data - Pointer to part of message.
+    /// \param size - Size of data.
+    ///
+    void update(const unsigned char* data, const qint64 size);
+
+    ///
+    /// \brief finalize - Function finishes current message. Next 'update()' starts new message.
+    /// \return Returns AES-CMAC tag of message.
+    ///
+    [[nodiscard]] QByteArray finalize();
+
+    ///
+    /// \brief compute - Function computes AES-CMAC of whole message.
+    /// \param data - Message.
+    /// \return Returns AES-CMAC tag of message.
+    ///
+    [[nodiscard]] QByteArray compute(const QByteArray& data);
+
+    ///
+    /// \brief compute - Function computes AES-CMAC of raw buffer.
+    /// \param data - Pointer to message.
+    /// \param size - Size of message.
+    /// \param tag - Output buffer with cmacTagLength bytes.
+    ///
+    void compute(const unsigned char* data, const qint64 size, unsigned char* tag);
+
+    ///
+    /// \brief verify - Function checks AES-CMAC tag of message in constant time.
+    /// \param data - Message.
+    /// \param tag - Expected tag.
+    /// \return Returns 'true' if tag matches.
+    ///
+    [[nodiscard]] bool verify(const QByteArray& data, const QByteArray& tag);
+
+    ///
+    /// \brief computeBatch - Function computes AES-CMAC of many messages.
+    /// \param values - Arena with all messages stored one after another.
+    /// \param offsets - Offsets of messages in arena. Message 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is messages count plus one.
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \return Returns tags stored one after another, cmacTagLength bytes per message.
+    ///
+    [[nodiscard]] QByteArray computeBatch(const QByteArray& values, const QVector<qint64>& offsets, const qint32 threadCount = 0) const;
+
+private:
+    QCmac() = default;
+
+    std::unique_ptr<EVP_MAC_CTX, void (*)(EVP_MAC_CTX*)> m_template { nullptr, EVP_MAC_CTX_free };
+    std::unique_ptr<EVP_MAC_CTX, void (*)(EVP_MAC_CTX*)> m_context { nullptr, EVP_MAC_CTX_free };
+};
+} // namespace QSimpleCrypto
+
+#endif // QCMAC_H
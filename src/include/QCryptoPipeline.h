@@ -0,0 +1,145 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QCRYPTOPIPELINE_H
+#define QCRYPTOPIPELINE_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QObject>
+
+#include <memory>
+#include <mutex>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+#include "QGcm.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QCryptoPipeline class - Streams data from source device through cipher into sink device.
+/// \details Reading, encryption and writing run on separate threads and exchange a bounded number of buffers,
+///          so run time is close to the slowest stage instead of the sum of all stages.
+///          Devices must be open, blocking devices (QFile, QBuffer). Reader treats 'read()' returning 0 as end of data.
+///          If function throws, data already written to sink must be discarded.
+///
+class QSIMPLECRYPTO_EXPORT QCryptoPipeline {
+
+///
+/// \brief pipelineBufferSize - Default size of one pipeline buffer.
+///
+#define pipelineBufferSize (1024 * 1024)
+
+///
+/// \brief pipelineBufferDepth - Default number of buffers between two stages. Three buffers let every stage work while one buffer waits.
+///
+#define pipelineBufferDepth 3
+
+public:
+    ///
+    /// \brief The Statistics struct - Result of last pipeline run.
+    ///
+    struct Statistics {
+        qint64 bytesRead = 0; ///< Bytes read from source.
+        qint64 bytesWritten = 0; ///< Bytes written to sink.
+        qint64 elapsed = 0; ///< Wall time of run in nanoseconds.
+        qint64 readTime = 0; ///< Time spent inside source 'read()' in nanoseconds.
+        qint64 cipherTime = 0; ///< Time spent inside cipher in nanoseconds.
+        qint64 writeTime = 0; ///< Time spent inside sink 'write()' in nanoseconds.
+
+        ///
+        /// \brief throughput - Function returns processed bytes per second.
+        /// \return Returns throughput of run, or 0 if nothing was processed.
+        ///
+        [[nodiscard]] double throughput() const { return elapsed > 0 ? static_cast<double>(bytesRead) * 1e9 / static_cast<double>(elapsed) : 0.0; }
+    };
+
+    ///
+    /// \brief QCryptoPipeline - Configures pipeline buffers.
+    /// \param bufferSize - Size of one buffer. Example: pipelineBufferSize.
+    /// \param depth - Number of buffers between two stages. '2' is double buffering, '3' is triple buffering.
+    ///
+    QCryptoPipeline(const qint32 bufferSize = pipelineBufferSize, const qint32 depth = pipelineBufferDepth);
+
+    ///
+    /// \brief encryptAesBlockCipher - Function encrypts stream with Aes Block Cipher algorithm.
+    /// \param source - Device with data that will be encrypted.
+    /// \param sink - Device where encrypted data will be written.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+    /// \return Returns 'true' on success.
+    ///
+    bool encryptAesBlockCipher(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv = "", const EVP_CIPHER* cipher = EVP_aes_256_cbc());
+
+    ///
+    /// \brief decryptAesBlockCipher - Function decrypts stream with Aes Block Cipher algorithm.
+    /// \param source - Device with data that will be decrypted.
+    /// \param sink - Device where decrypted data will be written.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+    /// \return Returns 'true' on success.
+    ///
+    bool decryptAesBlockCipher(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv = "", const EVP_CIPHER* cipher = EVP_aes_256_cbc());
+
+    ///
+    /// \brief encryptAesGcm - Function encrypts stream with AES GCM algorithm.
+    /// \param source - Device with data that will be encrypted.
+    /// \param sink - Device where encrypted data will be written.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param tag - Authentication tag. Will be written by function.
+    /// \param aad - Additional authenticated data. Must be used in decryption.
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+    /// \return Returns 'true' on success.
+    ///
+    bool encryptAesGcm(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv, QByteArray& tag,
+        const QByteArray& aad = "", const EVP_CIPHER* cipher = EVP_aes_256_gcm());
+
+    ///
+    /// \brief decryptAesGcm - Function decrypts stream with AES GCM algorithm.
+    /// \param source - Device with data that will be decrypted.
+    /// \param sink - Device where decrypted data will be written.
+    /// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param tag - Authentication tag from encryption.
+    /// \param aad - Additional authenticated data.
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+    /// \return Returns 'true' on success. Throws, if authentication fails.
+    ///
+    bool decryptAesGcm(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv, const QByteArray& tag,
+        const QByteArray& aad = "", const EVP_CIPHER* cipher = EVP_aes_256_gcm());
+
+    ///
+    /// \brief statistics - Function returns statistics of last run. Can be called from any thread, also while pipeline runs.
+    /// \return Returns bytes, wall time and busy time of every stage.
+    ///
+    [[nodiscard]] Statistics statistics() const;
+
+private:
+    ///
+    /// \brief run - Function runs reader, cipher and writer stages over initialized cipher context.
+    /// \param context - Initialized OpenSSL EVP_CIPHER_CTX.
+    /// \param source - Source device.
+    /// \param sink - Sink device.
+    ///
+    void run(EVP_CIPHER_CTX* context, QIODevice* source, QIODevice* sink);
+
+    qint32 m_bufferSize;
+    qint32 m_depth;
+    mutable std::mutex m_statisticsMutex;
+    Statistics m_statistics;
+};
+} // namespace QSimpleCrypto
+
+#endif // QCRYPTOPIPELINE_H
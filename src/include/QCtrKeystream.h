@@ -0,0 +1,151 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QCTRKEYSTREAM_H
+#define QCTRKEYSTREAM_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <openssl/aes.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QCtrKeystream class - AES-CTR session with keystream generated ahead of time.
+/// \details Background thread encrypts zeros into ring buffer, so 'encrypt()' and 'decrypt()' only XOR data with ready keystream.
+///          Ring is single producer, single consumer: session must be used from one thread at a time.
+///          Keystream is one continuous CTR stream, 'position()' tells receiver where message starts in it.
+///          Used keystream is wiped right away, unused keystream is wiped on destruction.
+///
+class QSIMPLECRYPTO_EXPORT QCtrKeystream {
+
+///
+/// \brief ctrKeystreamRingSize - Default size of keystream ring buffer in bytes.
+///
+#define ctrKeystreamRingSize (1024 * 1024)
+
+///
+/// \brief ctrKeystreamChunkSize - Size of keystream generated by background thread at once.
+///
+#define ctrKeystreamChunkSize (16 * 1024)
+
+public:
+    ///
+    /// \brief QCtrKeystream - Initializes CTR session, fills ring buffer and starts background thread.
+    /// \param key - AES key. Size must match cipher key length. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param iv - Initial counter block with 16 bytes.
+    /// \param cipher - OpenSSL EVP_CIPHER in CTR mode - 128, 192, 256. Example: EVP_aes_256_ctr().
+    /// \param ringSize - Size of ring buffer. Must be power of two and at least two chunks.
+    /// \details Ring is filled before constructor returns, so first messages don't wait. Background thread refills ring when half of it is used.
+    ///
+    QCtrKeystream(const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher = EVP_aes_256_ctr(), const qint64 ringSize = ctrKeystreamRingSize);
+
+    ///
+    /// \brief ~QCtrKeystream - Stops background thread and cleans keystream.
+    ///
+    ~QCtrKeystream();
+
+    QCtrKeystream(const QCtrKeystream&) = delete;
+    QCtrKeystream& operator=(const QCtrKeystream&) = delete;
+
+    ///
+    /// \brief encrypt - Function encrypts data with next part of keystream.
+    /// \param data - Pointer to data that will be encrypted.
+    /// \param size - Size of data.
+    /// \param output - Output buffer with at least 'size' bytes. May be equal to 'data'.
+    /// \return Returns position of first used keystream byte.
+    ///
+    qint64 encrypt(const unsigned char* data, const qint64 size, unsigned char* output);
+
+    ///
+    /// \brief encrypt - Function encrypts data with next part of keystream.
+    /// \param data - Data that will be encrypted in place.
+    /// \return Returns position of first used keystream byte.
+    ///
+    qint64 encrypt(QByteArray& data);
+
+    ///
+    /// \brief decrypt - Function decrypts data with next part of keystream. CTR decryption is the same XOR as encryption.
+    /// \param data - Pointer to data that will be decrypted.
+    /// \param size - Size of data.
+    /// \param output - Output buffer with at least 'size' bytes. May be equal to 'data'.
+    /// \return Returns position of first used keystream byte.
+    ///
+    qint64 decrypt(const unsigned char* data, const qint64 size, unsigned char* output);
+
+    ///
+    /// \brief decrypt - Function decrypts data with next part of keystream. CTR decryption is the same XOR as encryption.
+    /// \param data - Data that will be decrypted in place.
+    /// \return Returns position of first used keystream byte.
+    ///
+    qint64 decrypt(QByteArray& data);
+
+    ///
+    /// \brief position - Function returns number of keystream bytes already used.
+    /// \return Returns position of next keystream byte.
+    ///
+    [[nodiscard]] qint64 position() const;
+
+    ///
+    /// \brief available - Function returns number of precomputed keystream bytes, that can be used without waiting.
+    /// \return Returns number of ready bytes.
+    ///
+    [[nodiscard]] qint64 available() const;
+
+private:
+    ///
+    /// \brief generate - Function generates keystream into ring buffer until it is full.
+    ///
+    void generate();
+
+    ///
+    /// \brief produce - Background thread function, that refills ring buffer.
+    ///
+    void produce();
+
+    ///
+    /// \brief transform - Function XORs data with next part of keystream.
+    /// \param data - Pointer to data.
+    /// \param size - Size of data.
+    /// \param output - Output buffer with at least 'size' bytes.
+    /// \return Returns position of first used keystream byte.
+    ///
+    qint64 transform(const unsigned char* data, qint64 size, unsigned char* output);
+
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_context { nullptr, EVP_CIPHER_CTX_free };
+    std::unique_ptr<unsigned char[]> m_ring;
+    qint64 m_ringSize = 0;
+
+    /* Producer and consumer counters are on separate cache lines */
+    alignas(64) std::atomic<qint64> m_produced { 0 };
+    alignas(64) std::atomic<qint64> m_consumed { 0 };
+
+    std::atomic<bool> m_producerWaiting { false };
+    std::atomic<bool> m_stopped { false };
+    std::exception_ptr m_error;
+    std::atomic<bool> m_failed { false };
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_producer;
+};
+} // namespace QSimpleCrypto
+
+#endif // QCTRKEYSTREAM_H
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QECC_H
+#define QECC_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+
+#include <memory>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QEcc class - Elliptic curve keys: Ed25519 and ECDSA P-256 signatures, X25519 and P-256 ECDH key agreement.
+/// \details Keys are 'OpenSSL EVP_PKEY' structures, the same as in QRsa, so they can be used with QX509 and other OpenSSL functions.
+///
+class QSIMPLECRYPTO_EXPORT QEcc {
+
+public:
+    ///
+    /// \brief The Curve enum - Supported curves.
+    ///
+    enum class Curve {
+        Ed25519, /* EdDSA signatures, RFC 8032 */
+        P256, /* ECDSA signatures and ECDH, NIST P-256 (prime256v1) */
+        X25519 /* ECDH only, RFC 7748 */
+    };
+
+    QEcc();
+
+    ///
+    /// \brief generateEccKeys - Function generates key pair on curve.
+    /// \param curve - Curve. Example: QEcc::Curve::Ed25519.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* generateEccKeys(const Curve curve = Curve::Ed25519);
+
+    ///
+    /// \brief savePublicKey - Saves to file public key in PEM format.
+    /// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param filePath - Path and file name where the file will be saved. Example: "/root/ec.pem"
+    ///
+    void savePublicKey(EVP_PKEY* key, const QByteArray& filePath);
+
+    ///
+    /// \brief savePrivateKey - Saves to file private key in PKCS#8 PEM format.
+    /// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param filePath - Path and file name where the file will be saved. Example: "/root/ec.pem"
+    /// \param password - Private key password.
+    /// \param cipher - Cipher that encrypts key, when password is set. Example: EVP_aes_256_cbc().
+    ///
+    void savePrivateKey(EVP_PKEY* key, const QByteArray& filePath, const QByteArray& password = "", const EVP_CIPHER* cipher = nullptr);
+
+    ///
+    /// \brief getPublicKeyFromFile - Gets public key from PEM file.
+    /// \param filePath - File path to public key file.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* getPublicKeyFromFile(const QByteArray& filePath);
+
+    ///
+    /// \brief getPrivateKeyFromFile - Gets private key from PEM file.
+    /// \param filePath - File path to private key file.
+    /// \param password - Private key password.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* getPrivateKeyFromFile(const QByteArray& filePath, const QByteArray& password = "");
+
+    ///
+    /// \brief publicKeyToDer - Function encodes public key as DER SubjectPublicKeyInfo.
+    /// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \details Encoding doesn't depend on key type, so QRsa encoder is used.
+    /// \return Returns DER bytes.
+    ///
+    [[nodiscard]] QByteArray publicKeyToDer(EVP_PKEY* key);
+
+    ///
+    /// \brief privateKeyToDer - Function encodes private key as unencrypted DER PKCS#8.
+    /// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \details Encoding doesn't depend on key type, so QRsa encoder is used.
+    /// \return Returns DER bytes.
+    ///
+    [[nodiscard]] QByteArray privateKeyToDer(EVP_PKEY* key);
+
+    ///
+    /// \brief publicKeyFromDer - Function decodes public key from DER SubjectPublicKeyInfo.
+    /// \param der - DER bytes.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* publicKeyFromDer(const QByteArray& der);
+
+    ///
+    /// \brief privateKeyFromDer - Function decodes private key from unencrypted DER PKCS#8.
+    /// \param der - DER bytes.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* privateKeyFromDer(const QByteArray& der);
+
+    ///
+    /// \brief sign - Function signs data with Ed25519 or ECDSA private key.
+    /// \param data - Data that will be signed.
+    /// \param key - Ed25519 or P-256 private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param md - Hash algorithm for ECDSA (OpenSSL EVP_MD). Example: EVP_sha256(). Ignored for Ed25519, that hashes data itself.
+    /// \return Returns signature. Ed25519 signature has 64 bytes, ECDSA signature is DER encoded.
+    ///
+    [[nodiscard]] QByteArray sign(const QByteArray& data, EVP_PKEY* key, const EVP_MD* md = EVP_sha256());
+
+    ///
+    /// \brief verify - Function verifies Ed25519 or ECDSA signature.
+    /// \param data - Signed data.
+    /// \param signature - Signature.
+    /// \param key - Ed25519 or P-256 public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param md - Hash algorithm for ECDSA (OpenSSL EVP_MD). Example: EVP_sha256(). Ignored for Ed25519.
+    /// \return Returns 'true' if signature is valid.
+    ///
+    [[nodiscard]] bool verify(const QByteArray& data, const QByteArray& signature, EVP_PKEY* key, const EVP_MD* md = EVP_sha256());
+
+    ///
+    /// \brief deriveSharedSecret - Function computes X25519 or ECDH shared secret.
+    /// \param privateKey - Own X25519 or P-256 private key.
+    /// \param peerPublicKey - Public key of peer on the same curve.
+    /// \details Shared secret is not uniformly random and must be passed through KDF (for example HKDF) before it is used as key.
+    /// \return Returns shared secret. 32 bytes for both curves.
+    ///
+    [[nodiscard]] QByteArray deriveSharedSecret(EVP_PKEY* privateKey, EVP_PKEY* peerPublicKey);
+
+private:
+    ///
+    /// \brief signatureHash - Function returns hash, that must be passed to OpenSSL for key type.
+    /// \param key - Signature key.
+    /// \param md - Hash requested by caller.
+    /// \return Returns 'nullptr' for Ed25519 and 'md' for other keys.
+    ///
+    static const EVP_MD* signatureHash(EVP_PKEY* key, const EVP_MD* md);
+};
+} // namespace QSimpleCrypto
+
+#endif // QECC_H
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QENCRYPTEDLOG_H
+#define QENCRYPTEDLOG_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+#include "QAead.h"
+#include "QFileSync.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QEncryptedLog class - Persistent append-only log, where every record is encrypted with AES-256-GCM.
+/// \details File starts with header that holds open counter (epoch). Every record is fixed header (length, epoch, tag) and cipher text.
+///          Record nonce is epoch and record offset, so nonces are unique without storing them and appends never touch older records.
+///          Offset of every logIndexInterval-th record is stored in memory mapped index file '<filePath>.idx',
+///          so reading record N skips at most logIndexInterval - 1 record headers and decrypts only record N.
+///          Index also holds end of records, that were synced to storage. Recovery trusts only entries before it.
+///          Appends are made durable with group commit: one fdatasync covers all records appended before it.
+///          Log file is locked while it is open, so second object or process can't append with the same epoch. All functions are thread safe.
+///
+class QSIMPLECRYPTO_EXPORT QEncryptedLog {
+
+///
+/// \brief logFileHeaderSize - Size of log file header: magic (8 bytes), epoch (4 bytes), reserved (4 bytes) and key check tag (16 bytes).
+///
+#define logFileHeaderSize 32
+
+///
+/// \brief logRecordHeaderSize - Size of record header: length (4 bytes), epoch (4 bytes) and tag (16 bytes).
+///
+#define logRecordHeaderSize 24
+
+///
+/// \brief logIndexInterval - Number of records between two index entries.
+///
+#define logIndexInterval 64
+
+///
+/// \brief logGroupCommitRecords - Default number of unsynced records, that starts group commit.
+///
+#define logGroupCommitRecords 256
+
+///
+/// \brief logGroupCommitInterval - Default time in milliseconds, after which unsynced records are synced.
+///
+#define logGroupCommitInterval 10
+
+public:
+    ///
+    /// \brief QEncryptedLog - Opens or creates log, recovers it after crash and starts group commit thread.
+    /// \param filePath - Path to log file. Index is stored next to it with '.idx' suffix.
+    /// \param key - AES-256 key with 32 bytes.
+    /// \param groupCommitRecords - Number of unsynced records, that starts group commit.
+    /// \param groupCommitInterval - Time in milliseconds, after which unsynced records are synced.
+    /// \details Recovery drops torn records from end of file. Index entries past synced end are dropped, and records after last
+    ///          trusted entry are authenticated and indexed again during recovery.
+    ///
+    QEncryptedLog(const QString& filePath, const QByteArray& key, const qint32 groupCommitRecords = logGroupCommitRecords,
+        const qint32 groupCommitInterval = logGroupCommitInterval);
+
+    ///
+    /// \brief ~QEncryptedLog - Syncs remaining records and closes log.
+    ///
+    ~QEncryptedLog();
+
+    QEncryptedLog(const QEncryptedLog&) = delete;
+    QEncryptedLog& operator=(const QEncryptedLog&) = delete;
+
+    ///
+    /// \brief append - Function encrypts record and appends it to log.
+    /// \param data - Record data.
+    /// \param durable - If 'true', function waits until record is synced to storage.
+    /// \return Returns number of record.
+    ///
+    qint64 append(const QByteArray& data, const bool durable = false);
+
+    ///
+    /// \brief sync - Function waits until all appended records are synced to storage.
+    ///
+    void sync();
+
+    ///
+    /// \brief read - Function reads and decrypts one record.
+    /// \param record - Number of record.
+    /// \return Returns record data. Throws, if record is out of range or fails authentication.
+    ///
+    [[nodiscard]] QByteArray read(const qint64 record);
+
+    ///
+    /// \brief count - Function returns number of records in log.
+    /// \return Returns number of records.
+    ///
+    [[nodiscard]] qint64 count() const;
+
+private:
+    ///
+    /// \brief keyCheck - Function computes tag, that tells if log is opened with right key.
+    /// \return Returns 16 bytes tag.
+    /// \details Tag is AES GCM tag of empty message with epoch 0 nonce, which is never used by records.
+    ///
+    QByteArray keyCheck();
+
+    ///
+    /// \brief recover - Function finds last valid record, rebuilds index tail and truncates torn data.
+    ///
+    void recover();
+
+    ///
+    /// \brief readRecord - Function reads record header and cipher text at offset.
+    /// \param offset - Offset of record header.
+    /// \param header - Record header with logRecordHeaderSize bytes.
+    /// \param cipherText - Cipher text. Not read if 'nullptr'.
+    /// \return Returns 'false', if record doesn't fit into file or has invalid epoch.
+    ///
+    bool readRecord(const qint64 offset, QByteArray& header, QByteArray* cipherText);
+
+    ///
+    /// \brief decryptRecord - Function authenticates and decrypts record.
+    /// \param offset - Offset of record header.
+    /// \param header - Record header.
+    /// \param cipherText - Cipher text.
+    /// \return Returns record data.
+    ///
+    QByteArray decryptRecord(const qint64 offset, const QByteArray& header, const QByteArray& cipherText);
+
+    ///
+    /// \brief nonce - Function builds record nonce from epoch and offset.
+    /// \param epoch - Epoch of record.
+    /// \param offset - Offset of record header.
+    /// \return Returns 12 bytes nonce.
+    ///
+    static QByteArray nonce(const quint32 epoch, const qint64 offset);
+
+    ///
+    /// \brief indexEntry - Function returns offset of record 'entry * logIndexInterval'.
+    /// \param entry - Number of index entry.
+    /// \return Returns offset of record.
+    ///
+    qint64 indexEntry(const qint64 entry);
+
+    ///
+    /// \brief setIndexEntry - Function stores offset of record 'entry * logIndexInterval', growing index when needed.
+    /// \param entry - Number of index entry.
+    /// \param offset - Offset of record.
+    ///
+    void setIndexEntry(const qint64 entry, const qint64 offset);
+
+    ///
+    /// \brief mapIndex - Function resizes index file and maps it.
+    /// \param capacity - Number of index entries.
+    ///
+    void mapIndex(const qint64 capacity);
+
+    ///
+    /// \brief waitDurable - Function waits until first 'records' records are synced. One caller syncs, others wait for it.
+    /// \param records - Number of records.
+    ///
+    void waitDurable(const qint64 records);
+
+    ///
+    /// \brief commit - Group commit thread function.
+    ///
+    void commit();
+
+    QFile m_writer;
+    QFile m_reader;
+    QFile m_indexFile;
+    QByteArray m_key;
+    quint32 m_epoch = 0;
+    qint64 m_end = 0;
+    std::atomic<qint64> m_count { 0 };
+
+    std::mutex m_appendMutex;
+    std::mutex m_readMutex;
+    std::mutex m_indexMutex;
+    uchar* m_index = nullptr;
+    qint64 m_indexCapacity = 0;
+
+    std::mutex m_syncMutex;
+    std::condition_variable m_syncCondition;
+    std::condition_variable m_commitCondition;
+    std::atomic<qint64> m_synced { 0 };
+    bool m_syncing = false;
+    bool m_stopped = false;
+    std::atomic<bool> m_failed { false };
+    qint32 m_groupCommitRecords;
+    qint32 m_groupCommitInterval;
+    std::thread m_committer;
+};
+} // namespace QSimpleCrypto
+
+#endif // QENCRYPTEDLOG_H
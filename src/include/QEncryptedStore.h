@@ -0,0 +1,298 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QENCRYPTEDSTORE_H
+#define QENCRYPTEDSTORE_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QFile>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QtEndian>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include "QAead.h"
+#include "QFileSync.h"
+#include "QRandomPool.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QEncryptedStore class - Persistent key-value store for small blobs, where every value is encrypted with AES-256-GCM.
+/// \details Values are appended to memory mapped data file '<filePath>'. Record header holds keyed hash of key, random nonce and tag.
+///          Header with key hash is authenticated data, so value can't be moved to another key. Keys themselves are never stored.
+///          Memory mapped open addressing hash table '<filePath>.index' maps key hash to record offset,
+///          so lookup is one index probe, one read from mapped data file and one decryption.
+///          Index is rebuilt from data file, if store wasn't closed cleanly.
+///          Background thread compacts data file, when more than half of it is overwritten or removed values.
+///          Any number of readers work in parallel. Writers and final step of compaction are exclusive.
+///
+class QSIMPLECRYPTO_EXPORT QEncryptedStore {
+
+///
+/// \brief storeFileHeaderSize - Size of data file header: magic (8 bytes), reserved (8 bytes) and key check tag (16 bytes).
+///
+#define storeFileHeaderSize 32
+
+///
+/// \brief storeRecordHeaderSize - Size of record header: flags (4 bytes), value length (4 bytes), key hash (16 bytes), nonce (12 bytes) and tag (16 bytes).
+///
+#define storeRecordHeaderSize 52
+
+///
+/// \brief storeIndexHeaderSize - Size of index header: magic, slot count, covered data size, key count and live bytes (8 bytes each) and reserved (8 bytes).
+///
+#define storeIndexHeaderSize 48
+
+///
+/// \brief storeIndexSlotSize - Size of index slot: key hash (16 bytes) and record offset (8 bytes).
+///
+#define storeIndexSlotSize 24
+
+///
+/// \brief storeGrowSize - Step of data file growth. Data file is mapped again after every step.
+///
+#define storeGrowSize (16 * 1024 * 1024)
+
+///
+/// \brief storeCompactionMinSize - Data file size, below which compaction doesn't run.
+///
+#define storeCompactionMinSize (4 * 1024 * 1024)
+
+///
+/// \brief storeCompactionInterval - Time in milliseconds between two checks of background compaction.
+///
+#define storeCompactionInterval 1000
+
+public:
+    ///
+    /// \brief QEncryptedStore - Opens or creates store and starts background compaction.
+    /// \param filePath - Path to data file. Index is stored next to it with '.index' suffix.
+    /// \param key - Master key with 32 bytes. Encryption and key hash keys are derived from it.
+    /// \param backgroundCompaction - If 'true', data file is compacted by background thread.
+    /// \details Throws, if store is already open by another object or process.
+    ///
+    QEncryptedStore(const QString& filePath, const QByteArray& key, const bool backgroundCompaction = true);
+
+    ///
+    /// \brief ~QEncryptedStore - Syncs data, saves index and closes store.
+    ///
+    ~QEncryptedStore();
+
+    QEncryptedStore(const QEncryptedStore&) = delete;
+    QEncryptedStore& operator=(const QEncryptedStore&) = delete;
+
+    ///
+    /// \brief put - Function stores value for key, replacing previous value.
+    /// \param key - Key. Example: session identifier.
+    /// \param value - Value that will be encrypted.
+    ///
+    void put(const QByteArray& key, const QByteArray& value);
+
+    ///
+    /// \brief get - Function reads and decrypts value of key.
+    /// \param key - Key.
+    /// \param found - Set to 'true' if key exists. Can be 'nullptr'.
+    /// \return Returns value, or "" if key doesn't exist. Throws, if value fails authentication.
+    ///
+    [[nodiscard]] QByteArray get(const QByteArray& key, bool* found = nullptr);
+
+    ///
+    /// \brief contains - Function checks if key exists, without decrypting value.
+    /// \param key - Key.
+    /// \return Returns 'true' if key exists.
+    ///
+    [[nodiscard]] bool contains(const QByteArray& key);
+
+    ///
+    /// \brief remove - Function removes key.
+    /// \param key - Key.
+    /// \return Returns 'true' if key existed.
+    ///
+    bool remove(const QByteArray& key);
+
+    ///
+    /// \brief count - Function returns number of keys in store.
+    /// \return Returns number of keys.
+    ///
+    [[nodiscard]] qint64 count();
+
+    ///
+    /// \brief sync - Function waits until all written values reach storage.
+    ///
+    void sync();
+
+    ///
+    /// \brief compact - Function rewrites data file with live values only.
+    /// \details Readers and writers keep working while live values are copied. They wait only while files are switched.
+    ///          If switch fails after data file was closed, store throws from every function and must be opened again.
+    ///
+    void compact();
+
+private:
+    ///
+    /// \brief keyHash - Function computes keyed hash of key, that is stored instead of key.
+    /// \param key - Key.
+    /// \return Returns 16 bytes hash.
+    ///
+    QByteArray keyHash(const QByteArray& key) const;
+
+    ///
+    /// \brief keyCheck - Function computes tag, that tells if store is opened with right key.
+    /// \return Returns 16 bytes tag.
+    ///
+    QByteArray keyCheck() const;
+
+    ///
+    /// \brief openData - Function opens data file, creates header and maps file.
+    ///
+    void openData();
+
+    ///
+    /// \brief openIndex - Function maps index and checks if it matches data file. Rebuilds index otherwise.
+    ///
+    void openIndex();
+
+    ///
+    /// \brief rebuildIndex - Function scans data file and builds index from records.
+    ///
+    void rebuildIndex();
+
+    ///
+    /// \brief mapData - Function resizes data file and maps it.
+    /// \param capacity - New data file size.
+    ///
+    void mapData(const qint64 capacity);
+
+    ///
+    /// \brief mapIndex - Function resizes index file to number of slots, maps it and clears slots.
+    /// \param slots - Number of slots. Must be power of two.
+    ///
+    void mapIndex(const qint64 slots);
+
+    ///
+    /// \brief writeIndexHeader - Function writes index header.
+    /// \param coveredSize - Data size covered by index. '0' marks index as dirty.
+    ///
+    void writeIndexHeader(const qint64 coveredSize);
+
+    ///
+    /// \brief findSlot - Function finds index slot of key hash.
+    /// \param hash - Key hash.
+    /// \param insert - If 'true', returns first free slot when key hash is not found.
+    /// \return Returns slot number, or -1 if key hash is not found and 'insert' is 'false'.
+    ///
+    qint64 findSlot(const unsigned char* hash, const bool insert) const;
+
+    ///
+    /// \brief setSlot - Function stores record offset for key hash, growing index when needed.
+    /// \param hash - Key hash.
+    /// \param offset - Record offset.
+    /// \return Returns previous record offset, or 0 if key hash was not in index.
+    ///
+    qint64 setSlot(const unsigned char* hash, const qint64 offset);
+
+    ///
+    /// \brief removeSlot - Function removes key hash from index.
+    /// \param slot - Slot number.
+    ///
+    void removeSlot(const qint64 slot);
+
+    ///
+    /// \brief slotOffset - Function returns record offset stored in slot.
+    /// \param slot - Slot number.
+    /// \return Returns record offset, storeEmptySlot or storeRemovedSlot.
+    ///
+    qint64 slotOffset(const qint64 slot) const;
+
+    ///
+    /// \brief appendRecord - Function encrypts value and appends record to data file.
+    /// \param hash - Key hash.
+    /// \param value - Value. Ignored for removal record.
+    /// \param removal - If 'true', record marks key as removed.
+    /// \return Returns record offset.
+    ///
+    qint64 appendRecord(const QByteArray& hash, const QByteArray& value, const bool removal);
+
+    ///
+    /// \brief decryptRecord - Function authenticates and decrypts record.
+    /// \param record - Pointer to record header.
+    /// \return Returns value.
+    ///
+    QByteArray decryptRecord(const unsigned char* record) const;
+
+    ///
+    /// \brief indexedRecord - Function returns record, that index points to, after checking it lies inside data file.
+    /// \param offset - Record offset read from index.
+    /// \details Index is not authenticated, so corrupted offset throws instead of reading outside of mapping.
+    ///          Index is then not saved as clean on close, so next open rebuilds it from data file.
+    /// \return Returns pointer to record header.
+    ///
+    const unsigned char* indexedRecord(const qint64 offset) const;
+
+    ///
+    /// \brief recordSize - Function returns size of record including header.
+    /// \param record - Pointer to record header.
+    /// \return Returns record size.
+    ///
+    static qint64 recordSize(const unsigned char* record);
+
+    ///
+    /// \brief checkUsable - Function throws, if compaction failed while files were switched. Lock must be held.
+    ///
+    void checkUsable() const;
+
+    ///
+    /// \brief needsCompaction - Function checks if more than half of large data file is dead records.
+    /// \return Returns 'true' if compaction is worth running.
+    ///
+    bool needsCompaction();
+
+    ///
+    /// \brief compactInBackground - Background compaction thread function.
+    ///
+    void compactInBackground();
+
+    QString m_filePath;
+    QByteArray m_encryptionKey;
+    QByteArray m_hashKey;
+
+    QFile m_dataFile;
+    uchar* m_data = nullptr;
+    qint64 m_dataCapacity = 0;
+    qint64 m_end = 0;
+    qint64 m_liveBytes = 0;
+    bool m_failed = false;
+    mutable std::atomic<bool> m_indexCorrupted { false };
+
+    QFile m_indexFile;
+    uchar* m_index = nullptr;
+    qint64 m_slots = 0;
+    qint64 m_usedSlots = 0;
+    qint64 m_count = 0;
+
+    QReadWriteLock m_lock;
+    std::mutex m_compactionMutex;
+
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCondition;
+    bool m_stopped = false;
+    std::thread m_compactor;
+};
+} // namespace QSimpleCrypto
+
+#endif // QENCRYPTEDSTORE_H
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QENVELOPE_H
+#define QENVELOPE_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QIODevice>
+#include <QObject>
+#include <QtEndian>
+
+#include <memory>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+
+#include "QAead.h"
+#include "QCryptoPipeline.h"
+#include "QRandomPool.h"
+#include "QRsaKey.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QEnvelope class - Hybrid encryption of data of any size for RSA key holder.
+/// \details Data is encrypted with random AES-256-GCM content key, and only content key is encrypted with RSA-OAEP,
+///          so every message costs one RSA operation regardless of its size. Result is one blob:
+///
+///          "QSCENV01" | OAEP hash NID (4) | wrapped key size (4) | nonce (12) | wrapped key | cipher text | tag (16)
+///
+///          Integers are little endian. Header is authenticated together with caller aad, so it can't be changed or
+///          moved to another message.
+///
+class QSIMPLECRYPTO_EXPORT QEnvelope {
+
+///
+/// \brief envelopeKeyLength - Size of AES-256 content key.
+///
+#define envelopeKeyLength 32
+
+///
+/// \brief envelopeNonceLength - Size of AES-GCM nonce.
+///
+#define envelopeNonceLength 12
+
+///
+/// \brief envelopeTagLength - Size of AES-GCM tag.
+///
+#define envelopeTagLength 16
+
+public:
+    QEnvelope();
+
+    ///
+    /// \brief seal - Function encrypts data for holder of RSA private key.
+    /// \param data - Data that will be encrypted.
+    /// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param aad - Additional authenticated data. Must be used in opening.
+    /// \param md - Hash algorithm of OAEP padding (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \return Returns envelope.
+    ///
+    [[nodiscard]] QByteArray seal(const QByteArray& data, EVP_PKEY* key, const QByteArray& aad = "", const EVP_MD* md = EVP_sha256());
+
+    ///
+    /// \brief open - Function decrypts envelope made by seal() or sealStream().
+    /// \param envelope - Envelope.
+    /// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param aad - Additional authenticated data, that was used in sealing.
+    /// \return Returns decrypted data. Throws, if envelope is malformed, key doesn't match or authentication fails.
+    ///
+    [[nodiscard]] QByteArray open(const QByteArray& envelope, EVP_PKEY* key, const QByteArray& aad = "");
+
+    ///
+    /// \brief sealStream - Function encrypts stream for holder of RSA private key.
+    /// \param source - Device with data that will be encrypted.
+    /// \param sink - Device where envelope will be written.
+    /// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param aad - Additional authenticated data. Must be used in opening.
+    /// \param md - Hash algorithm of OAEP padding (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \param bufferSize - Size of pipeline buffer. Example: pipelineBufferSize.
+    /// \details Data runs through QCryptoPipeline, so memory use doesn't depend on data size.
+    /// \return Returns 'true' on success.
+    ///
+    bool sealStream(QIODevice* source, QIODevice* sink, EVP_PKEY* key, const QByteArray& aad = "", const EVP_MD* md = EVP_sha256(),
+        const qint32 bufferSize = pipelineBufferSize);
+
+    ///
+    /// \brief openStream - Function decrypts envelope stream made by seal() or sealStream().
+    /// \param source - Random access device (QFile, QBuffer) with envelope. Envelope runs from current position to end of device.
+    /// \param sink - Device where decrypted data will be written.
+    /// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param aad - Additional authenticated data, that was used in sealing.
+    /// \param bufferSize - Size of pipeline buffer. Example: pipelineBufferSize.
+    /// \details Tag is read from end of device first, so source can't be sequential. If function throws, data already written to sink must be discarded.
+    /// \return Returns 'true' on success. Throws, if envelope is malformed, key doesn't match or authentication fails.
+    ///
+    bool openStream(QIODevice* source, QIODevice* sink, EVP_PKEY* key, const QByteArray& aad = "", const qint32 bufferSize = pipelineBufferSize);
+
+private:
+    ///
+    /// \brief createHeader - Function generates content key and nonce, and builds envelope header with wrapped content key.
+    /// \param key - RSA public key.
+    /// \param md - Hash algorithm of OAEP padding.
+    /// \param contentKey - Generated content key. Will be written by function.
+    /// \param nonce - Generated nonce. Will be written by function.
+    /// \return Returns envelope header.
+    ///
+    static QByteArray createHeader(EVP_PKEY* key, const EVP_MD* md, QByteArray& contentKey, QByteArray& nonce);
+
+    ///
+    /// \brief parseHeader - Function reads envelope header and unwraps content key.
+    /// \param header - Bytes starting with envelope header. Must contain at least 'headerSize' bytes.
+    /// \param key - RSA private key.
+    /// \param contentKey - Unwrapped content key. Will be written by function.
+    /// \param nonce - Nonce. Will be written by function.
+    /// \return Returns header size.
+    ///
+    static qint64 parseHeader(const QByteArray& header, EVP_PKEY* key, QByteArray& contentKey, QByteArray& nonce);
+
+    ///
+    /// \brief headerSize - Function returns size of header, that starts with given fixed part.
+    /// \param fixedPart - First fixedHeaderSize() bytes of envelope.
+    /// \return Returns header size. Throws, if magic doesn't match.
+    ///
+    static qint64 headerSize(const QByteArray& fixedPart);
+
+    ///
+    /// \brief fixedHeaderSize - Function returns size of header part, that doesn't depend on RSA key size.
+    /// \return Returns size in bytes.
+    ///
+    static qint64 fixedHeaderSize();
+};
+} // namespace QSimpleCrypto
+
+#endif // QENVELOPE_H
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QFILESYNC_H
+#define QFILESYNC_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstdio>
+#include <stdexcept>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace QSimpleCrypto {
+class QSIMPLECRYPTO_EXPORT QFileSync {
+public:
+    ///
+    /// \brief syncData - Function flushes Qt buffer and waits until file data reaches storage.
+    /// \param file - Open file.
+    /// \details Uses fdatasync where available, so metadata that isn't needed to read data back is not written.
+    ///
+    static void syncData(QFile& file)
+    {
+        if (!file.flush()) {
+            throw std::runtime_error("Couldn't flush file. QFile::flush(). Error: " + file.errorString().toStdString());
+        }
+
+        syncHandle(file.handle());
+    }
+
+    ///
+    /// \brief syncHandle - Function waits until data of file descriptor reaches storage.
+    /// \param handle - File descriptor. Example: QFile::handle().
+    /// \details Doesn't touch QFile object, so it can run while another thread writes to unbuffered file.
+    ///
+    static void syncHandle(const qint32 handle)
+    {
+#if defined(Q_OS_WIN)
+        const qint32 result = _commit(handle);
+#elif defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+        const qint32 result = ::fdatasync(handle);
+#else
+        const qint32 result = ::fsync(handle);
+#endif
+
+        if (result != 0) {
+            throw std::runtime_error("Couldn't sync file to storage.");
+        }
+    }
+
+    ///
+    /// \brief syncMapping - Function waits until changes made through memory mapping reach storage.
+    /// \param data - Address returned by QFile::map() with offset 0.
+    /// \param size - Size of mapped region.
+    ///
+    static void syncMapping(uchar* data, const qint64 size)
+    {
+#ifdef Q_OS_WIN
+        const bool result = FlushViewOfFile(data, static_cast<SIZE_T>(size)) != 0;
+#else
+        const bool result = ::msync(data, static_cast<size_t>(size), MS_SYNC) == 0;
+#endif
+
+        if (!result) {
+            throw std::runtime_error("Couldn't sync mapped file to storage.");
+        }
+    }
+
+    ///
+    /// \brief tryLockExclusive - Function takes exclusive advisory lock of file without waiting.
+    /// \param handle - File descriptor. Example: QFile::handle().
+    /// \details Lock belongs to descriptor and is released when file is closed or process exits.
+    ///          On Windows lock covers byte far beyond end of file, so reads and writes of data through other handles are not blocked.
+    /// \return Returns 'false' if another descriptor holds the lock.
+    ///
+    static bool tryLockExclusive(const qint32 handle)
+    {
+#ifdef Q_OS_WIN
+        OVERLAPPED overlapped {};
+        overlapped.OffsetHigh = 0x7FFFFFFF;
+        return LockFileEx(reinterpret_cast<HANDLE>(_get_osfhandle(handle)), LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) != 0;
+#else
+        return ::flock(handle, LOCK_EX | LOCK_NB) == 0;
+#endif
+    }
+
+    ///
+    /// \brief replaceFile - Function atomically replaces file with another one.
+    /// \param source - Path to new file.
+    /// \param destination - Path to file that will be replaced.
+    /// \return Returns 'true' on success. QFile::rename() can't be used, because it fails when destination exists.
+    ///
+    static bool replaceFile(const QString& source, const QString& destination)
+    {
+#ifdef Q_OS_WIN
+        return MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(source).utf16()),
+                   reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(destination).utf16()), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)
+            != 0;
+#else
+        return std::rename(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0;
+#endif
+    }
+
+    ///
+    /// \brief syncDirectory - Function waits until directory entries of file, for example after replaceFile(), reach storage.
+    /// \param filePath - Path to file, whose directory is synced.
+    /// \details On Windows replaceFile() already writes through, so nothing is done.
+    ///
+    static void syncDirectory(const QString& filePath)
+    {
+#ifdef Q_OS_WIN
+        Q_UNUSED(filePath)
+#else
+        const qint32 handle = ::open(QFile::encodeName(QFileInfo(filePath).absolutePath()).constData(), O_RDONLY | O_DIRECTORY);
+        if (handle < 0) {
+            throw std::runtime_error("Couldn't open directory to sync it.");
+        }
+
+        const qint32 result = ::fsync(handle);
+        ::close(handle);
+
+        if (result != 0) {
+            throw std::runtime_error("Couldn't sync directory to storage.");
+        }
+#endif
+    }
+};
+} // namespace QSimpleCrypto
+
+#endif // QFILESYNC_H
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QGCM_H
+#define QGCM_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QByteArray>
+
+#include <memory>
+#include <stdexcept>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+namespace QSimpleCrypto {
+class QSIMPLECRYPTO_EXPORT QGcm {
+public:
+    ///
+    /// \brief createContext - Function creates AES GCM context and initializes it with key, IV and aad.
+    /// \param cipher - OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+    /// \param key - AES key.
+    /// \param iv - Initialization vector. Can be empty, then nonce of default 12 bytes length must be set with setIv() before every message.
+    /// \param aad - Additional authenticated data. Can be empty.
+    /// \param encrypt - 'true' for encryption and 'false' for decryption.
+    /// \return Returns initialized context.
+    ///
+    static std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> createContext(const EVP_CIPHER* cipher, const QByteArray& key, const QByteArray& iv,
+        const QByteArray& aad, const bool encrypt)
+    {
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> context { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+        if (!context) {
+            throw std::runtime_error("Couldn't initialize cipher context. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize operation. Key and IV are set after IV length */
+        if (!EVP_CipherInit_ex(context.get(), cipher, nullptr, nullptr, nullptr, encrypt)) {
+            throw std::runtime_error("Couldn't initialize cipher operation. EVP_CipherInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Set IV length if default 12 bytes (96 bits) is not appropriate */
+        if (!iv.isEmpty() && !EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_SET_IVLEN, iv.length(), nullptr)) {
+            throw std::runtime_error("Couldn't set IV length. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Set key and IV */
+        if (!EVP_CipherInit_ex(context.get(), nullptr, nullptr, reinterpret_cast<const unsigned char*>(key.data()),
+                iv.isEmpty() ? nullptr : reinterpret_cast<const unsigned char*>(iv.data()), encrypt)) {
+            throw std::runtime_error("Couldn't set key and IV. EVP_CipherInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        provideAad(context.get(), aad);
+
+        return context;
+    }
+
+    ///
+    /// \brief setIv - Function resets operation of initialized context with new IV. Key schedule stays untouched.
+    /// \param context - Initialized OpenSSL EVP_CIPHER_CTX.
+    /// \param iv - Pointer to IV with length set at context creation.
+    ///
+    static void setIv(EVP_CIPHER_CTX* context, const unsigned char* iv)
+    {
+        if (!EVP_CipherInit_ex(context, nullptr, nullptr, nullptr, iv, -1)) {
+            throw std::runtime_error("Couldn't set IV. EVP_CipherInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    }
+
+    ///
+    /// \brief provideAad - Function provides additional authenticated data. Must be called before message.
+    /// \param context - Initialized OpenSSL EVP_CIPHER_CTX.
+    /// \param aad - Additional authenticated data. Nothing is done if it is empty.
+    ///
+    static void provideAad(EVP_CIPHER_CTX* context, const QByteArray& aad)
+    {
+        qint32 aadLength = 0;
+        if (!aad.isEmpty() && !EVP_CipherUpdate(context, nullptr, &aadLength, reinterpret_cast<const unsigned char*>(aad.data()), aad.length())) {
+            throw std::runtime_error("Couldn't provide aad data. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    }
+
+    ///
+    /// \brief setTag - Function sets expected tag, that is checked when decryption is finalized.
+    /// \param context - Initialized OpenSSL EVP_CIPHER_CTX.
+    /// \param tag - Pointer to expected tag.
+    /// \param length - Tag length.
+    ///
+    static void setTag(EVP_CIPHER_CTX* context, const void* tag, const qint32 length)
+    {
+        if (!EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG, length, const_cast<void*>(tag))) {
+            throw std::runtime_error("Couldn't set tag. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    }
+
+    ///
+    /// \brief getTag - Function reads tag computed by finalized encryption.
+    /// \param context - Finalized OpenSSL EVP_CIPHER_CTX.
+    /// \param tag - Pointer where tag will be written.
+    /// \param length - Tag length.
+    ///
+    static void getTag(EVP_CIPHER_CTX* context, void* tag, const qint32 length)
+    {
+        if (!EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_GET_TAG, length, tag)) {
+            throw std::runtime_error("Couldn't get tag. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    }
+
+    ///
+    /// \brief finalize - Function finalizes operation and writes (encryption) or checks (decryption) tag.
+    /// \param context - Initialized OpenSSL EVP_CIPHER_CTX with whole message provided.
+    /// \param output - Output buffer. Nothing is written in GCM mode.
+    /// \param length - Number of bytes written to output.
+    /// \param tag - Pointer to tag. Can be nullptr for contexts in mode without tag, then operation is only finalized.
+    /// \param tagLength - Tag length.
+    /// \details Throws, if tag doesn't match on decryption.
+    ///
+    static void finalize(EVP_CIPHER_CTX* context, unsigned char* output, qint32* length, void* tag, const qint32 tagLength)
+    {
+        const bool encrypting = EVP_CIPHER_CTX_encrypting(context);
+
+        /* Expected tag must be set before finalization */
+        if (tag && !encrypting) {
+            setTag(context, tag, tagLength);
+        }
+
+        /*
+         * Finalize the operation. Nothing is written in GCM mode, but for
+         * decryption a positive return value indicates that tag is valid
+         */
+        if (!EVP_CipherFinal_ex(context, output, length)) {
+            throw std::runtime_error("Couldn't finalize cipher operation. EVP_CipherFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (tag && encrypting) {
+            getTag(context, tag, tagLength);
+        }
+    }
+};
+}
+
+#endif // QGCM_H
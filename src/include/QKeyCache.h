@@ -0,0 +1,212 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QKEYCACHE_H
+#define QKEYCACHE_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QHash>
+#include <QObject>
+
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+#include "QRsa.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QKeyCache class - Cache of parsed keys, that are looked up by SHA-256 of their PEM or DER encoding.
+/// \details Repeated loads of the same encoded key return the same parsed EVP_PKEY with incremented reference count,
+///          so PEM decoding, DER parsing and password KDF run once per key. Least recently used keys are dropped,
+///          when cache is full. Keys handed out stay valid after they are dropped. All functions are thread safe.
+///
+class QSIMPLECRYPTO_EXPORT QKeyCache {
+
+///
+/// \brief keyCacheCapacity - Default number of parsed keys, that cache keeps.
+///
+#define keyCacheCapacity 256
+
+///
+/// \brief keyCacheSecureHeapSize - Default size of OpenSSL secure heap for decrypted private keys.
+///
+#define keyCacheSecureHeapSize (1024 * 1024)
+
+///
+/// \brief keyCacheSecureHeapMinimum - Default minimum secure heap allocation.
+///
+#define keyCacheSecureHeapMinimum 64
+
+public:
+    ///
+    /// \brief The Statistics struct - Snapshot of cache counters.
+    ///
+    struct Statistics {
+        qint64 entries = 0;
+        qint64 hits = 0;
+        qint64 misses = 0;
+        bool secureHeap = false; /* 'false' means decrypted private keys are kept in regular heap */
+        qint64 secureHeapUsed = 0; /* Bytes of secure heap in use by whole process */
+    };
+
+    ///
+    /// \brief QKeyCache - Creates empty cache.
+    /// \param capacity - Number of parsed keys, that cache keeps.
+    ///
+    explicit QKeyCache(const qint32 capacity = keyCacheCapacity);
+
+    ///
+    /// \brief ~QKeyCache - Releases cache references. Keys handed out stay valid.
+    ///
+    ~QKeyCache();
+
+    QKeyCache(const QKeyCache&) = delete;
+    QKeyCache& operator=(const QKeyCache&) = delete;
+
+    ///
+    /// \brief global - Function returns process wide cache.
+    /// \return Returns cache with default capacity.
+    ///
+    [[nodiscard]] static QKeyCache& global();
+
+    ///
+    /// \brief initializeSecureHeap - Function initializes OpenSSL secure heap for decrypted private keys.
+    /// \param size - Size of secure heap. Must be power of two.
+    /// \param minimum - Minimum secure heap allocation. Must be power of two.
+    /// \details Must be called once at startup, before other threads use OpenSSL. Secure heap can't be initialized later safely.
+    ///          Without it private key numbers are kept in regular heap, that may be swapped. statistics() reports which one is used.
+    /// \return Returns 'true' if secure heap is in use. 'false' means platform doesn't support it and keys are kept in regular heap.
+    ///
+    static bool initializeSecureHeap(const qint64 size = keyCacheSecureHeapSize, const qint64 minimum = keyCacheSecureHeapMinimum);
+
+    ///
+    /// \brief getPublicKey - Function returns parsed public key for PEM or DER SubjectPublicKeyInfo.
+    /// \param encoded - Encoded public key.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* getPublicKey(const QByteArray& encoded);
+
+    ///
+    /// \brief getPrivateKey - Function returns parsed private key for PEM or DER encoding.
+    /// \param encoded - Encoded private key.
+    /// \param password - Private key password. Part of lookup, so wrong password never returns key parsed with right one.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* getPrivateKey(const QByteArray& encoded, const QByteArray& password = "");
+
+    ///
+    /// \brief getPrivateKeyFromFile - Function returns decrypted private key of PEM or DER file.
+    /// \param filePath - File path to private key file.
+    /// \param password - Private key password. Part of lookup, so wrong password never returns key decrypted with right one.
+    /// \details Key is looked up by path, device, inode, modification time and size, so replaced or rewritten file is read again
+    ///          and its previous key is dropped. Password KDF runs once per file version. Private key numbers are kept
+    ///          in locked memory, that is not swapped and is cleared on free, only if initializeSecureHeap() was called at startup.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* getPrivateKeyFromFile(const QByteArray& filePath, const QByteArray& password = "");
+
+    ///
+    /// \brief removeFile - Function drops decrypted key of file, for example after key was revoked.
+    /// \param filePath - File path to private key file.
+    ///
+    void removeFile(const QByteArray& filePath);
+
+    ///
+    /// \brief remove - Function drops parsed key of encoding, for example after key was revoked.
+    /// \param encoded - Encoded key.
+    /// \param password - Password, that key was loaded with. Empty for public keys and unencrypted private keys.
+    ///
+    void remove(const QByteArray& encoded, const QByteArray& password = "");
+
+    ///
+    /// \brief clear - Function drops all parsed keys.
+    ///
+    void clear();
+
+    ///
+    /// \brief statistics - Function returns number of entries, hits, misses and secure heap state.
+    /// \return Returns statistics snapshot.
+    ///
+    [[nodiscard]] Statistics statistics() const;
+
+private:
+    ///
+    /// \brief The Entry struct - Parsed key and its position in recently used list.
+    ///
+    struct Entry {
+        EVP_PKEY* key = nullptr;
+        std::list<QByteArray>::iterator position;
+        QByteArray filePath; /* Empty for keys that were not loaded from file */
+    };
+
+    ///
+    /// \brief lookup - Function returns cached key with incremented reference count, or parses and caches it.
+    /// \param type - 'P' for public key and 'S' for private key.
+    /// \param encoded - Encoded key.
+    /// \param password - Private key password.
+    /// \return Returns key owned by caller.
+    ///
+    EVP_PKEY* lookup(const char type, const QByteArray& encoded, const QByteArray& password);
+
+    ///
+    /// \brief find - Function returns cached key with incremented reference count and counts hit or miss.
+    /// \param id - Lookup id.
+    /// \return Returns key owned by caller or 'nullptr' on miss.
+    ///
+    EVP_PKEY* find(const QByteArray& id);
+
+    ///
+    /// \brief insert - Function caches parsed key, unless other thread cached the same key first.
+    /// \param id - Lookup id.
+    /// \param key - Parsed key. Ownership is taken.
+    /// \param filePath - File of key. Previous key of the same file is dropped.
+    /// \return Returns key owned by caller.
+    ///
+    EVP_PKEY* insert(const QByteArray& id, EVP_PKEY* key, const QByteArray& filePath = QByteArray());
+
+    ///
+    /// \brief erase - Function drops entry. Mutex must be locked.
+    /// \param entry - Entry iterator.
+    ///
+    void erase(QHash<QByteArray, Entry>::iterator entry);
+
+    ///
+    /// \brief fileVersion - Function returns device, inode, modification time and size of file.
+    /// \param filePath - File path.
+    /// \return Returns bytes, that change when file is replaced or rewritten.
+    ///
+    static QByteArray fileVersion(const QByteArray& filePath);
+
+    ///
+    /// \brief cacheId - Function computes lookup id of key.
+    /// \param type - 'P' for public key and 'S' for private key.
+    /// \param encoded - Encoded key.
+    /// \param password - Private key password.
+    /// \return Returns SHA-256 of type, password and encoding.
+    ///
+    static QByteArray cacheId(const char type, const QByteArray& encoded, const QByteArray& password);
+
+    qint32 m_capacity;
+
+    mutable std::mutex m_mutex;
+    QHash<QByteArray, Entry> m_entries;
+    std::list<QByteArray> m_order; /* Most recently used first */
+    QHash<QByteArray, QByteArray> m_files; /* File path to id of its cached key */
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+} // namespace QSimpleCrypto
+
+#endif // QKEYCACHE_H
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QKEYEDAESSIV_H
+#define QKEYEDAESSIV_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+
+#include <memory>
+
+#include <openssl/err.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QKeyedAesSiv class - Deterministic authenticated encryption AES-SIV (RFC 5297) bound to one key.
+/// \details Same plain text and aad always give the same cipher text, so cipher text can be indexed and compared for equality.
+///          Key is expanded once into template contexts, and every message works on a copy of the template.
+///          Object is not thread safe, use 'clone()' to get separate copy for each thread.
+///
+class QSIMPLECRYPTO_EXPORT QKeyedAesSiv {
+
+///
+/// \brief aesSivTagLength - Length of synthetic IV, that is stored in front of cipher text.
+///
+#define aesSivTagLength 16
+
+public:
+    ///
+    /// \brief QKeyedAesSiv - Initializes AES-SIV contexts for key.
+    /// \param key - AES-SIV key. Size selects cipher: 32 bytes for AES-128-SIV, 48 for AES-192-SIV and 64 for AES-256-SIV.
+    ///
+    QKeyedAesSiv(const QByteArray& key);
+
+    QKeyedAesSiv(QKeyedAesSiv&& other) noexcept = default;
+    QKeyedAesSiv& operator=(QKeyedAesSiv&& other) noexcept = default;
+
+    ///
+    /// \brief clone - Function copies initialized contexts, without running key expansion again.
+    /// \return Returns independent copy, that can be used from another thread.
+    ///
+    [[nodiscard]] QKeyedAesSiv clone() const;
+
+    ///
+    /// \brief encrypt - Function encrypts data with AES-SIV.
+    /// \param data - Data that will be encrypted.
+    /// \param aad - Additional authenticated data. Empty aad is not authenticated.
+    /// \return Returns synthetic IV followed by cipher text.
+    ///
+    [[nodiscard]] QByteArray encrypt(const QByteArray& data, const QByteArray& aad = "");
+
+    ///
+    /// \brief encrypt - Function encrypts raw buffer with AES-SIV.
+    /// \param data - Pointer to data that will be encrypted.
+    /// \param size - Size of data.
+    /// \param output - Output buffer with at least 'size + aesSivTagLength' bytes.
+    /// \param aad - Additional authenticated data. Empty aad is not authenticated.
+    ///
+    void encrypt(const unsigned char* data, const qint32 size, unsigned char* output, const QByteArray& aad = "");
+
+    ///
+    /// \brief decrypt - Function decrypts data encrypted with AES-SIV.
+    /// \param data - Synthetic IV followed by cipher text.
+    /// \param aad - Additional authenticated data.
+    /// \return Returns decrypted data. Throws, if authentication fails.
+    ///
+    [[nodiscard]] QByteArray decrypt(const QByteArray& data, const QByteArray& aad = "");
+
+    ///
+    /// \brief decrypt - Function decrypts raw buffer encrypted with AES-SIV.
+    /// \param data - Pointer to synthetic IV followed by cipher text.
+    /// \param size - Size of data. Must be at least aesSivTagLength.
+    /// \param output - Output buffer with at least 'size - aesSivTagLength' bytes.
+    /// \param aad - Additional authenticated data.
+    ///
+    void decrypt(const unsigned char* data, const qint32 size, unsigned char* output, const QByteArray& aad = "");
+
+private:
+    QKeyedAesSiv() = default;
+
+    ///
+    /// \brief emptyMessageSiv - Function computes synthetic IV of empty message.
+    /// \param aad - Additional authenticated data. Empty aad is not authenticated.
+    /// \param siv - Output buffer with aesSivTagLength bytes.
+    /// \details OpenSSL cipher skips S2V when message is empty, so S2V is computed here with CMAC.
+    ///
+    void emptyMessageSiv(const QByteArray& aad, unsigned char* siv);
+
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_encryptionTemplate { nullptr, EVP_CIPHER_CTX_free };
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_decryptionTemplate { nullptr, EVP_CIPHER_CTX_free };
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_context { nullptr, EVP_CIPHER_CTX_free };
+    std::unique_ptr<EVP_MAC_CTX, void (*)(EVP_MAC_CTX*)> m_macTemplate { nullptr, EVP_MAC_CTX_free };
+};
+} // namespace QSimpleCrypto
+
+#endif // QKEYEDAESSIV_H
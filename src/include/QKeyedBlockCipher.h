@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QKEYEDBLOCKCIPHER_H
+#define QKEYEDBLOCKCIPHER_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+
+#include <memory>
+
+#include <openssl/aes.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QKeyedBlockCipher class - AES block cipher bound to one raw key.
+/// \details Encryption and decryption contexts are initialized once with the key, so key expansion runs only in constructor.
+///          Every call only resets initialization vector. Object is not thread safe, use 'clone()' to get separate copy for each thread.
+///
+class QSIMPLECRYPTO_EXPORT QKeyedBlockCipher {
+public:
+    ///
+    /// \brief QKeyedBlockCipher - Initializes encryption and decryption contexts for key.
+    /// \param key - AES key. Size must match cipher key length. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+    /// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+    ///
+    QKeyedBlockCipher(const QByteArray& key, const EVP_CIPHER* cipher = EVP_aes_256_cbc());
+
+    QKeyedBlockCipher(QKeyedBlockCipher&& other) noexcept = default;
+    QKeyedBlockCipher& operator=(QKeyedBlockCipher&& other) noexcept = default;
+
+    ///
+    /// \brief clone - Function copies initialized contexts, without running key expansion again.
+    /// \return Returns independent copy, that can be used from another thread.
+    ///
+    [[nodiscard]] QKeyedBlockCipher clone() const;
+
+    ///
+    /// \brief encrypt - Function encrypts data with bound key.
+    /// \param data - Data that will be encrypted.
+    /// \param iv - Initialization vector. Size must match cipher IV length. Ignored for ECB.
+    /// \return Returns encrypted data.
+    ///
+    [[nodiscard]] QByteArray encrypt(const QByteArray& data, const QByteArray& iv = "");
+
+    ///
+    /// \brief encrypt - Function encrypts raw buffer with bound key.
+    /// \param data - Pointer to data that will be encrypted.
+    /// \param size - Size of data.
+    /// \param output - Output buffer. Must have at least 'size + blockSize()' bytes. May be equal to 'data'.
+    /// \param iv - Pointer to initialization vector with 'ivLength()' bytes. Ignored for ECB.
+    /// \return Returns size of encrypted data.
+    ///
+    qint32 encrypt(const unsigned char* data, const qint32 size, unsigned char* output, const unsigned char* iv);
+
+    ///
+    /// \brief decrypt - Function decrypts data with bound key.
+    /// \param data - Data that will be decrypted.
+    /// \param iv - Initialization vector. Size must match cipher IV length. Ignored for ECB.
+    /// \return Returns decrypted data.
+    ///
+    [[nodiscard]] QByteArray decrypt(const QByteArray& data, const QByteArray& iv = "");
+
+    ///
+    /// \brief decrypt - Function decrypts raw buffer with bound key.
+    /// \param data - Pointer to data that will be decrypted.
+    /// \param size - Size of data.
+    /// \param output - Output buffer. Must have at least 'size + blockSize()' bytes. May be equal to 'data'.
+    /// \param iv - Pointer to initialization vector with 'ivLength()' bytes. Ignored for ECB.
+    /// \return Returns size of decrypted data.
+    ///
+    qint32 decrypt(const unsigned char* data, const qint32 size, unsigned char* output, const unsigned char* iv);
+
+    ///
+    /// \brief ivLength - Function returns initialization vector length of bound cipher.
+    /// \return Returns IV length in bytes. Zero for ECB.
+    ///
+    [[nodiscard]] qint32 ivLength() const;
+
+    ///
+    /// \brief blockSize - Function returns block size of bound cipher.
+    /// \return Returns block size in bytes. One for stream-like modes.
+    ///
+    [[nodiscard]] qint32 blockSize() const;
+
+private:
+    QKeyedBlockCipher() = default;
+
+    ///
+    /// \brief transform - Function resets IV of initialized context and runs it over data.
+    /// \param context - Initialized encryption or decryption context.
+    /// \param data - Input data.
+    /// \param size - Size of input data.
+    /// \param output - Output buffer.
+    /// \param iv - Pointer to initialization vector.
+    /// \return Returns size of output data.
+    ///
+    qint32 transform(EVP_CIPHER_CTX* context, const unsigned char* data, const qint32 size, unsigned char* output, const unsigned char* iv);
+
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_encryptionContext { nullptr, EVP_CIPHER_CTX_free };
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_decryptionContext { nullptr, EVP_CIPHER_CTX_free };
+};
+} // namespace QSimpleCrypto
+
+#endif // QKEYEDBLOCKCIPHER_H
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QPAGECODEC_H
+#define QPAGECODEC_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+#include <QVector>
+
+#include <memory>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+#include "QBatchRunner.h"
+#include "QGcm.h"
+#include "QRandomPool.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QPageCodec class - Encrypts fixed size storage pages in place.
+/// \details XTS mode encrypts whole page, page number is tweak. Page size doesn't change and nothing is reserved.
+///          GCM mode keeps page number as aad and reserves tail of page for random nonce and tag, so payload is 'pageSize - pageGcmReservedSize' bytes.
+///          Random nonce is used because page with the same number is written many times.
+///          Object is not thread safe, use 'clone()' to get separate copy for each thread. Batch functions do it themselves.
+///
+class QSIMPLECRYPTO_EXPORT QPageCodec {
+
+///
+/// \brief pageGcmNonceLength - Length of nonce stored in page tail in GCM mode.
+///
+#define pageGcmNonceLength 12
+
+///
+/// \brief pageGcmTagLength - Length of tag stored in page tail in GCM mode.
+///
+#define pageGcmTagLength 16
+
+///
+/// \brief pageGcmReservedSize - Size of page tail reserved for nonce and tag in GCM mode.
+///
+#define pageGcmReservedSize (pageGcmNonceLength + pageGcmTagLength)
+
+public:
+    ///
+    /// \brief The Mode enum - Page encryption mode.
+    ///
+    enum class Mode {
+        Xts, ///< AES-256-XTS with 64 bytes key. Confidentiality only, no page expansion.
+        Gcm ///< AES-256-GCM with 32 bytes key. Authenticated, tail of page is reserved.
+    };
+
+    ///
+    /// \brief QPageCodec - Initializes contexts for key.
+    /// \param key - AES key. 64 bytes for XTS and 32 bytes for GCM.
+    /// \param mode - Page encryption mode.
+    /// \param pageSize - Page size. Must be power of two from 512 to 65536 bytes. Example: 4096, 8192, 16384.
+    ///
+    QPageCodec(const QByteArray& key, const Mode mode = Mode::Gcm, const qint32 pageSize = 4096);
+
+    QPageCodec(QPageCodec&& other) noexcept = default;
+    QPageCodec& operator=(QPageCodec&& other) noexcept = default;
+
+    ///
+    /// \brief clone - Function copies initialized contexts, without running key expansion again.
+    /// \return Returns independent copy, that can be used from another thread.
+    ///
+    [[nodiscard]] QPageCodec clone() const;
+
+    ///
+    /// \brief pageSize - Function returns page size.
+    /// \return Returns page size in bytes.
+    ///
+    [[nodiscard]] qint32 pageSize() const;
+
+    ///
+    /// \brief payloadSize - Function returns number of page bytes, that storage engine can use.
+    /// \return Returns page size without reserved tail.
+    ///
+    [[nodiscard]] qint32 payloadSize() const;
+
+    ///
+    /// \brief encryptPage - Function encrypts page in place.
+    /// \param page - Pointer to page with 'pageSize()' bytes. In GCM mode reserved tail is overwritten.
+    /// \param pageNumber - Page number. Page must be decrypted with the same number.
+    ///
+    void encryptPage(unsigned char* page, const quint64 pageNumber);
+
+    ///
+    /// \brief decryptPage - Function decrypts page in place.
+    /// \param page - Pointer to page with 'pageSize()' bytes.
+    /// \param pageNumber - Page number used in encryption.
+    /// \details In GCM mode throws, if page or page number fails authentication. Page content is undefined after that.
+    ///
+    void decryptPage(unsigned char* page, const quint64 pageNumber);
+
+    ///
+    /// \brief encryptPages - Function encrypts list of pages in place.
+    /// \param pages - Pointers to pages with 'pageSize()' bytes.
+    /// \param pageNumbers - Page numbers. Size must match pages.
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    ///
+    void encryptPages(const QVector<unsigned char*>& pages, const QVector<quint64>& pageNumbers, const qint32 threadCount = 0) const;
+
+    ///
+    /// \brief decryptPages - Function decrypts list of pages in place.
+    /// \param pages - Pointers to pages with 'pageSize()' bytes.
+    /// \param pageNumbers - Page numbers. Size must match pages.
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \details In GCM mode throws, if any page fails authentication. All other pages are still decrypted.
+    ///
+    void decryptPages(const QVector<unsigned char*>& pages, const QVector<quint64>& pageNumbers, const qint32 threadCount = 0) const;
+
+private:
+    QPageCodec() = default;
+
+    ///
+    /// \brief transformPages - Function runs single page function over list of pages on several threads.
+    /// \param pages - Pointers to pages.
+    /// \param pageNumbers - Page numbers.
+    /// \param threadCount - Number of threads.
+    /// \param encrypt - 'true' for encryption and 'false' for decryption.
+    ///
+    void transformPages(const QVector<unsigned char*>& pages, const QVector<quint64>& pageNumbers, const qint32 threadCount, const bool encrypt) const;
+
+    Mode m_mode = Mode::Gcm;
+    qint32 m_pageSize = 0;
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_encryptionContext { nullptr, EVP_CIPHER_CTX_free };
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> m_decryptionContext { nullptr, EVP_CIPHER_CTX_free };
+};
+} // namespace QSimpleCrypto
+
+#endif // QPAGECODEC_H
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QPASSWORDHASHER_H
+#define QPASSWORDHASHER_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <openssl/crypto.h>
+
+#include "QBlockCipher.h"
+#include "QRandomPool.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QPasswordHasher class - Service that hashes and verifies passwords with scrypt on bounded worker pool.
+/// \details Every derivation reserves its memory from shared budget before it starts, so burst of logins can't exhaust RAM.
+///          Requests wait in FIFO queue while workers or memory are busy. When queue is full, request is rejected at once,
+///          so caller can answer with backpressure instead of waiting. Hashes are stored as "$scrypt$ln=15,r=8,p=1$<salt>$<hash>",
+///          so verification uses parameters the hash was made with. All functions are thread safe.
+///
+class QSIMPLECRYPTO_EXPORT QPasswordHasher {
+
+///
+/// \brief passwordHasherMemoryBudget - Default memory that all running derivations may use together.
+///
+#define passwordHasherMemoryBudget (256 * 1024 * 1024)
+
+///
+/// \brief passwordHasherQueueLimit - Default number of requests, that may wait for worker.
+///
+#define passwordHasherQueueLimit 1024
+
+///
+/// \brief passwordHasherLatencyWindow - Number of last requests, that latency percentiles are calculated from.
+///
+#define passwordHasherLatencyWindow 4096
+
+///
+/// \brief passwordHasherSaltLength - Size of random salt in bytes.
+///
+#define passwordHasherSaltLength 16
+
+///
+/// \brief passwordHasherHashLength - Size of derived hash in bytes.
+///
+#define passwordHasherHashLength 32
+
+public:
+    ///
+    /// \brief The Metrics struct - Snapshot of service state. Times are in microseconds.
+    ///
+    struct Metrics {
+        qint64 queueDepth = 0; /* Requests waiting for worker */
+        qint64 running = 0; /* Derivations in progress */
+        qint64 memoryInUse = 0; /* Memory reserved by running derivations */
+        qint64 accepted = 0;
+        qint64 rejected = 0;
+        qint64 completed = 0;
+        qint64 waitP50 = 0; /* Time in queue */
+        qint64 waitP99 = 0;
+        qint64 latencyP50 = 0; /* Time from request to result */
+        qint64 latencyP99 = 0;
+    };
+
+    ///
+    /// \brief QPasswordHasher - Starts worker threads.
+    /// \param workerCount - Number of worker threads. '0' means QThread::idealThreadCount().
+    /// \param memoryBudget - Memory that all running derivations may use together.
+    /// \param queueLimit - Number of requests, that may wait for worker. Further requests are rejected.
+    /// \param cost - scrypt cost parameter N for new hashes. Must be power of two.
+    /// \param blockSize - scrypt block size parameter r for new hashes.
+    /// \param parallelism - scrypt parallelization parameter p for new hashes.
+    ///
+    QPasswordHasher(const qint32 workerCount = 0, const qint64 memoryBudget = passwordHasherMemoryBudget, const qint32 queueLimit = passwordHasherQueueLimit,
+        const quint64 cost = scryptCost, const quint64 blockSize = scryptBlockSize, const quint64 parallelism = scryptParallelism);
+
+    ///
+    /// \brief ~QPasswordHasher - Finishes running derivations and fails queued requests.
+    ///
+    ~QPasswordHasher();
+
+    QPasswordHasher(const QPasswordHasher&) = delete;
+    QPasswordHasher& operator=(const QPasswordHasher&) = delete;
+
+    ///
+    /// \brief hash - Function queues hashing of password with random salt.
+    /// \param password - Password.
+    /// \return Returns future with encoded hash. Throws at once, if queue is full.
+    ///
+    [[nodiscard]] std::future<QByteArray> hash(const QByteArray& password);
+
+    ///
+    /// \brief verify - Function queues verification of password against encoded hash.
+    /// \param password - Password.
+    /// \param encodedHash - Hash returned by QPasswordHasher::hash().
+    /// \return Returns future with 'true' if password matches. Throws at once, if queue is full or hash is malformed.
+    ///
+    [[nodiscard]] std::future<bool> verify(const QByteArray& password, const QByteArray& encodedHash);
+
+    ///
+    /// \brief metrics - Function returns queue depth, memory usage, counters and latency percentiles.
+    /// \return Returns metrics snapshot.
+    ///
+    [[nodiscard]] Metrics metrics() const;
+
+private:
+    ///
+    /// \brief The Job struct - Queued hashing or verification request.
+    ///
+    struct Job {
+        QByteArray password;
+        QByteArray salt;
+        QByteArray expected; /* Hash to compare with. Empty for hashing */
+        quint64 cost = 0;
+        quint64 blockSize = 0;
+        quint64 parallelism = 0;
+        qint64 memory = 0;
+        std::chrono::steady_clock::time_point submitted;
+        std::promise<QByteArray> hashResult;
+        std::promise<bool> verifyResult;
+    };
+
+    ///
+    /// \brief submit - Function puts job into queue or rejects it.
+    /// \param job - Job with filled parameters.
+    ///
+    void submit(Job&& job);
+
+    ///
+    /// \brief work - Worker thread function.
+    ///
+    void work();
+
+    ///
+    /// \brief record - Function stores wait and latency of finished job. Must be called with m_mutex locked.
+    /// \param wait - Time in queue in microseconds.
+    /// \param latency - Time from request to result in microseconds.
+    ///
+    void record(const qint64 wait, const qint64 latency);
+
+    ///
+    /// \brief percentile - Function calculates percentile of samples.
+    /// \param samples - Samples. Order is changed.
+    /// \param fraction - Percentile as fraction. Example: 0.99.
+    /// \return Returns sample at percentile, or 0 if there are no samples.
+    ///
+    static qint64 percentile(std::vector<qint64>& samples, const double fraction);
+
+    quint64 m_cost;
+    quint64 m_blockSize;
+    quint64 m_parallelism;
+    qint64 m_memoryBudget;
+    qint32 m_queueLimit;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Job> m_queue;
+    bool m_stopped = false;
+    qint64 m_running = 0;
+    qint64 m_memoryInUse = 0;
+    qint64 m_accepted = 0;
+    qint64 m_rejected = 0;
+    qint64 m_completed = 0;
+
+    std::vector<qint64> m_waits;
+    std::vector<qint64> m_latencies;
+    qint64 m_samples = 0;
+
+    std::vector<std::thread> m_workers;
+};
+} // namespace QSimpleCrypto
+
+#endif // QPASSWORDHASHER_H
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QRANDOMPOOL_H
+#define QRANDOMPOOL_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+
+#include <memory>
+
+#include <openssl/core_names.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+namespace QSimpleCrypto {
+class QSIMPLECRYPTO_EXPORT QRandomPool {
+
+///
+/// \brief randomPoolBufferSize - Size of per-thread buffer, that is refilled from DRBG at once.
+///
+#define randomPoolBufferSize 16384
+
+///
+/// \brief randomPoolMaxRequest - Maximum number of bytes requested from DRBG by one call.
+/// \details That is default 'max_request' of OpenSSL CTR-DRBG.
+///
+#define randomPoolMaxRequest 65536
+
+public:
+    QRandomPool();
+
+    ///
+    /// \brief fill - Function fills buffer with cryptographically secure random bytes.
+    /// \param data - Pointer to buffer that will be filled.
+    /// \param size - Size of buffer.
+    /// \details Bytes are taken from per-thread buffer, that is refilled by large blocks from per-thread CTR-DRBG.
+    ///          DRBG is seeded from OpenSSL primary DRBG and reseeded after fork(), so child processes never repeat parent output.
+    ///          Requests larger than buffer are generated directly into output.
+    ///
+    static void fill(unsigned char* data, const qint64 size);
+
+    ///
+    /// \brief fill - Function fills QByteArray with cryptographically secure random bytes.
+    /// \param data - Data that will be overwritten with random bytes. Size of data is not changed.
+    ///
+    static void fill(QByteArray& data);
+
+    ///
+    /// \brief generate - Function generates cryptographically secure random bytes.
+    /// \param size - Number of generated bytes.
+    /// \return Returns random bytes.
+    ///
+    [[nodiscard]] static QByteArray generate(const qint64 size);
+};
+} // namespace QSimpleCrypto
+
+#endif // QRANDOMPOOL_H
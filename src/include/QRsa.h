@@ -11,14 +11,29 @@
 
 #include "QSimpleCrypto_global.h"
 
+#include <QBitArray>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QHash>
 #include <QObject>
+#include <QVector>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
+#include <openssl/bio.h>
+#include <openssl/bn.h>
 #include <openssl/err.h>
+#include <openssl/evp.h>
 #include <openssl/pem.h>
 #include <openssl/rsa.h>
+#include <openssl/x509.h>
+
+#include "QBatchRunner.h"
+#include "QRsaKey.h"
 
 namespace QSimpleCrypto {
 class QSIMPLECRYPTO_EXPORT QRsa {
@@ -26,10 +41,21 @@ class QSIMPLECRYPTO_EXPORT QRsa {
 public:
     QRsa();
 
+    ///
+    /// \brief The PrimesBenchmark struct - Timings of RSA keys with one prime count. Times are in nanoseconds.
+    ///
+    struct PrimesBenchmark {
+        quint32 primes = 2;
+        qint64 generateTime = 0; /* One key pair */
+        qint64 signTime = 0; /* One RSA-PSS SHA-256 signature */
+        qint64 decryptTime = 0; /* One RSA-OAEP decryption */
+    };
+
     ///
     /// \brief QSimpleCrypto::QRSA::generateRsaKeys - Function generate Rsa Keys and returns them in OpenSSL structure.
     /// \param bits - RSA key size. For example: 2048, 4096.
-    /// \param rsaBigNumber - The exponent is an odd number, typically 3, 17 or 65537.
+    /// \param exponent - Public exponent. Odd number, typically 65537 (RSA_F4). 3 and 17 are faster to verify, but are not recommended.
+    /// \param primes - Number of primes in modulus. More primes make private key operations faster, because CRT works on smaller numbers.
     ///
     /// \details In order to maintain adequate security level, the maximum number of permitted primes depends on modulus bit length:
     ///
@@ -39,9 +65,43 @@ public:
     ///
     ///          https://www.openssl.org/docs/manmaster/man3/RSA_generate_key_ex.html
     ///
-    /// \return Returns 'OpenSSL EVP RSA structure' or 'nullptr', if error happened. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///          Multi-prime keys are standard (RFC 8017), but some other libraries and hardware tokens can't load them.
+    ///
+    /// \return Returns 'OpenSSL EVP RSA structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* generateRsaKeys(quint32 bits = 2048, quint64 exponent = RSA_F4, quint32 primes = 2);
+
+    ///
+    /// \brief maxPrimes - Function returns maximum number of primes, that OpenSSL permits for modulus bit length.
+    /// \param bits - RSA key size.
+    /// \return Returns number from 2 to 5.
     ///
-    [[nodiscard]] EVP_PKEY* generateRsaKeys(quint32 bits = 2048, quint32 rsaBigNumber = 3);
+    [[nodiscard]] static quint32 maxPrimes(const quint32 bits);
+
+    ///
+    /// \brief benchmarkPrimes - Function measures key generation, signing and decryption of keys with every permitted prime count.
+    /// \param bits - RSA key size. For example: 4096.
+    /// \param iterations - Number of signatures and decryptions measured for every key.
+    /// \details Key generation is measured once per prime count, so its time is rough. Signing and decryption times are averages.
+    /// \return Returns timings for prime counts from 2 to maxPrimes(bits).
+    ///
+    [[nodiscard]] static QVector<PrimesBenchmark> benchmarkPrimes(const quint32 bits = 4096, const qint32 iterations = 32);
+
+    ///
+    /// \brief generateRsaKeysBatch - Function generates many RSA key pairs on several threads and hands out every key as soon as it is ready.
+    /// \param count - Number of key pairs.
+    /// \param bits - RSA key size. For example: 2048, 4096.
+    /// \param exponent - Public exponent. For example: 65537.
+    /// \param callback - Function '(qint64 index, EVP_PKEY* key)', that takes ownership of every key. Calls are serialized, but come from worker threads in completion order.
+    /// \param cancelled - Optional flag. When it is set, threads finish keys in progress and start no new ones.
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \details Threads take next index from shared counter, so slow prime searches don't leave other threads idle.
+    ///          Every key is made by generateRsaKeys(), so batch keys are the same as single keys.
+    ///          First error stops other threads the same way as cancellation and is rethrown after they finish.
+    /// \return Returns number of keys passed to callback.
+    ///
+    qint64 generateRsaKeysBatch(const qint64 count, const quint32 bits, const quint64 exponent, const std::function<void(qint64, EVP_PKEY*)>& callback,
+        const std::atomic<bool>* cancelled = nullptr, const qint32 threadCount = 0);
 
     ///
     /// \brief savePublicKey - Saves to file RSA public key.
@@ -60,20 +120,68 @@ public:
     void savePrivateKey(EVP_PKEY* key, const QByteArray& filePath, QByteArray password = "", const EVP_CIPHER* cipher = nullptr);
 
     ///
-    /// \brief getPublicKeyFromFile - Gets RSA public key from a file.
+    /// \brief savePublicKeyDer - Saves to file public key in DER SubjectPublicKeyInfo format.
+    /// \param key - RSA key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param filePath - Path and file name where the file will be saved. Example: "/root/ca.der"
+    ///
+    void savePublicKeyDer(EVP_PKEY* key, const QByteArray& filePath);
+
+    ///
+    /// \brief savePrivateKeyDer - Saves to file private key in DER PKCS#8 format.
+    /// \param key - RSA key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param filePath - Path and file name where the file will be saved. Example: "/root/ca.der"
+    /// \param password - Private key password. If set, key is saved as encrypted PKCS#8.
+    /// \param cipher - Cipher of encrypted PKCS#8. 'nullptr' means EVP_aes_256_cbc().
+    ///
+    void savePrivateKeyDer(EVP_PKEY* key, const QByteArray& filePath, const QByteArray& password = "", const EVP_CIPHER* cipher = nullptr);
+
+    ///
+    /// \brief publicKeyToDer - Function encodes public key as DER SubjectPublicKeyInfo.
+    /// \param key - RSA or any other key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \return Returns DER bytes.
+    ///
+    [[nodiscard]] QByteArray publicKeyToDer(EVP_PKEY* key);
+
+    ///
+    /// \brief privateKeyToDer - Function encodes private key as DER PKCS#8.
+    /// \param key - RSA or any other key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param password - Private key password. If set, key is encoded as encrypted PKCS#8.
+    /// \param cipher - Cipher of encrypted PKCS#8. 'nullptr' means EVP_aes_256_cbc().
+    /// \return Returns DER bytes.
+    ///
+    [[nodiscard]] QByteArray privateKeyToDer(EVP_PKEY* key, const QByteArray& password = "", const EVP_CIPHER* cipher = nullptr);
+
+    ///
+    /// \brief getPublicKeyFromFile - Gets RSA public key from a PEM or DER file.
     /// \param filePath - File path to public key file.
     /// \return Returns 'OpenSSL EVP_PKEY structure' or 'nullptr', if error happened. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
     ///
     [[nodiscard]] EVP_PKEY* getPublicKeyFromFile(const QByteArray& filePath);
 
     ///
-    /// \brief getPrivateKeyFromFile - Gets RSA private key from a file.
+    /// \brief getPrivateKeyFromFile - Gets RSA private key from a PEM or DER file.
     /// \param filePath - File path to private key file.
-    /// \param password - Private key password.
+    /// \param password - Private key password. Used by encrypted PEM and encrypted DER PKCS#8.
     /// \return Returns 'OpenSSL EVP_PKEY structure' or 'nullptr', if error happened. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
     ///
     [[nodiscard]] EVP_PKEY* getPrivateKeyFromFile(const QByteArray& filePath, const QByteArray& password = "");
 
+    ///
+    /// \brief getPublicKeyFromBuffer - Gets public key from PEM or DER SubjectPublicKeyInfo in memory.
+    /// \param data - Encoded public key. PEM is recognized by "-----BEGIN" prefix, anything else is parsed as DER.
+    /// \details Works for any key type, that OpenSSL can decode. Use QKeyCache, when the same keys are loaded many times.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* getPublicKeyFromBuffer(const QByteArray& data);
+
+    ///
+    /// \brief getPrivateKeyFromBuffer - Gets private key from PEM or DER in memory.
+    /// \param data - Encoded private key. PEM is recognized by "-----BEGIN" prefix, anything else is parsed as DER PKCS#8 or PKCS#1.
+    /// \param password - Private key password. Used by encrypted PEM and encrypted DER PKCS#8.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* getPrivateKeyFromBuffer(const QByteArray& data, const QByteArray& password = "");
+
     ///
     /// \brief encrypt - Encrypt data with RSA algorithm.
     /// \param plaintext - Text that must be encrypted.
@@ -91,6 +199,101 @@ public:
     /// \return Returns encrypted data on success or "" on failure.
     ///
     [[nodiscard]] QByteArray decrypt(QByteArray cipherText, EVP_PKEY* key, const quint16 padding = RSA_PKCS1_OAEP_PADDING);
+
+    ///
+    /// \brief sign - Function hashes data and signs hash with RSA private key.
+    /// \param data - Data that will be signed.
+    /// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+    /// \param md - Hash algorithm (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \details PSS signatures use salt of hash length.
+    /// \return Returns signature.
+    ///
+    [[nodiscard]] QByteArray sign(const QByteArray& data, EVP_PKEY* key, const quint16 padding = RSA_PKCS1_PSS_PADDING, const EVP_MD* md = EVP_sha256());
+
+    ///
+    /// \brief signDigest - Function signs precomputed hash with RSA private key.
+    /// \param digest - Hash of data computed with 'md'.
+    /// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+    /// \param md - Hash algorithm, that digest was computed with (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \return Returns signature.
+    ///
+    [[nodiscard]] QByteArray signDigest(const QByteArray& digest, EVP_PKEY* key, const quint16 padding = RSA_PKCS1_PSS_PADDING, const EVP_MD* md = EVP_sha256());
+
+    ///
+    /// \brief verify - Function hashes data and verifies signature with RSA public key.
+    /// \param data - Signed data.
+    /// \param signature - Signature.
+    /// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+    /// \param md - Hash algorithm (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \details PSS signatures are accepted with any salt length.
+    /// \return Returns 'true' if signature is valid.
+    ///
+    [[nodiscard]] bool verify(const QByteArray& data, const QByteArray& signature, EVP_PKEY* key, const quint16 padding = RSA_PKCS1_PSS_PADDING, const EVP_MD* md = EVP_sha256());
+
+    ///
+    /// \brief verifyDigest - Function verifies signature of precomputed hash with RSA public key.
+    /// \param digest - Hash of signed data computed with 'md'.
+    /// \param signature - Signature.
+    /// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+    /// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+    /// \param md - Hash algorithm, that digest was computed with (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \return Returns 'true' if signature is valid.
+    ///
+    [[nodiscard]] bool verifyDigest(const QByteArray& digest, const QByteArray& signature, EVP_PKEY* key, const quint16 padding = RSA_PKCS1_PSS_PADDING, const EVP_MD* md = EVP_sha256());
+
+    ///
+    /// \brief verifyBatch - Function verifies many (message, signature, key) tuples on several threads.
+    /// \param messages - Arena with all messages stored one after another.
+    /// \param messageOffsets - Offsets of messages in arena. Message 'i' starts at 'messageOffsets[i]' and ends at 'messageOffsets[i + 1]', so size is tuples count plus one.
+    /// \param signatures - Arena with all signatures stored one after another.
+    /// \param signatureOffsets - Offsets of signatures in arena, in the same format.
+    /// \param keys - RSA public key of every tuple. The same key may be used by many tuples. Tuples with null or non RSA key are not valid.
+    /// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+    /// \param md - Hash algorithm (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+    /// \details Every thread initializes verification context once for every distinct key and reuses it for all tuples with that key.
+    /// \return Returns bitmap, where bit 'i' is set if signature 'i' is valid.
+    ///
+    [[nodiscard]] QBitArray verifyBatch(const QByteArray& messages, const QVector<qint64>& messageOffsets, const QByteArray& signatures,
+        const QVector<qint64>& signatureOffsets, const QVector<EVP_PKEY*>& keys, const quint16 padding = RSA_PKCS1_PSS_PADDING,
+        const EVP_MD* md = EVP_sha256(), const qint32 threadCount = 0);
+
+private:
+    ///
+    /// \brief isPem - Function checks, if encoded key is PEM.
+    /// \param data - Encoded key.
+    /// \return Returns 'true' if data starts with PEM boundary, leading whitespace is skipped.
+    ///
+    static bool isPem(const QByteArray& data);
+
+    ///
+    /// \brief writePrivateKeyDer - Function writes private key as DER PKCS#8, encrypted if password is set.
+    /// \param output - Output BIO.
+    /// \param key - Private key.
+    /// \param password - Private key password.
+    /// \param cipher - Cipher of encrypted PKCS#8. 'nullptr' means EVP_aes_256_cbc().
+    ///
+    static void writePrivateKeyDer(BIO* output, EVP_PKEY* key, const QByteArray& password, const EVP_CIPHER* cipher);
+
+    ///
+    /// \brief readFile - Function reads whole key file.
+    /// \param filePath - File path.
+    /// \return Returns file content.
+    ///
+    static QByteArray readFile(const QByteArray& filePath);
+
+    ///
+    /// \brief digest - Function hashes data.
+    /// \param data - Pointer to data.
+    /// \param size - Size of data.
+    /// \param md - Hash algorithm.
+    /// \param output - Output buffer with at least EVP_MAX_MD_SIZE bytes.
+    /// \return Returns hash size.
+    ///
+    static quint32 digest(const char* data, const qint64 size, const EVP_MD* md, unsigned char* output);
 };
 } // namespace QSimpleCrypto
 
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QRSAKEY_H
+#define QRSAKEY_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QRsaKey class - RSA key handle, that keeps ready contexts for encryption, decryption, signing and verification.
+/// \details Handle owns EVP_PKEY. Every operation has template context with operation, padding and hash already set up.
+///          Calls borrow copy of template from pool and give it back, so hot path runs no initialization and allocates no context.
+///          Pool is split to shards picked by thread id, so threads rarely wait for each other. All functions are thread safe.
+///
+class QSIMPLECRYPTO_EXPORT QRsaKey {
+
+///
+/// \brief rsaKeyPoolShards - Number of pool shards. Must be power of two.
+///
+#define rsaKeyPoolShards 16
+
+///
+/// \brief rsaKeyPoolShardSize - Number of idle contexts that one shard keeps for one operation. Further contexts are freed.
+///
+#define rsaKeyPoolShardSize 4
+
+public:
+    ///
+    /// \brief The Operation enum - Operation of pooled context.
+    ///
+    enum class Operation {
+        Encrypt,
+        Decrypt,
+        Sign,
+        Verify
+    };
+
+    ///
+    /// \brief QRsaKey - Takes ownership of key and prepares template contexts.
+    /// \param key - RSA key. Must be provided with not null EVP_PKEY OpenSSL struct. Freed by handle.
+    /// \param encryptionPadding - OpenSSL RSA padding for encryption: 'RSA_PKCS1_OAEP_PADDING', 'RSA_PKCS1_PADDING' or 'RSA_NO_PADDING'.
+    /// \param md - Hash algorithm for OAEP and signatures (OpenSSL EVP_MD). Example: EVP_sha256().
+    /// \param signaturePadding - OpenSSL RSA padding for signatures: 'RSA_PKCS1_PSS_PADDING' or 'RSA_PKCS1_PADDING'.
+    /// \details Decryption and signing fail at call time, if key has no private part.
+    ///          If constructor throws, key is not taken and must be freed by caller.
+    ///
+    explicit QRsaKey(EVP_PKEY* key, const qint32 encryptionPadding = RSA_PKCS1_OAEP_PADDING, const EVP_MD* md = EVP_sha256(),
+        const qint32 signaturePadding = RSA_PKCS1_PSS_PADDING);
+
+    ///
+    /// \brief ~QRsaKey - Frees pooled contexts and key. No call may be running.
+    ///
+    ~QRsaKey();
+
+    QRsaKey(const QRsaKey&) = delete;
+    QRsaKey& operator=(const QRsaKey&) = delete;
+
+    ///
+    /// \brief key - Function returns owned key.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Stays owned by handle.
+    ///
+    [[nodiscard]] EVP_PKEY* key() const;
+
+    ///
+    /// \brief size - Function returns size of modulus, cipher text and signature.
+    /// \return Returns size in bytes.
+    ///
+    [[nodiscard]] qint32 size() const;
+
+    ///
+    /// \brief encrypt - Function encrypts data with public key.
+    /// \param plainText - Data that will be encrypted. Size is limited by key size and padding.
+    /// \return Returns encrypted data.
+    ///
+    [[nodiscard]] QByteArray encrypt(const QByteArray& plainText) const;
+
+    ///
+    /// \brief decrypt - Function decrypts data with private key.
+    /// \param cipherText - Data that will be decrypted.
+    /// \return Returns decrypted data.
+    ///
+    [[nodiscard]] QByteArray decrypt(const QByteArray& cipherText) const;
+
+    ///
+    /// \brief sign - Function hashes data and signs hash with private key.
+    /// \param data - Data that will be signed.
+    /// \return Returns signature.
+    ///
+    [[nodiscard]] QByteArray sign(const QByteArray& data) const;
+
+    ///
+    /// \brief signDigest - Function signs hash, that was already computed with key hash algorithm.
+    /// \param digest - Hash of data.
+    /// \return Returns signature.
+    ///
+    [[nodiscard]] QByteArray signDigest(const QByteArray& digest) const;
+
+    ///
+    /// \brief verify - Function hashes data and verifies signature with public key.
+    /// \param data - Signed data.
+    /// \param signature - Signature.
+    /// \return Returns 'true' if signature is valid.
+    ///
+    [[nodiscard]] bool verify(const QByteArray& data, const QByteArray& signature) const;
+
+    ///
+    /// \brief verifyDigest - Function verifies signature of hash, that was already computed with key hash algorithm.
+    /// \param digest - Hash of signed data.
+    /// \param signature - Signature.
+    /// \return Returns 'true' if signature is valid.
+    ///
+    [[nodiscard]] bool verifyDigest(const QByteArray& digest, const QByteArray& signature) const;
+
+    ///
+    /// \brief createContext - Function creates context with initialized operation, padding and hash.
+    /// \param key - RSA key.
+    /// \param operation - Operation.
+    /// \param padding - OpenSSL RSA padding.
+    /// \param md - Hash algorithm for OAEP and signatures.
+    /// \details Used for handle templates and for single operations of QRsa, so both set up contexts the same way.
+    /// \return Returns context. Must be cleaned up with 'EVP_PKEY_CTX_free()'.
+    ///
+    [[nodiscard]] static EVP_PKEY_CTX* createContext(EVP_PKEY* key, const Operation operation, const qint32 padding, const EVP_MD* md);
+
+private:
+    ///
+    /// \brief The Lease class - Borrowed context, that goes back to pool when lease is destroyed.
+    ///
+    class Lease {
+    public:
+        Lease(const QRsaKey* owner, const Operation operation);
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        EVP_PKEY_CTX* get() const { return m_context; }
+
+    private:
+        const QRsaKey* m_owner;
+        Operation m_operation;
+        EVP_PKEY_CTX* m_context;
+    };
+
+    ///
+    /// \brief The Shard struct - Idle contexts of threads, that map to the same shard.
+    ///
+    struct Shard {
+        std::mutex mutex;
+        std::vector<EVP_PKEY_CTX*> idle[4];
+    };
+
+    ///
+    /// \brief borrow - Function takes idle context from shard of calling thread, or copies template.
+    /// \param operation - Operation.
+    /// \return Returns ready context.
+    ///
+    EVP_PKEY_CTX* borrow(const Operation operation) const;
+
+    ///
+    /// \brief release - Function puts context back to shard of calling thread, or frees it when shard is full.
+    /// \param operation - Operation.
+    /// \param context - Context returned by borrow().
+    ///
+    void release(const Operation operation, EVP_PKEY_CTX* context) const;
+
+    ///
+    /// \brief shard - Function returns shard of calling thread.
+    /// \return Returns shard.
+    ///
+    Shard& shard() const;
+
+    ///
+    /// \brief digest - Function hashes data with key hash algorithm.
+    /// \param data - Data.
+    /// \return Returns hash.
+    ///
+    QByteArray digest(const QByteArray& data) const;
+
+    std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY*)> m_key { nullptr, EVP_PKEY_free };
+    const EVP_MD* m_md;
+    std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> m_templates[4] {
+        { nullptr, EVP_PKEY_CTX_free }, { nullptr, EVP_PKEY_CTX_free }, { nullptr, EVP_PKEY_CTX_free }, { nullptr, EVP_PKEY_CTX_free }
+    };
+    std::unique_ptr<Shard[]> m_shards;
+};
+} // namespace QSimpleCrypto
+
+#endif // QRSAKEY_H
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#ifndef QRSAKEYPOOL_H
+#define QRSAKEYPOOL_H
+
+#include "QSimpleCrypto_global.h"
+
+#include <QObject>
+#include <QThread>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <openssl/bn.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+
+#include "QRsa.h"
+
+namespace QSimpleCrypto {
+
+///
+/// \brief The QRsaKeyPool class - Pool of pre-generated RSA key pairs, that is refilled on low priority background threads.
+/// \details Pool keeps keys for every (bits, exponent) that was reserved or taken. When number of ready keys falls to low watermark,
+///          workers generate keys until target size is reached again. When pool of requested size is empty, key is generated
+///          on calling thread, so take() never waits for workers. Every key is handed out once. All functions are thread safe.
+///
+class QSIMPLECRYPTO_EXPORT QRsaKeyPool {
+
+///
+/// \brief rsaKeyPoolTargetSize - Default number of ready keys, that pool keeps for every key size.
+///
+#define rsaKeyPoolTargetSize 8
+
+///
+/// \brief rsaKeyPoolLowWatermark - Default number of ready keys, at which refill starts.
+///
+#define rsaKeyPoolLowWatermark 2
+
+public:
+    ///
+    /// \brief The Metrics struct - Snapshot of pool state.
+    ///
+    struct Metrics {
+        qint64 available = 0; /* Ready keys of all sizes */
+        qint64 generating = 0; /* Keys being generated by workers */
+        qint64 hits = 0; /* Keys taken from pool */
+        qint64 misses = 0; /* Keys generated on calling thread, because pool was empty */
+        qint64 generated = 0; /* Keys generated by workers */
+        qint64 failures = 0; /* Failed background generations */
+    };
+
+    ///
+    /// \brief QRsaKeyPool - Starts worker threads with lowered priority.
+    /// \param targetSize - Number of ready keys, that pool keeps for every (bits, exponent).
+    /// \param lowWatermark - Number of ready keys, at which refill starts. Must be lower than target size.
+    /// \param workerCount - Number of worker threads. '0' means QThread::idealThreadCount().
+    ///
+    QRsaKeyPool(const qint32 targetSize = rsaKeyPoolTargetSize, const qint32 lowWatermark = rsaKeyPoolLowWatermark, const qint32 workerCount = 0);
+
+    ///
+    /// \brief ~QRsaKeyPool - Waits for generations in progress and frees ready keys.
+    ///
+    ~QRsaKeyPool();
+
+    QRsaKeyPool(const QRsaKeyPool&) = delete;
+    QRsaKeyPool& operator=(const QRsaKeyPool&) = delete;
+
+    ///
+    /// \brief reserve - Function starts filling pool with keys of given size, so first take() doesn't wait for generation.
+    /// \param bits - RSA key size. For example: 2048, 4096.
+    /// \param exponent - Public exponent. For example: 65537.
+    ///
+    void reserve(const quint32 bits, const quint64 exponent = RSA_F4);
+
+    ///
+    /// \brief take - Function hands out ready key pair, or generates it on calling thread when pool is empty.
+    /// \param bits - RSA key size. For example: 2048, 4096.
+    /// \param exponent - Public exponent. For example: 65537.
+    /// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+    ///
+    [[nodiscard]] EVP_PKEY* take(const quint32 bits, const quint64 exponent = RSA_F4);
+
+    ///
+    /// \brief available - Function returns number of ready keys of given size.
+    /// \param bits - RSA key size.
+    /// \param exponent - Public exponent.
+    /// \return Returns number of ready keys.
+    ///
+    [[nodiscard]] qint64 available(const quint32 bits, const quint64 exponent = RSA_F4) const;
+
+    ///
+    /// \brief metrics - Function returns number of ready keys and counters.
+    /// \return Returns metrics snapshot.
+    ///
+    [[nodiscard]] Metrics metrics() const;
+
+private:
+    ///
+    /// \brief The Entry struct - Ready keys of one (bits, exponent).
+    ///
+    struct Entry {
+        std::deque<EVP_PKEY*> keys;
+        qint32 generating = 0;
+        bool refilling = false; /* Set at low watermark, cleared at target size */
+    };
+
+    ///
+    /// \brief entry - Function returns entry of given size, creating it if needed. Must be called with m_mutex locked.
+    /// \param bits - RSA key size.
+    /// \param exponent - Public exponent.
+    /// \return Returns entry.
+    ///
+    Entry& entry(const quint32 bits, const quint64 exponent);
+
+    ///
+    /// \brief work - Worker thread function.
+    ///
+    void work();
+
+    qint32 m_targetSize;
+    qint32 m_lowWatermark;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::map<std::pair<quint32, quint64>, Entry> m_entries;
+    bool m_stopped = false;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+    qint64 m_generated = 0;
+    qint64 m_failures = 0;
+
+    std::vector<std::thread> m_workers;
+};
+} // namespace QSimpleCrypto
+
+#endif // QRSAKEYPOOL_H
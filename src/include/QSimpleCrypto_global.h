@@ -9,4 +9,10 @@
 #  define QSIMPLECRYPTO_EXPORT Q_DECL_IMPORT
 #endif
 
+///
+/// \brief fileMapWindowSize - Size of memory mapped window used by file encryption functions.
+/// \details Input and output files are mapped and processed by windows of that size, so memory usage doesn't depend on file size.
+///
+#define fileMapWindowSize (64 * 1024 * 1024)
+
 #endif // QSIMPLECRYPTO_GLOBAL_H
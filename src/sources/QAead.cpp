@@ -8,10 +8,22 @@
 
 #include "include/QAead.h"
 
+#include <cstring>
+
 QSimpleCrypto::QAead::QAead()
 {
 }
 
+///
+/// \brief QSimpleCrypto::QAead::generateNonce - Function generates random nonce (initialization vector) for AEAD ciphers.
+/// \param size - Nonce size in bytes. Example: 12 for GCM.
+/// \return Returns nonce (random bytes).
+///
+QByteArray QSimpleCrypto::QAead::generateNonce(const quint16& size)
+{
+    return QRandomPool::generate(size);
+}
+
 ///
 /// \brief QSimpleCrypto::QAead::encryptAesGcm - Function encrypts data with AES GCM algorithm.
 /// \param data - Data that will be encrypted.
@@ -25,12 +37,6 @@ QSimpleCrypto::QAead::QAead()
 QByteArray QSimpleCrypto::QAead::encryptAesGcm(const QByteArray& data, const QByteArray& key, const QByteArray& iv, const QByteArray& tag, const QByteArray& aad, const EVP_CIPHER* cipher)
 {
     try {
-        /* Initialize EVP_CIPHER_CTX */
-        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> encryptionCipher { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
-        if (!encryptionCipher) {
-            throw std::runtime_error("Couldn't initialize \'encryptionCipher\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
         /* Set data length */
         qint32 plainTextLength = data.size();
         qint32 cipherTextLength = 0;
@@ -41,23 +47,8 @@ QByteArray QSimpleCrypto::QAead::encryptAesGcm(const QByteArray& data, const QBy
             throw std::runtime_error("Couldn't allocate memory for 'ciphertext'.");
         }
 
-        /* Initialize encryption operation. */
-        if (!EVP_EncryptInit_ex(encryptionCipher.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()))) {
-            throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
-        /* Set IV length if default 12 bytes (96 bits) is not appropriate */
-        if (!EVP_CIPHER_CTX_ctrl(encryptionCipher.get(), EVP_CTRL_GCM_SET_IVLEN, iv.length(), nullptr)) {
-            throw std::runtime_error("Couldn't set IV length. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
-        /* Check if aad need to be used */
-        if (!aad.isEmpty()) {
-            /* Provide any AAD data. This can be called zero or more times as required */
-            if (!EVP_EncryptUpdate(encryptionCipher.get(), nullptr, &cipherTextLength, reinterpret_cast<const unsigned char*>(aad.data()), aad.length())) {
-                throw std::runtime_error("Couldn't provide aad data. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-            }
-        }
+        /* Initialize encryption operation with key, IV and aad */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> encryptionCipher = QGcm::createContext(cipher, key, iv, aad, true);
 
         /*
          * Provide the message to be encrypted, and obtain the encrypted output.
@@ -67,18 +58,8 @@ QByteArray QSimpleCrypto::QAead::encryptAesGcm(const QByteArray& data, const QBy
             throw std::runtime_error("Couldn't provide message to be encrypted. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        /*
-         * Finalize the encryption. Normally cipher text bytes may be written at
-         * this stage, but this does not occur in GCM mode
-         */
-        if (!EVP_EncryptFinal_ex(encryptionCipher.get(), cipherText.get(), &plainTextLength)) {
-            throw std::runtime_error("Couldn't finalize encryption. EVP_EncryptFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
-        /* Get tag */
-        if (!EVP_CIPHER_CTX_ctrl(encryptionCipher.get(), EVP_CTRL_GCM_GET_TAG, tag.length(), static_cast<void*>(const_cast<char*>(tag.constData())))) {
-            throw std::runtime_error("Couldn't get tag. EVP_CIPHER_CTX_ctrl(. Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
+        /* Finalize the encryption and get tag */
+        QGcm::finalize(encryptionCipher.get(), cipherText.get(), &plainTextLength, const_cast<char*>(tag.constData()), tag.length());
 
         /* Finilize data to be readable with qt */
         return QByteArray(reinterpret_cast<char*>(cipherText.get()), cipherTextLength);
@@ -102,12 +83,6 @@ QByteArray QSimpleCrypto::QAead::encryptAesGcm(const QByteArray& data, const QBy
 QByteArray QSimpleCrypto::QAead::decryptAesGcm(const QByteArray& data, const QByteArray& key, const QByteArray& iv, const QByteArray& tag, const QByteArray& aad, const EVP_CIPHER* cipher)
 {
     try {
-        /* Initialize EVP_CIPHER_CTX */
-        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> decryptionCipher { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
-        if (!decryptionCipher.get()) {
-            throw std::runtime_error("Couldn't initialize \'decryptionCipher\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
         /* Set data length */
         qint32 cipherTextLength = data.size();
         qint32 plainTextLength = 0;
@@ -118,23 +93,8 @@ QByteArray QSimpleCrypto::QAead::decryptAesGcm(const QByteArray& data, const QBy
             throw std::runtime_error("Couldn't allocate memory for 'plaintext'.");
         }
 
-        /* Initialize decryption operation. */
-        if (!EVP_DecryptInit_ex(decryptionCipher.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()))) {
-            throw std::runtime_error("Couldn't initialize decryption operation. EVP_DecryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
-        /* Set IV length. Not necessary if this is 12 bytes (96 bits) */
-        if (!EVP_CIPHER_CTX_ctrl(decryptionCipher.get(), EVP_CTRL_GCM_SET_IVLEN, iv.length(), nullptr)) {
-            throw std::runtime_error("Couldn't set IV length. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
-        /* Check if aad need to be used */
-        if (!aad.isEmpty()) {
-            /* Provide any AAD data. This can be called zero or more times as required */
-            if (!EVP_DecryptUpdate(decryptionCipher.get(), nullptr, &plainTextLength, reinterpret_cast<const unsigned char*>(aad.data()), aad.length())) {
-                throw std::runtime_error("Couldn't provide aad data. EVP_DecryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-            }
-        }
+        /* Initialize decryption operation with key, IV and aad */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> decryptionCipher = QGcm::createContext(cipher, key, iv, aad, false);
 
         /*
          * Provide the message to be decrypted, and obtain the plain text output.
@@ -144,18 +104,11 @@ QByteArray QSimpleCrypto::QAead::decryptAesGcm(const QByteArray& data, const QBy
             throw std::runtime_error("Couldn't provide message to be decrypted. EVP_DecryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        /* Set expected tag value. Works in OpenSSL 1.0.1d and later */
-        if (!EVP_CIPHER_CTX_ctrl(decryptionCipher.get(), EVP_CTRL_GCM_SET_TAG, tag.length(), static_cast<void*>(const_cast<char*>(tag.constData())))) {
-            throw std::runtime_error("Coldn't set tag. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
-
         /*
-         * Finalize the decryption. A positive return value indicates success,
-         * anything else is a failure - the plain text is not trustworthy.
+         * Set expected tag and finalize the decryption. Failure means that
+         * the plain text is not trustworthy.
          */
-        if (!EVP_DecryptFinal_ex(decryptionCipher.get(), plainText.get(), &cipherTextLength)) {
-            throw std::runtime_error("Couldn't finalize decryption. EVP_DecryptFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
-        }
+        QGcm::finalize(decryptionCipher.get(), plainText.get(), &cipherTextLength, const_cast<char*>(tag.constData()), tag.length());
 
         /* Finilize data to be readable with qt */
         return QByteArray(reinterpret_cast<char*>(plainText.get()), plainTextLength);
@@ -334,3 +287,443 @@ QByteArray QSimpleCrypto::QAead::decryptAesCcm(const QByteArray& data, const QBy
         throw;
     }
 }
+
+///
+/// \brief QSimpleCrypto::QAead::encryptFileAesGcm - Function encrypts file with AES GCM algorithm and writes result to another file.
+/// \param inputFilePath - Path to file that will be encrypted.
+/// \param outputFilePath - Path to file where encrypted data will be saved. File will be overwritten.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGG"
+/// \param tag - Authorization tag. Tag length is taken from its size and computed tag is written into it. Example: QByteArray(16, 0).
+/// \param aad - Additional authenticated data.
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+/// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+/// \return Returns 'true' on success. Output file is left untouched on failure.
+///
+bool QSimpleCrypto::QAead::encryptFileAesGcm(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv, QByteArray& tag,
+    const QByteArray& aad, const EVP_CIPHER* cipher, const qint64 windowSize)
+{
+    try {
+        /* Initialize encryption operation with key, IV and aad */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> encryptionCipher = QGcm::createContext(cipher, key, iv, aad, true);
+
+        return transformFile(encryptionCipher.get(), inputFilePath, outputFilePath, tag, windowSize);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QAead::decryptFileAesGcm - Function decrypts file with AES GCM algorithm and writes result to another file.
+/// \param inputFilePath - Path to file that will be decrypted.
+/// \param outputFilePath - Path to file where decrypted data will be saved. File is replaced only after tag is verified.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGG"
+/// \param tag - Authorization tag received from encryptFileAesGcm.
+/// \param aad - Additional authenticated data.
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+/// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+/// \return Returns 'true' on success. Output file is left untouched on failure, including tag mismatch.
+///
+bool QSimpleCrypto::QAead::decryptFileAesGcm(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv, const QByteArray& tag,
+    const QByteArray& aad, const EVP_CIPHER* cipher, const qint64 windowSize)
+{
+    try {
+        /* Initialize decryption operation with key, IV and aad */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> decryptionCipher = QGcm::createContext(cipher, key, iv, aad, false);
+
+        QByteArray expectedTag(tag);
+        return transformFile(decryptionCipher.get(), inputFilePath, outputFilePath, expectedTag, windowSize);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QAead::transformFile - Function runs initialized GCM context over memory mapped windows of input file.
+/// \param context - Initialized OpenSSL EVP_CIPHER_CTX with iv and aad already provided.
+/// \param inputFilePath - Path to source file.
+/// \param outputFilePath - Path to destination file. Result is written to "<outputFilePath>.part" and renamed over destination on success.
+/// \param tag - Tag that is written (encryption) or checked (decryption) before finalization.
+/// \param windowSize - Size of memory mapped window.
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QAead::transformFile(EVP_CIPHER_CTX* context, const QByteArray& inputFilePath, const QByteArray& outputFilePath, QByteArray& tag, const qint64 windowSize)
+{
+    /* Open files */
+    QFile inputFile(inputFilePath);
+    if (!inputFile.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Couldn't open input file. QFile::open(). Error: " + inputFile.errorString().toUtf8());
+    }
+
+    /* Output goes to file next to destination, that replaces destination only after tag is computed or verified */
+    const QString partialPath = QString::fromUtf8(outputFilePath) + ".part";
+    QFile outputFile(partialPath);
+    if (!outputFile.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        throw std::runtime_error("Couldn't open output file. QFile::open(). Error: " + outputFile.errorString().toUtf8());
+    }
+
+    try {
+        if (windowSize <= 0 || windowSize > std::numeric_limits<qint32>::max()) {
+            throw std::runtime_error("Window size must be positive and fit into 32 bit integer.");
+        }
+
+        /* GCM output has exactly the same length as input, so output file is sized once */
+        const qint64 inputSize = inputFile.size();
+        if (!outputFile.resize(inputSize)) {
+            throw std::runtime_error("Couldn't resize output file. QFile::resize(). Error: " + outputFile.errorString().toUtf8());
+        }
+
+        for (qint64 offset = 0; offset < inputSize;) {
+            const qint64 length = qMin(windowSize, inputSize - offset);
+
+            /* Map current windows. Pages are unmapped right after processing to keep memory usage flat */
+            uchar* inputWindow = inputFile.map(offset, length);
+            if (!inputWindow) {
+                throw std::runtime_error("Couldn't map input file. QFile::map(). Error: " + inputFile.errorString().toUtf8());
+            }
+
+            uchar* outputWindow = outputFile.map(offset, length);
+            if (!outputWindow) {
+                inputFile.unmap(inputWindow);
+                throw std::runtime_error("Couldn't map output file. QFile::map(). Error: " + outputFile.errorString().toUtf8());
+            }
+
+            qint32 processedLength = 0;
+            const bool updated = EVP_CipherUpdate(context, outputWindow, &processedLength, inputWindow, static_cast<qint32>(length));
+
+            inputFile.unmap(inputWindow);
+            outputFile.unmap(outputWindow);
+
+            if (!updated) {
+                throw std::runtime_error("Couldn't provide file window to cipher. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            offset += length;
+        }
+
+        /* Finalize the operation. Tag is written on encryption and checked on decryption */
+        unsigned char finalBlock[EVP_MAX_BLOCK_LENGTH];
+        qint32 finalLength = 0;
+
+        QGcm::finalize(context, finalBlock, &finalLength, tag.data(), tag.length());
+
+        /* Data must reach storage before rename, otherwise crash can leave destination with missing pages */
+        QFileSync::syncData(outputFile);
+        outputFile.close();
+
+        if (!QFileSync::replaceFile(partialPath, QString::fromUtf8(outputFilePath))) {
+            throw std::runtime_error("Couldn't replace output file. QFileSync::replaceFile().");
+        }
+
+        return true;
+    } catch (...) {
+        outputFile.remove();
+        throw;
+    }
+}
+
+namespace {
+///
+/// \brief createGcmContext - Function creates GCM context with key schedule already initialized.
+/// \param key - AES key.
+/// \param cipher - OpenSSL EVP_CIPHER (gcm).
+/// \param encrypt - 'true' for encryption and 'false' for decryption.
+/// \return Returns initialized context. Nonce must be set before every message.
+///
+std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> createGcmContext(const QByteArray& key, const EVP_CIPHER* cipher, const bool encrypt)
+{
+    if (key.size() != EVP_CIPHER_get_key_length(cipher)) {
+        throw std::runtime_error("Key size doesn't match cipher key length.");
+    }
+
+    /* Nonce has default length and is set before every value */
+    return QSimpleCrypto::QGcm::createContext(cipher, key, QByteArray(), QByteArray(), encrypt);
+}
+
+///
+/// \brief transformGcmValue - Function encrypts or decrypts one value with initialized GCM context.
+/// \param context - Context returned by createGcmContext.
+/// \param nonce - Pointer to aeadBatchNonceLength bytes nonce.
+/// \param aad - Additional authenticated data.
+/// \param data - Input data.
+/// \param size - Size of input data.
+/// \param output - Output buffer with at least 'size' bytes.
+/// \param tag - Pointer to aeadBatchTagLength bytes tag. Written on encryption and checked on decryption.
+///
+void transformGcmValue(EVP_CIPHER_CTX* context, const unsigned char* nonce, const QByteArray& aad, const unsigned char* data, const qint32 size, unsigned char* output, unsigned char* tag)
+{
+    qint32 length = 0;
+
+    /* Reset operation with new nonce. Key schedule stays untouched */
+    QSimpleCrypto::QGcm::setIv(context, nonce);
+    QSimpleCrypto::QGcm::provideAad(context, aad);
+
+    if (!EVP_CipherUpdate(context, output, &length, data, size)) {
+        throw std::runtime_error("Couldn't provide message to cipher. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    QSimpleCrypto::QGcm::finalize(context, output + length, &length, tag, aeadBatchTagLength);
+}
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QAead::encryptAesGcmBatch - Function encrypts column of values with AES GCM algorithm.
+/// \param values - Arena with all values stored one after another.
+/// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+/// \param resultOffsets - Offsets of encrypted values in returned arena, in the same format.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param aad - Additional authenticated data, shared by all values. Example: column name.
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with encrypted values.
+///
+QByteArray QSimpleCrypto::QAead::encryptAesGcmBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& key, const QByteArray& aad, const EVP_CIPHER* cipher, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > values.size()) {
+            throw std::runtime_error("Offsets don't describe values arena.");
+        }
+
+        /* Sizes of encrypted values are known in advance, so output is allocated once */
+        const qint64 count = offsets.size() - 1;
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < 0 || length > std::numeric_limits<qint32>::max()) {
+                throw std::runtime_error("Offsets must be non-decreasing and value size must fit into 32 bit integer.");
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + aeadBatchNonceLength + length + aeadBatchTagLength;
+        }
+
+        QByteArray result(resultOffsets.last(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(values.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+
+        QBatchRunner::run(count, QBatchRunner::threadCount(threadCount, count), [&](const qint64 begin, const qint64 end) {
+            /* Key schedule is initialized once per thread */
+            auto context = createGcmContext(key, cipher, true);
+
+            for (qint64 i = begin; i < end; ++i) {
+                const qint32 length = static_cast<qint32>(offsets[i + 1] - offsets[i]);
+
+                /* Every value gets own random nonce, stored in front of cipher text */
+                unsigned char* nonce = output + resultOffsets[i];
+                QRandomPool::fill(nonce, aeadBatchNonceLength);
+
+                transformGcmValue(context.get(), nonce, aad, input + offsets[i], length, nonce + aeadBatchNonceLength, nonce + aeadBatchNonceLength + length);
+            }
+        });
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QAead::decryptAesGcmBatch - Function decrypts column of values encrypted with encryptAesGcmBatch.
+/// \param values - Arena with all encrypted values stored one after another.
+/// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+/// \param resultOffsets - Offsets of decrypted values in returned arena, in the same format.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param aad - Additional authenticated data, shared by all values. Example: column name.
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with decrypted values. Throws, if any tag doesn't match.
+///
+QByteArray QSimpleCrypto::QAead::decryptAesGcmBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& key, const QByteArray& aad, const EVP_CIPHER* cipher, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > values.size()) {
+            throw std::runtime_error("Offsets don't describe values arena.");
+        }
+
+        /* Plain text size is cipher text size without nonce and tag, so output is allocated once */
+        const qint64 count = offsets.size() - 1;
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < aeadBatchNonceLength + aeadBatchTagLength || length > std::numeric_limits<qint32>::max()) {
+                throw std::runtime_error("Encrypted value is shorter than nonce and tag or doesn't fit into 32 bit integer.");
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + length - aeadBatchNonceLength - aeadBatchTagLength;
+        }
+
+        QByteArray result(resultOffsets.last(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(values.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+
+        QBatchRunner::run(count, QBatchRunner::threadCount(threadCount, count), [&](const qint64 begin, const qint64 end) {
+            /* Key schedule is initialized once per thread */
+            auto context = createGcmContext(key, cipher, false);
+
+            for (qint64 i = begin; i < end; ++i) {
+                const qint32 length = static_cast<qint32>(resultOffsets[i + 1] - resultOffsets[i]);
+                const unsigned char* nonce = input + offsets[i];
+
+                /* Tag is copied, because OpenSSL expects writable buffer */
+                unsigned char tag[aeadBatchTagLength];
+                std::memcpy(tag, nonce + aeadBatchNonceLength + length, aeadBatchTagLength);
+
+                transformGcmValue(context.get(), nonce, aad, nonce + aeadBatchNonceLength, length, output + resultOffsets[i], tag);
+            }
+        });
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QAead::encryptAesSiv - Function encrypts data with deterministic AES-SIV algorithm (RFC 5297).
+/// \param data - Data that will be encrypted.
+/// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+/// \param aad - Additional authenticated data. Example: column name.
+/// \return Returns 16 bytes synthetic IV followed by cipher text.
+///
+QByteArray QSimpleCrypto::QAead::encryptAesSiv(const QByteArray& data, const QByteArray& key, const QByteArray& aad)
+{
+    return QKeyedAesSiv(key).encrypt(data, aad);
+}
+
+///
+/// \brief QSimpleCrypto::QAead::decryptAesSiv - Function decrypts data encrypted with AES-SIV algorithm (RFC 5297).
+/// \param data - Synthetic IV followed by cipher text.
+/// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+/// \param aad - Additional authenticated data. Example: column name.
+/// \return Returns decrypted data. Throws, if authentication fails.
+///
+QByteArray QSimpleCrypto::QAead::decryptAesSiv(const QByteArray& data, const QByteArray& key, const QByteArray& aad)
+{
+    return QKeyedAesSiv(key).decrypt(data, aad);
+}
+
+///
+/// \brief QSimpleCrypto::QAead::encryptAesSivBatch - Function encrypts column of values with deterministic AES-SIV algorithm.
+/// \param values - Arena with all values stored one after another.
+/// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+/// \param resultOffsets - Offsets of encrypted values in returned arena, in the same format.
+/// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+/// \param aad - Additional authenticated data, shared by all values. Example: column name.
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with encrypted values.
+///
+QByteArray QSimpleCrypto::QAead::encryptAesSivBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& key, const QByteArray& aad, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > values.size()) {
+            throw std::runtime_error("Offsets don't describe values arena.");
+        }
+
+        /* Sizes of encrypted values are known in advance, so output is allocated once */
+        const qint64 count = offsets.size() - 1;
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < 0 || length > std::numeric_limits<qint32>::max()) {
+                throw std::runtime_error("Offsets must be non-decreasing and value size must fit into 32 bit integer.");
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + aesSivTagLength + length;
+        }
+
+        QByteArray result(resultOffsets.last(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(values.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+
+        /* Key is expanded once, every thread gets a copy of it */
+        QKeyedAesSiv keyedCipher(key);
+        const qint32 threads = QBatchRunner::threadCount(threadCount, count);
+
+        QBatchRunner::run(count, threads, [&](const qint64 begin, const qint64 end) {
+            QKeyedAesSiv localCipher = (threads > 1) ? keyedCipher.clone() : std::move(keyedCipher);
+
+            for (qint64 i = begin; i < end; ++i) {
+                localCipher.encrypt(input + offsets[i], static_cast<qint32>(offsets[i + 1] - offsets[i]), output + resultOffsets[i], aad);
+            }
+        });
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QAead::decryptAesSivBatch - Function decrypts column of values encrypted with encryptAesSivBatch.
+/// \param values - Arena with all encrypted values stored one after another.
+/// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+/// \param resultOffsets - Offsets of decrypted values in returned arena, in the same format.
+/// \param key - AES-SIV key. 32, 48 or 64 bytes for AES-128-SIV, AES-192-SIV and AES-256-SIV.
+/// \param aad - Additional authenticated data, shared by all values. Example: column name.
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with decrypted values. Throws, if any value fails authentication.
+///
+QByteArray QSimpleCrypto::QAead::decryptAesSivBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& key, const QByteArray& aad, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > values.size()) {
+            throw std::runtime_error("Offsets don't describe values arena.");
+        }
+
+        /* Plain text size is cipher text size without synthetic IV, so output is allocated once */
+        const qint64 count = offsets.size() - 1;
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < aesSivTagLength || length > std::numeric_limits<qint32>::max()) {
+                throw std::runtime_error("Encrypted value is shorter than synthetic IV or doesn't fit into 32 bit integer.");
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + length - aesSivTagLength;
+        }
+
+        QByteArray result(resultOffsets.last(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(values.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+
+        /* Key is expanded once, every thread gets a copy of it */
+        QKeyedAesSiv keyedCipher(key);
+        const qint32 threads = QBatchRunner::threadCount(threadCount, count);
+
+        QBatchRunner::run(count, threads, [&](const qint64 begin, const qint64 end) {
+            QKeyedAesSiv localCipher = (threads > 1) ? keyedCipher.clone() : std::move(keyedCipher);
+
+            for (qint64 i = begin; i < end; ++i) {
+                localCipher.decrypt(input + offsets[i], static_cast<qint32>(offsets[i + 1] - offsets[i]), output + resultOffsets[i], aad);
+            }
+        });
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
@@ -8,6 +8,8 @@
 
 #include "include/QBlockCipher.h"
 
+#include <cstring>
+
 QSimpleCrypto::QBlockCipher::QBlockCipher()
 {
 }
@@ -19,10 +21,27 @@ QSimpleCrypto::QBlockCipher::QBlockCipher()
 ///
 QByteArray QSimpleCrypto::QBlockCipher::generateSalt(const quint16& size)
 {
-    unsigned char arr[sizeof(size)];
-    RAND_bytes(arr, sizeof(size));
+    return QRandomPool::generate(size);
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::generateKey - Function generates random AES key.
+/// \param size - Key size in bytes. Example: 16, 24, 32.
+/// \return Returns key (random bytes).
+///
+QByteArray QSimpleCrypto::QBlockCipher::generateKey(const quint16& size)
+{
+    return QRandomPool::generate(size);
+}
 
-    return QByteArray(reinterpret_cast<char*>(arr), size);
+///
+/// \brief QSimpleCrypto::QBlockCipher::generateIv - Function generates random initialization vector.
+/// \param size - IV size in bytes. Example: 16.
+/// \return Returns initialization vector (random bytes).
+///
+QByteArray QSimpleCrypto::QBlockCipher::generateIv(const quint16& size)
+{
+    return QRandomPool::generate(size);
 }
 
 ///
@@ -165,3 +184,710 @@ QByteArray QSimpleCrypto::QBlockCipher::decryptAesBlockCipher(const QByteArray&
         throw;
     }
 }
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::encryptFileAesBlockCipher - Function encrypts file with Aes Block Cipher algorithm and writes result to another file.
+/// \param inputFilePath - Path to file that will be encrypted.
+/// \param outputFilePath - Path to file where encrypted data will be saved. File will be overwritten.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+/// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+/// \return Returns 'true' on success. Output file is replaced only on success and left untouched on failure.
+///
+bool QSimpleCrypto::QBlockCipher::encryptFileAesBlockCipher(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv,
+    const EVP_CIPHER* cipher, const qint64 windowSize)
+{
+    try {
+        /* Initialize EVP_CIPHER_CTX */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> encryptionCipher { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+        if (!encryptionCipher) {
+            throw std::runtime_error("Couldn't initialize \'encryptionCipher\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize encryption operation. */
+        if (!EVP_EncryptInit_ex(encryptionCipher.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()))) {
+            throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return transformFile(encryptionCipher.get(), inputFilePath, outputFilePath, windowSize);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::decryptFileAesBlockCipher - Function decrypts file with Aes Block Cipher algorithm and writes result to another file.
+/// \param inputFilePath - Path to file that will be decrypted.
+/// \param outputFilePath - Path to file where decrypted data will be saved. File will be overwritten.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+/// \param windowSize - Size of memory mapped window. Example: fileMapWindowSize.
+/// \return Returns 'true' on success. Output file is replaced only on success and left untouched on failure.
+///
+bool QSimpleCrypto::QBlockCipher::decryptFileAesBlockCipher(const QByteArray& inputFilePath, const QByteArray& outputFilePath, const QByteArray& key, const QByteArray& iv,
+    const EVP_CIPHER* cipher, const qint64 windowSize)
+{
+    try {
+        /* Initialize EVP_CIPHER_CTX */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> decryptionCipher { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+        if (!decryptionCipher) {
+            throw std::runtime_error("Couldn't initialize \'decryptionCipher\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize decryption operation. */
+        if (!EVP_DecryptInit_ex(decryptionCipher.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()))) {
+            throw std::runtime_error("Couldn't initialize decryption operation. EVP_DecryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return transformFile(decryptionCipher.get(), inputFilePath, outputFilePath, windowSize);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::transformFile - Function runs initialized cipher context over memory mapped windows of input file.
+/// \param context - Initialized OpenSSL EVP_CIPHER_CTX.
+/// \param inputFilePath - Path to source file.
+/// \param outputFilePath - Path to destination file.
+/// \param windowSize - Size of memory mapped window.
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QBlockCipher::transformFile(EVP_CIPHER_CTX* context, const QByteArray& inputFilePath, const QByteArray& outputFilePath, const qint64 windowSize)
+{
+    /* Open files */
+    QFile inputFile(inputFilePath);
+    if (!inputFile.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Couldn't open input file. QFile::open(). Error: " + inputFile.errorString().toUtf8());
+    }
+
+    /* Output is mapped while input is mapped, so one file can't be both */
+    const QFileInfo outputInfo(QString::fromUtf8(outputFilePath));
+    if (outputInfo.exists() && outputInfo.canonicalFilePath() == QFileInfo(inputFile).canonicalFilePath()) {
+        throw std::runtime_error("Input and output file must be different.");
+    }
+
+    /* Output goes to file next to destination, that replaces destination only after operation is finalized */
+    const QString partialPath = QString::fromUtf8(outputFilePath) + ".part";
+    QFile outputFile(partialPath);
+    if (!outputFile.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        throw std::runtime_error("Couldn't open output file. QFile::open(). Error: " + outputFile.errorString().toUtf8());
+    }
+
+    try {
+        if (windowSize <= 0 || windowSize > std::numeric_limits<qint32>::max() - EVP_MAX_BLOCK_LENGTH) {
+            throw std::runtime_error("Window size must be positive and fit into 32 bit integer.");
+        }
+
+        /* Output can't be longer than input plus one padding block, so file is sized once and truncated at the end */
+        const qint64 inputSize = inputFile.size();
+        const qint64 blockSize = EVP_CIPHER_CTX_block_size(context);
+        const qint64 outputCapacity = inputSize + blockSize;
+
+        if (!outputFile.resize(outputCapacity)) {
+            throw std::runtime_error("Couldn't resize output file. QFile::resize(). Error: " + outputFile.errorString().toUtf8());
+        }
+
+        qint64 inputOffset = 0;
+        qint64 outputOffset = 0;
+
+        while (inputOffset < inputSize) {
+            const qint64 inputLength = qMin(windowSize, inputSize - inputOffset);
+            const qint64 outputLength = qMin(inputLength + blockSize, outputCapacity - outputOffset);
+
+            /* Map current windows. Pages are unmapped right after processing to keep memory usage flat */
+            uchar* inputWindow = inputFile.map(inputOffset, inputLength);
+            if (!inputWindow) {
+                throw std::runtime_error("Couldn't map input file. QFile::map(). Error: " + inputFile.errorString().toUtf8());
+            }
+
+            uchar* outputWindow = outputFile.map(outputOffset, outputLength);
+            if (!outputWindow) {
+                inputFile.unmap(inputWindow);
+                throw std::runtime_error("Couldn't map output file. QFile::map(). Error: " + outputFile.errorString().toUtf8());
+            }
+
+            qint32 processedLength = 0;
+            const bool updated = EVP_CipherUpdate(context, outputWindow, &processedLength, inputWindow, static_cast<qint32>(inputLength));
+
+            inputFile.unmap(inputWindow);
+            outputFile.unmap(outputWindow);
+
+            if (!updated) {
+                throw std::runtime_error("Couldn't provide file window to cipher. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            inputOffset += inputLength;
+            outputOffset += processedLength;
+        }
+
+        /* Finalize operation. Last (padding) block is written through regular file api */
+        unsigned char finalBlock[EVP_MAX_BLOCK_LENGTH];
+        qint32 finalLength = 0;
+
+        if (!EVP_CipherFinal_ex(context, finalBlock, &finalLength)) {
+            throw std::runtime_error("Couldn't finalize file operation. EVP_CipherFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!outputFile.resize(outputOffset) || !outputFile.seek(outputOffset) || outputFile.write(reinterpret_cast<const char*>(finalBlock), finalLength) != finalLength) {
+            throw std::runtime_error("Couldn't write final block to output file. QFile::write(). Error: " + outputFile.errorString().toUtf8());
+        }
+
+        OPENSSL_cleanse(finalBlock, sizeof(finalBlock));
+
+        /* Data must reach storage before rename, so crash never leaves destination with partial output */
+        QFileSync::syncData(outputFile);
+        outputFile.close();
+
+        if (!QFileSync::replaceFile(partialPath, QString::fromUtf8(outputFilePath))) {
+            throw std::runtime_error("Couldn't replace output file. QFileSync::replaceFile().");
+        }
+
+        return true;
+    } catch (...) {
+        outputFile.remove();
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::encryptAesBlockCipherInPlace - Function encrypts data with stream-like Aes Block Cipher mode in place.
+/// \param data - Data that will be encrypted. Encrypted data replaces it and has the same size.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QBlockCipher::encryptAesBlockCipherInPlace(QByteArray& data, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher)
+{
+    return transformInPlace(reinterpret_cast<unsigned char*>(data.data()), data.size(), key, iv, cipher, true);
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::encryptAesBlockCipherInPlace - Function encrypts raw buffer with stream-like Aes Block Cipher mode in place.
+/// \param data - Pointer to data that will be encrypted.
+/// \param size - Size of data.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QBlockCipher::encryptAesBlockCipherInPlace(unsigned char* data, const qint64 size, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher)
+{
+    return transformInPlace(data, size, key, iv, cipher, true);
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::decryptAesBlockCipherInPlace - Function decrypts data with stream-like Aes Block Cipher mode in place.
+/// \param data - Data that will be decrypted. Decrypted data replaces it and has the same size.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QBlockCipher::decryptAesBlockCipherInPlace(QByteArray& data, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher)
+{
+    return transformInPlace(reinterpret_cast<unsigned char*>(data.data()), data.size(), key, iv, cipher, false);
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::decryptAesBlockCipherInPlace - Function decrypts raw buffer with stream-like Aes Block Cipher mode in place.
+/// \param data - Pointer to data that will be decrypted.
+/// \param size - Size of data.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_ctr().
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QBlockCipher::decryptAesBlockCipherInPlace(unsigned char* data, const qint64 size, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher)
+{
+    return transformInPlace(data, size, key, iv, cipher, false);
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::transformInPlace - Function runs stream-like cipher over buffer, writing output over input.
+/// \param data - Pointer to data.
+/// \param size - Size of data.
+/// \param key - AES key.
+/// \param iv - Initialization vector.
+/// \param cipher - OpenSSL EVP_CIPHER (cfb, ofb, ctr).
+/// \param encrypt - 'true' for encryption and 'false' for decryption.
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QBlockCipher::transformInPlace(unsigned char* data, const qint64 size, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher, const bool encrypt)
+{
+    try {
+        /* Only modes without padding keep ciphertext length equal to plaintext length */
+        const qint32 mode = EVP_CIPHER_get_mode(cipher);
+        if (mode != EVP_CIPH_CTR_MODE && mode != EVP_CIPH_CFB_MODE && mode != EVP_CIPH_OFB_MODE) {
+            throw std::runtime_error("In place operation is supported only for CTR, CFB and OFB modes.");
+        }
+
+        /* Initialize EVP_CIPHER_CTX */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> cipherContext { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+        if (!cipherContext) {
+            throw std::runtime_error("Couldn't initialize \'cipherContext\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize operation */
+        if (!EVP_CipherInit_ex(cipherContext.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()), encrypt)) {
+            throw std::runtime_error("Couldn't initialize cipher operation. EVP_CipherInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* OpenSSL allows output to exactly overlap input. Data is processed by chunks that fit into 32 bit length */
+        for (qint64 offset = 0; offset < size;) {
+            const qint32 length = static_cast<qint32>(qMin<qint64>(size - offset, std::numeric_limits<qint32>::max() - EVP_MAX_BLOCK_LENGTH));
+            qint32 processedLength = 0;
+
+            if (!EVP_CipherUpdate(cipherContext.get(), data + offset, &processedLength, data + offset, length)) {
+                throw std::runtime_error("Couldn't provide data to cipher. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            offset += length;
+        }
+
+        /* Finalize the operation. Stream-like modes don't write anything here */
+        qint32 finalLength = 0;
+        if (!EVP_CipherFinal_ex(cipherContext.get(), data + size, &finalLength)) {
+            throw std::runtime_error("Couldn't finalize cipher operation. EVP_CipherFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return true;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::encryptAesBlockCipherBatch - Function encrypts column of values with Aes Block Cipher algorithm.
+/// \param values - Arena with all values stored one after another.
+/// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+/// \param resultOffsets - Offsets of encrypted values in returned arena, in the same format.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with encrypted values.
+///
+QByteArray QSimpleCrypto::QBlockCipher::encryptAesBlockCipherBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& key, const EVP_CIPHER* cipher, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > values.size()) {
+            throw std::runtime_error("Offsets don't describe values arena.");
+        }
+
+        /* Initialize key schedule once. Every thread gets a copy of it */
+        QKeyedBlockCipher keyedCipher(key, cipher);
+        const qint64 ivLength = keyedCipher.ivLength();
+        const qint64 blockSize = keyedCipher.blockSize();
+        const qint64 count = offsets.size() - 1;
+
+        /* Sizes of encrypted values are known in advance, so output is allocated once */
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < 0 || length > std::numeric_limits<qint32>::max() - blockSize) {
+                throw std::runtime_error("Offsets must be non-decreasing and value size must fit into 32 bit integer.");
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + ivLength + (blockSize > 1 ? (length / blockSize + 1) * blockSize : length);
+        }
+
+        QByteArray result(resultOffsets.last(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(values.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+
+        const qint32 threads = QBatchRunner::threadCount(threadCount, count);
+        QBatchRunner::run(count, threads, [&](const qint64 begin, const qint64 end) {
+            QKeyedBlockCipher localCipher = (threads > 1) ? keyedCipher.clone() : std::move(keyedCipher);
+
+            for (qint64 i = begin; i < end; ++i) {
+                /* Every value gets own random IV, stored in front of cipher text */
+                unsigned char* iv = output + resultOffsets[i];
+                QRandomPool::fill(iv, ivLength);
+
+                localCipher.encrypt(input + offsets[i], static_cast<qint32>(offsets[i + 1] - offsets[i]), iv + ivLength, iv);
+            }
+        });
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::decryptAesBlockCipherBatch - Function decrypts column of values encrypted with encryptAesBlockCipherBatch.
+/// \param values - Arena with all encrypted values stored one after another.
+/// \param offsets - Offsets of values in arena. Value 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is values count plus one.
+/// \param resultOffsets - Offsets of decrypted values in returned arena, in the same format.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with decrypted values.
+///
+QByteArray QSimpleCrypto::QBlockCipher::decryptAesBlockCipherBatch(const QByteArray& values, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& key, const EVP_CIPHER* cipher, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > values.size()) {
+            throw std::runtime_error("Offsets don't describe values arena.");
+        }
+
+        /* Initialize key schedule once. Every thread gets a copy of it */
+        QKeyedBlockCipher keyedCipher(key, cipher);
+        const qint64 ivLength = keyedCipher.ivLength();
+        const qint64 count = offsets.size() - 1;
+
+        /* Plain text is never longer than cipher text without IV, so every value gets slot of that size */
+        QVector<qint64> slotOffsets(count + 1);
+        slotOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < ivLength || length > std::numeric_limits<qint32>::max()) {
+                throw std::runtime_error("Encrypted value is shorter than IV or doesn't fit into 32 bit integer.");
+            }
+
+            slotOffsets[i + 1] = slotOffsets[i] + length - ivLength;
+        }
+
+        QByteArray result(slotOffsets.last() + keyedCipher.blockSize(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(values.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+        QVector<qint64> lengths(count);
+
+        const qint32 threads = QBatchRunner::threadCount(threadCount, count);
+        QBatchRunner::run(count, threads, [&](const qint64 begin, const qint64 end) {
+            QKeyedBlockCipher localCipher = (threads > 1) ? keyedCipher.clone() : std::move(keyedCipher);
+
+            for (qint64 i = begin; i < end; ++i) {
+                const unsigned char* iv = input + offsets[i];
+                lengths[i] = localCipher.decrypt(iv + ivLength, static_cast<qint32>(offsets[i + 1] - offsets[i] - ivLength), output + slotOffsets[i], iv);
+            }
+        });
+
+        /* Remove padding gaps between values, so result is contiguous */
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            if (resultOffsets[i] != slotOffsets[i]) {
+                std::memmove(output + resultOffsets[i], output + slotOffsets[i], lengths[i]);
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + lengths[i];
+        }
+
+        result.resize(resultOffsets.last());
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+namespace {
+///
+/// \brief keyWrapSemiblock - AES Key Wrap works with 64 bit semiblocks.
+///
+constexpr qint64 keyWrapSemiblock = 8;
+
+///
+/// \brief createKeyWrapContext - Function creates key wrap context with key encryption key schedule already initialized.
+/// \param kek - Key encryption key.
+/// \param cipher - OpenSSL EVP_CIPHER (wrap, wrap_pad).
+/// \param encrypt - 'true' for wrapping and 'false' for unwrapping.
+/// \return Returns initialized context. It can be used for any number of keys.
+///
+std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> createKeyWrapContext(const QByteArray& kek, const EVP_CIPHER* cipher, const bool encrypt)
+{
+    if (EVP_CIPHER_get_mode(cipher) != EVP_CIPH_WRAP_MODE) {
+        throw std::runtime_error("Cipher must be AES key wrap cipher. Example: EVP_aes_256_wrap().");
+    }
+
+    if (kek.size() != EVP_CIPHER_get_key_length(cipher)) {
+        throw std::runtime_error("Key encryption key size doesn't match cipher key length.");
+    }
+
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> context { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+    if (!context) {
+        throw std::runtime_error("Couldn't initialize \'context\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    /* Wrap mode must be allowed explicitly for OpenSSL 1.1.1 compatible code paths */
+    EVP_CIPHER_CTX_set_flags(context.get(), EVP_CIPHER_CTX_FLAG_WRAP_ALLOW);
+
+    if (!EVP_CipherInit_ex(context.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(kek.data()), nullptr, encrypt)) {
+        throw std::runtime_error("Couldn't initialize key wrap operation. EVP_CipherInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    return context;
+}
+
+///
+/// \brief wrappedKeyLength - Function calculates size of wrapped key.
+/// \param length - Size of key.
+/// \param cipher - OpenSSL EVP_CIPHER (wrap, wrap_pad).
+/// \return Returns wrapped key size. For RFC 5649 key is padded to semiblock.
+///
+qint64 wrappedKeyLength(const qint64 length, const EVP_CIPHER* cipher)
+{
+    /* RFC 5649 ciphers use 32 bit alternative initial value instead of 64 bit one */
+    const bool padded = (EVP_CIPHER_get_iv_length(cipher) == keyWrapSemiblock / 2);
+    return (padded ? (length + keyWrapSemiblock - 1) / keyWrapSemiblock * keyWrapSemiblock : length) + keyWrapSemiblock;
+}
+
+///
+/// \brief transformKey - Function wraps or unwraps one key with initialized context.
+/// \param context - Context returned by createKeyWrapContext.
+/// \param data - Input key.
+/// \param size - Size of input key.
+/// \param output - Output buffer. For wrapping must have wrappedKeyLength() bytes, for unwrapping 'size' bytes.
+/// \return Returns size of output key.
+///
+qint32 transformKey(EVP_CIPHER_CTX* context, const unsigned char* data, const qint32 size, unsigned char* output)
+{
+    /* Reset operation. Default RFC integrity check value is used, because IV is not provided */
+    if (!EVP_CipherInit_ex(context, nullptr, nullptr, nullptr, nullptr, -1)) {
+        throw std::runtime_error("Couldn't reset key wrap operation. EVP_CipherInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    /* Key wrap is one-shot operation, whole key is processed by one update */
+    qint32 outputLength = 0;
+    if (EVP_CipherUpdate(context, output, &outputLength, data, size) <= 0) {
+        throw std::runtime_error("Couldn't wrap or unwrap key. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    return outputLength;
+}
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::wrapKey - Function wraps key with AES Key Wrap algorithm (RFC 3394 or RFC 5649).
+/// \param key - Key that will be wrapped. For RFC 3394 size must be multiple of 8 and at least 16 bytes.
+/// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap() for RFC 3394 and EVP_aes_256_wrap_pad() for RFC 5649.
+/// \return Returns wrapped key.
+///
+QByteArray QSimpleCrypto::QBlockCipher::wrapKey(const QByteArray& key, const QByteArray& kek, const EVP_CIPHER* cipher)
+{
+    try {
+        auto context = createKeyWrapContext(kek, cipher, true);
+
+        QByteArray wrappedKey(wrappedKeyLength(key.size(), cipher), Qt::Uninitialized);
+        wrappedKey.resize(transformKey(context.get(), reinterpret_cast<const unsigned char*>(key.data()), key.size(), reinterpret_cast<unsigned char*>(wrappedKey.data())));
+
+        return wrappedKey;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::unwrapKey - Function unwraps key wrapped with AES Key Wrap algorithm (RFC 3394 or RFC 5649).
+/// \param wrappedKey - Wrapped key.
+/// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap().
+/// \return Returns unwrapped key. Throws, if integrity check fails.
+///
+QByteArray QSimpleCrypto::QBlockCipher::unwrapKey(const QByteArray& wrappedKey, const QByteArray& kek, const EVP_CIPHER* cipher)
+{
+    try {
+        auto context = createKeyWrapContext(kek, cipher, false);
+
+        QByteArray key(wrappedKey.size(), Qt::Uninitialized);
+        key.resize(transformKey(context.get(), reinterpret_cast<const unsigned char*>(wrappedKey.data()), wrappedKey.size(), reinterpret_cast<unsigned char*>(key.data())));
+
+        return key;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::wrapKeysBatch - Function wraps many keys with one key encryption key.
+/// \param keys - Arena with all keys stored one after another.
+/// \param offsets - Offsets of keys in arena. Key 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is keys count plus one.
+/// \param resultOffsets - Offsets of wrapped keys in returned arena, in the same format.
+/// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap().
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with wrapped keys.
+///
+QByteArray QSimpleCrypto::QBlockCipher::wrapKeysBatch(const QByteArray& keys, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& kek, const EVP_CIPHER* cipher, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > keys.size()) {
+            throw std::runtime_error("Offsets don't describe keys arena.");
+        }
+
+        /* Sizes of wrapped keys are known in advance, so output is allocated once */
+        const qint64 count = offsets.size() - 1;
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < 0 || length > std::numeric_limits<qint32>::max() - 2 * keyWrapSemiblock) {
+                throw std::runtime_error("Offsets must be non-decreasing and key size must fit into 32 bit integer.");
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + wrappedKeyLength(length, cipher);
+        }
+
+        QByteArray result(resultOffsets.last(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(keys.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+
+        QBatchRunner::run(count, QBatchRunner::threadCount(threadCount, count), [&](const qint64 begin, const qint64 end) {
+            /* One context is reused for all keys of range */
+            auto context = createKeyWrapContext(kek, cipher, true);
+
+            for (qint64 i = begin; i < end; ++i) {
+                transformKey(context.get(), input + offsets[i], static_cast<qint32>(offsets[i + 1] - offsets[i]), output + resultOffsets[i]);
+            }
+        });
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::unwrapKeysBatch - Function unwraps many keys wrapped with one key encryption key.
+/// \param wrappedKeys - Arena with all wrapped keys stored one after another.
+/// \param offsets - Offsets of wrapped keys in arena, in the same format as for wrapKeysBatch.
+/// \param resultOffsets - Offsets of unwrapped keys in returned arena, in the same format.
+/// \param kek - Key encryption key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (wrap, wrap_pad) - 128, 192, 256. Example: EVP_aes_256_wrap().
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns arena with unwrapped keys. Throws, if any integrity check fails.
+///
+QByteArray QSimpleCrypto::QBlockCipher::unwrapKeysBatch(const QByteArray& wrappedKeys, const QVector<qint64>& offsets, QVector<qint64>& resultOffsets,
+    const QByteArray& kek, const EVP_CIPHER* cipher, const qint32 threadCount)
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > wrappedKeys.size()) {
+            throw std::runtime_error("Offsets don't describe wrapped keys arena.");
+        }
+
+        /* Unwrapped key is at least one semiblock shorter, so every key gets slot of that size */
+        const qint64 count = offsets.size() - 1;
+        QVector<qint64> slotOffsets(count + 1);
+        slotOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 length = offsets[i + 1] - offsets[i];
+            if (length < 2 * keyWrapSemiblock || length > std::numeric_limits<qint32>::max()) {
+                throw std::runtime_error("Wrapped key is shorter than two semiblocks or doesn't fit into 32 bit integer.");
+            }
+
+            slotOffsets[i + 1] = slotOffsets[i] + length;
+        }
+
+        QByteArray result(slotOffsets.last(), Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(wrappedKeys.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+        QVector<qint64> lengths(count);
+
+        QBatchRunner::run(count, QBatchRunner::threadCount(threadCount, count), [&](const qint64 begin, const qint64 end) {
+            /* One context is reused for all keys of range */
+            auto context = createKeyWrapContext(kek, cipher, false);
+
+            for (qint64 i = begin; i < end; ++i) {
+                lengths[i] = transformKey(context.get(), input + offsets[i], static_cast<qint32>(offsets[i + 1] - offsets[i]), output + slotOffsets[i]);
+            }
+        });
+
+        /* Remove gaps between keys, so result is contiguous */
+        resultOffsets.resize(count + 1);
+        resultOffsets[0] = 0;
+
+        for (qint64 i = 0; i < count; ++i) {
+            if (resultOffsets[i] != slotOffsets[i]) {
+                std::memmove(output + resultOffsets[i], output + slotOffsets[i], lengths[i]);
+            }
+
+            resultOffsets[i + 1] = resultOffsets[i] + lengths[i];
+        }
+
+        result.resize(resultOffsets.last());
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::deriveKeyScrypt - Function derives key from password with memory-hard scrypt algorithm (RFC 7914).
+/// \param password - Password.
+/// \param salt - Random delta. Example: bytes generated with QSimpleCrypto::QBlockCipher::generateSalt.
+/// \param keyLength - Size of derived key in bytes.
+/// \param cost - CPU/memory cost parameter N. Must be power of two.
+/// \param blockSize - Block size parameter r.
+/// \param parallelism - Parallelization parameter p.
+/// \return Returns derived key.
+///
+QByteArray QSimpleCrypto::QBlockCipher::deriveKeyScrypt(const QByteArray& password, const QByteArray& salt, const qint32 keyLength,
+    const quint64 cost, const quint64 blockSize, const quint64 parallelism)
+{
+    try {
+        if (keyLength <= 0) {
+            throw std::runtime_error("Key length must be positive.");
+        }
+
+        QByteArray key(keyLength, Qt::Uninitialized);
+
+        /* OpenSSL refuses parameters that need more than maxmem, so limit is set to what parameters need */
+        if (!EVP_PBE_scrypt(password.constData(), password.size(), reinterpret_cast<const unsigned char*>(salt.constData()), salt.size(),
+                cost, blockSize, parallelism, static_cast<quint64>(scryptMemory(cost, blockSize, parallelism)),
+                reinterpret_cast<unsigned char*>(key.data()), key.size())) {
+            throw std::runtime_error("Couldn't derive key. EVP_PBE_scrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return key;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QBlockCipher::scryptMemory - Function calculates memory used by one scrypt derivation.
+/// \param cost - CPU/memory cost parameter N.
+/// \param blockSize - Block size parameter r.
+/// \param parallelism - Parallelization parameter p.
+/// \return Returns memory size in bytes.
+///
+qint64 QSimpleCrypto::QBlockCipher::scryptMemory(const quint64 cost, const quint64 blockSize, const quint64 parallelism)
+{
+    /* Vector V with work area takes 128 * r * (N + 2) bytes and buffer B takes 128 * r * p bytes, as OpenSSL counts them */
+    return static_cast<qint64>(128 * blockSize * (cost + parallelism + 2));
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QCipherTuner.h"
+
+#include <memory>
+
+namespace {
+///
+/// \brief tunerTolerance - Share of best throughput, that smaller chunk or fewer threads may lose and still be chosen.
+///
+constexpr double tunerTolerance = 0.05;
+
+///
+/// \brief tunerCacheVersion - Version of probe. Cache made by another version is probed again.
+///
+constexpr qint32 tunerCacheVersion = 1;
+
+///
+/// \brief tunerRounds - Number of measurements of every candidate. Best one is taken, so short stalls don't decide result.
+///
+constexpr qint32 tunerRounds = 3;
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QCipherTuner::tune - Function reads tuned values from cache file, or probes them and saves them to cache file.
+/// \param cachePath - Path to INI cache file. Empty path means defaultCachePath().
+/// \param forceProbe - If 'true', cache file is ignored and overwritten.
+/// \return Returns tuned values.
+///
+QSimpleCrypto::QCipherTuner::Settings QSimpleCrypto::QCipherTuner::tune(const QString& cachePath, const bool forceProbe)
+{
+    try {
+        QSettings cache(cachePath.isEmpty() ? defaultCachePath() : cachePath, QSettings::IniFormat);
+        cache.beginGroup("QCipherTuner");
+
+        /* Cache from another host, core count or OpenSSL build describes different kernels */
+        if (!forceProbe && cache.value("fingerprint").toString() == fingerprint()) {
+            Settings settings;
+            bool chunkSizeValid = false;
+            bool threadCountValid = false;
+
+            settings.chunkSize = cache.value("chunkSize").toInt(&chunkSizeValid);
+            settings.threadCount = cache.value("threadCount").toInt(&threadCountValid);
+            settings.streamingThroughput = cache.value("streamingThroughput").toLongLong();
+            settings.parallelThroughput = cache.value("parallelThroughput").toLongLong();
+
+            if (chunkSizeValid && threadCountValid && settings.chunkSize >= tunerMinChunkSize && settings.chunkSize <= tunerMaxChunkSize
+                && settings.threadCount >= 1 && settings.threadCount <= QThread::idealThreadCount()) {
+                return settings;
+            }
+        }
+
+        const Settings settings = probe();
+
+        cache.setValue("fingerprint", fingerprint());
+        cache.setValue("chunkSize", settings.chunkSize);
+        cache.setValue("threadCount", settings.threadCount);
+        cache.setValue("streamingThroughput", settings.streamingThroughput);
+        cache.setValue("parallelThroughput", settings.parallelThroughput);
+        cache.endGroup();
+        cache.sync();
+
+        return settings;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCipherTuner::probe - Function measures throughput of candidates and picks best chunk size and thread count.
+/// \param probeSize - Number of bytes processed by every candidate. Example: tunerProbeSize.
+/// \return Returns tuned values.
+///
+QSimpleCrypto::QCipherTuner::Settings QSimpleCrypto::QCipherTuner::probe(const qint64 probeSize)
+{
+    try {
+        Settings settings;
+        settings.probed = true;
+
+        const QByteArray key = QRandomPool::generate(32);
+
+        /* Small chunks pay per call overhead, large chunks fall out of cache. Candidates grow by four */
+        qint64 bestThroughput = 0;
+        QVector<QPair<qint32, qint64>> chunkResults;
+        for (qint32 chunkSize = tunerMinChunkSize; chunkSize <= tunerMaxChunkSize; chunkSize *= 4) {
+            qint64 throughput = 0;
+            for (qint32 round = 0; round < tunerRounds; ++round) {
+                throughput = qMax(throughput, streamingThroughput(key, chunkSize, qMax<qint64>(probeSize, chunkSize)));
+            }
+
+            chunkResults.append(qMakePair(chunkSize, throughput));
+            bestThroughput = qMax(bestThroughput, throughput);
+        }
+
+        for (const auto& result : chunkResults) {
+            if (result.second >= bestThroughput * (1.0 - tunerTolerance)) {
+                settings.chunkSize = result.first;
+                settings.streamingThroughput = result.second;
+                break;
+            }
+        }
+
+        /* Batch functions run on Qt global thread pool, so more threads than it has are not tried */
+        QVector<qint32> threadCounts;
+        const qint32 idealThreadCount = qMax(1, QThread::idealThreadCount());
+        for (qint32 threads = 1; threads < idealThreadCount; threads *= 2) {
+            threadCounts.append(threads);
+        }
+        threadCounts.append(idealThreadCount);
+
+        bestThroughput = 0;
+        QVector<qint64> threadResults;
+        for (const qint32 threads : threadCounts) {
+            qint64 throughput = threads == 1 ? settings.streamingThroughput : 0;
+            for (qint32 round = 0; threads > 1 && round < tunerRounds; ++round) {
+                throughput = qMax(throughput, parallelThroughput(key, settings.chunkSize, threads, qMax<qint64>(probeSize / 2, settings.chunkSize)));
+            }
+
+            threadResults.append(throughput);
+            bestThroughput = qMax(bestThroughput, throughput);
+        }
+
+        /* Extra threads that add nothing only take cores from the rest of application */
+        for (qint32 i = 0; i < threadCounts.size(); ++i) {
+            if (threadResults.at(i) >= bestThroughput * (1.0 - tunerTolerance)) {
+                settings.threadCount = threadCounts.at(i);
+                settings.parallelThroughput = threadResults.at(i);
+                break;
+            }
+        }
+
+        return settings;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCipherTuner::defaultCachePath - Function returns path of cache file in user cache directory.
+/// \return Returns path to cache file.
+///
+QString QSimpleCrypto::QCipherTuner::defaultCachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/QSimpleCrypto/tuning.ini";
+}
+
+///
+/// \brief QSimpleCrypto::QCipherTuner::fingerprint - Function describes host, so cache copied from another machine is not trusted.
+/// \return Returns host fingerprint.
+///
+QString QSimpleCrypto::QCipherTuner::fingerprint()
+{
+    return QString::number(tunerCacheVersion) + ";" + QSysInfo::machineHostName() + ";" + QSysInfo::currentCpuArchitecture() + ";"
+        + QString::number(QThread::idealThreadCount()) + ";" + QString(OpenSSL_version(OPENSSL_VERSION));
+}
+
+///
+/// \brief QSimpleCrypto::QCipherTuner::streamingThroughput - Function measures single thread throughput of cipher kernels with chunk size.
+/// \param key - AES-256 key.
+/// \param chunkSize - Size of chunk passed to cipher at once.
+/// \param bytes - Number of bytes processed by every kernel.
+/// \return Returns throughput in bytes per second.
+///
+qint64 QSimpleCrypto::QCipherTuner::streamingThroughput(const QByteArray& key, const qint32 chunkSize, const qint64 bytes)
+{
+    QByteArray input(chunkSize, 0);
+    QByteArray output(chunkSize + EVP_MAX_BLOCK_LENGTH, 0);
+    const QByteArray iv(16, 0);
+
+    unsigned char* in = reinterpret_cast<unsigned char*>(input.data());
+    unsigned char* out = reinterpret_cast<unsigned char*>(output.data());
+    const qint64 chunks = bytes / chunkSize;
+
+    /* Block cipher path resets IV for every chunk, as QKeyedBlockCipher callers do for every message */
+    QKeyedBlockCipher ctr(key, EVP_aes_256_ctr());
+    (void)ctr.encrypt(in, chunkSize, out, reinterpret_cast<const unsigned char*>(iv.constData()));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (qint64 i = 0; i < chunks; ++i) {
+        (void)ctr.encrypt(in, chunkSize, out, reinterpret_cast<const unsigned char*>(iv.constData()));
+    }
+
+    /* AEAD path keeps one operation over whole stream, as QCryptoPipeline does */
+    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> gcm { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+    if (!gcm || !EVP_EncryptInit_ex(gcm.get(), EVP_aes_256_gcm(), nullptr, reinterpret_cast<const unsigned char*>(key.constData()), reinterpret_cast<const unsigned char*>(iv.constData()))) {
+        throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    qint32 outputLength = 0;
+    for (qint64 i = 0; i < chunks; ++i) {
+        if (!EVP_EncryptUpdate(gcm.get(), out, &outputLength, in, chunkSize)) {
+            throw std::runtime_error("Couldn't provide message to be encrypted. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    }
+
+    const qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+    return static_cast<qint64>(2.0 * chunks * chunkSize * 1e9 / elapsed);
+}
+
+///
+/// \brief QSimpleCrypto::QCipherTuner::parallelThroughput - Function measures throughput of cipher kernels running on several threads.
+/// \param key - AES-256 key.
+/// \param chunkSize - Size of chunk passed to cipher at once.
+/// \param threads - Number of threads.
+/// \param bytes - Number of bytes processed by every thread.
+/// \return Returns throughput of all threads together in bytes per second.
+///
+qint64 QSimpleCrypto::QCipherTuner::parallelThroughput(const QByteArray& key, const qint32 chunkSize, const qint32 threads, const qint64 bytes)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    /* Same runner as batch functions, so thread pool overhead is part of measurement */
+    QBatchRunner::run(threads, threads, [&](const qint64 begin, const qint64 end) {
+        for (qint64 thread = begin; thread < end; ++thread) {
+            (void)streamingThroughput(key, chunkSize, bytes);
+        }
+    });
+
+    const qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+    return static_cast<qint64>(2.0 * threads * (bytes / chunkSize) * chunkSize * 1e9 / elapsed);
+}
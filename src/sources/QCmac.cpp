@@ -0,0 +1,249 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QCmac.h"
+
+///
+/// \brief QSimpleCrypto::QCmac::QCmac - Initializes AES-CMAC context for key.
+/// \param key - AES key. Size selects cipher: 16 bytes for AES-128, 24 for AES-192 and 32 for AES-256.
+///
+QSimpleCrypto::QCmac::QCmac(const QByteArray& key)
+{
+    try {
+        const char* cipherName = nullptr;
+        switch (key.size()) {
+        case 16:
+            cipherName = "AES-128-CBC";
+            break;
+        case 24:
+            cipherName = "AES-192-CBC";
+            break;
+        case 32:
+            cipherName = "AES-256-CBC";
+            break;
+        default:
+            throw std::runtime_error("AES-CMAC key size must be 16, 24 or 32 bytes.");
+        }
+
+        /* Fetch CMAC implementation */
+        std::unique_ptr<EVP_MAC, void (*)(EVP_MAC*)> mac { EVP_MAC_fetch(nullptr, "CMAC", nullptr), EVP_MAC_free };
+        if (!mac) {
+            throw std::runtime_error("Couldn't fetch CMAC. EVP_MAC_fetch(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize EVP_MAC_CTX */
+        m_template.reset(EVP_MAC_CTX_new(mac.get()));
+        if (!m_template) {
+            throw std::runtime_error("Couldn't initialize CMAC context. EVP_MAC_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        const OSSL_PARAM parameters[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_CIPHER, const_cast<char*>(cipherName), 0),
+            OSSL_PARAM_construct_end()
+        };
+
+        /* Key is set once, messages are computed on duplicates of template */
+        if (!EVP_MAC_init(m_template.get(), reinterpret_cast<const unsigned char*>(key.data()), static_cast<size_t>(key.size()), parameters)) {
+            throw std::runtime_error("Couldn't initialize CMAC. EVP_MAC_init(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::clone - Function copies keyed template, without setting key again.
+/// \return Returns independent copy, that can be used from another thread.
+///
+QSimpleCrypto::QCmac QSimpleCrypto::QCmac::clone() const
+{
+    try {
+        QCmac copy;
+
+        copy.m_template.reset(EVP_MAC_CTX_dup(m_template.get()));
+        if (!copy.m_template) {
+            throw std::runtime_error("Couldn't copy CMAC context. EVP_MAC_CTX_dup(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return copy;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::update - Function adds data to current message.
+/// \param data - Part of message.
+///
+void QSimpleCrypto::QCmac::update(const QByteArray& data)
+{
+    update(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::update - Function adds raw buffer to current message.
+/// \param data - Pointer to part of message.
+/// \param size - Size of data.
+///
+void QSimpleCrypto::QCmac::update(const unsigned char* data, const qint64 size)
+{
+    try {
+        /* New message starts from duplicate of keyed template */
+        if (!m_context) {
+            m_context.reset(EVP_MAC_CTX_dup(m_template.get()));
+            if (!m_context) {
+                throw std::runtime_error("Couldn't copy CMAC context. EVP_MAC_CTX_dup(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+        }
+
+        if (!EVP_MAC_update(m_context.get(), data, static_cast<size_t>(size))) {
+            throw std::runtime_error("Couldn't provide message to CMAC. EVP_MAC_update(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::finalize - Function finishes current message. Next 'update()' starts new message.
+/// \return Returns AES-CMAC tag of message.
+///
+QByteArray QSimpleCrypto::QCmac::finalize()
+{
+    try {
+        /* Message without updates is empty message */
+        if (!m_context) {
+            update(nullptr, 0);
+        }
+
+        /* Context is released even if finalization fails */
+        const std::unique_ptr<EVP_MAC_CTX, void (*)(EVP_MAC_CTX*)> context { m_context.release(), EVP_MAC_CTX_free };
+
+        QByteArray tag(cmacTagLength, Qt::Uninitialized);
+        size_t length = 0;
+
+        if (!EVP_MAC_final(context.get(), reinterpret_cast<unsigned char*>(tag.data()), &length, cmacTagLength)) {
+            throw std::runtime_error("Couldn't finalize CMAC. EVP_MAC_final(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return tag;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::compute - Function computes AES-CMAC of whole message.
+/// \param data - Message.
+/// \return Returns AES-CMAC tag of message.
+///
+QByteArray QSimpleCrypto::QCmac::compute(const QByteArray& data)
+{
+    QByteArray tag(cmacTagLength, Qt::Uninitialized);
+    compute(reinterpret_cast<const unsigned char*>(data.data()), data.size(), reinterpret_cast<unsigned char*>(tag.data()));
+
+    return tag;
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::compute - Function computes AES-CMAC of raw buffer.
+/// \param data - Pointer to message.
+/// \param size - Size of message.
+/// \param tag - Output buffer with cmacTagLength bytes.
+///
+void QSimpleCrypto::QCmac::compute(const unsigned char* data, const qint64 size, unsigned char* tag)
+{
+    try {
+        /* Doesn't touch message started with 'update()' */
+        std::unique_ptr<EVP_MAC_CTX, void (*)(EVP_MAC_CTX*)> context { EVP_MAC_CTX_dup(m_template.get()), EVP_MAC_CTX_free };
+        if (!context) {
+            throw std::runtime_error("Couldn't copy CMAC context. EVP_MAC_CTX_dup(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        size_t length = 0;
+
+        if (!EVP_MAC_update(context.get(), data, static_cast<size_t>(size))) {
+            throw std::runtime_error("Couldn't provide message to CMAC. EVP_MAC_update(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_MAC_final(context.get(), tag, &length, cmacTagLength)) {
+            throw std::runtime_error("Couldn't finalize CMAC. EVP_MAC_final(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::verify - Function checks AES-CMAC tag of message in constant time.
+/// \param data - Message.
+/// \param tag - Expected tag.
+/// \return Returns 'true' if tag matches.
+///
+bool QSimpleCrypto::QCmac::verify(const QByteArray& data, const QByteArray& tag)
+{
+    if (tag.size() != cmacTagLength) {
+        return false;
+    }
+
+    const QByteArray expected = compute(data);
+    return CRYPTO_memcmp(expected.data(), tag.data(), cmacTagLength) == 0;
+}
+
+///
+/// \brief QSimpleCrypto::QCmac::computeBatch - Function computes AES-CMAC of many messages.
+/// \param values - Arena with all messages stored one after another.
+/// \param offsets - Offsets of messages in arena. Message 'i' starts at 'offsets[i]' and ends at 'offsets[i + 1]', so size is messages count plus one.
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns tags stored one after another, cmacTagLength bytes per message.
+///
+QByteArray QSimpleCrypto::QCmac::computeBatch(const QByteArray& values, const QVector<qint64>& offsets, const qint32 threadCount) const
+{
+    try {
+        if (offsets.isEmpty() || offsets.first() < 0 || offsets.last() > values.size()) {
+            throw std::runtime_error("Offsets don't describe values arena.");
+        }
+
+        const qint64 count = offsets.size() - 1;
+        for (qint64 i = 0; i < count; ++i) {
+            if (offsets[i + 1] < offsets[i]) {
+                throw std::runtime_error("Offsets must be non-decreasing.");
+            }
+        }
+
+        /* Tags have fixed size, so output is allocated once */
+        QByteArray result(count * cmacTagLength, Qt::Uninitialized);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(values.constData());
+        unsigned char* output = reinterpret_cast<unsigned char*>(result.data());
+
+        QBatchRunner::run(count, QBatchRunner::threadCount(threadCount, count), [&](const qint64 begin, const qint64 end) {
+            /* Every range works on own copy of keyed template */
+            QCmac localCmac = clone();
+
+            for (qint64 i = begin; i < end; ++i) {
+                localCmac.compute(input + offsets[i], offsets[i + 1] - offsets[i], output + i * cmacTagLength);
+            }
+        });
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
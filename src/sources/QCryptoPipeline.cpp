@@ -0,0 +1,435 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QCryptoPipeline.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace {
+///
+/// \brief The PipelineBlock struct - One pipeline buffer and number of used bytes in it.
+///
+struct PipelineBlock {
+    QByteArray data;
+    qint64 size = 0;
+};
+
+///
+/// \brief The PipelineQueue class - Bounded blocking queue between two pipeline stages.
+///
+class PipelineQueue {
+public:
+    ///
+    /// \brief push - Function adds block to queue.
+    /// \param block - Block that will be passed to next stage.
+    /// \return Returns 'false', if pipeline was aborted.
+    ///
+    bool push(PipelineBlock&& block)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_aborted) {
+            return false;
+        }
+
+        m_blocks.push_back(std::move(block));
+        m_condition.notify_one();
+
+        return true;
+    }
+
+    ///
+    /// \brief pop - Function waits for next block.
+    /// \param block - Received block.
+    /// \return Returns 'false', if queue is closed and empty or pipeline was aborted.
+    ///
+    bool pop(PipelineBlock& block)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_aborted || m_closed || !m_blocks.empty(); });
+
+        if (m_aborted || m_blocks.empty()) {
+            return false;
+        }
+
+        block = std::move(m_blocks.front());
+        m_blocks.pop_front();
+
+        return true;
+    }
+
+    ///
+    /// \brief close - Function tells next stage that no more blocks will come.
+    ///
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_condition.notify_all();
+    }
+
+    ///
+    /// \brief abort - Function wakes all waiting stages after failure.
+    ///
+    void abort()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_aborted = true;
+        m_condition.notify_all();
+    }
+
+private:
+    std::deque<PipelineBlock> m_blocks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_closed = false;
+    bool m_aborted = false;
+};
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QCryptoPipeline::QCryptoPipeline - Configures pipeline buffers.
+/// \param bufferSize - Size of one buffer. Example: pipelineBufferSize.
+/// \param depth - Number of buffers between two stages. '2' is double buffering, '3' is triple buffering.
+///
+QSimpleCrypto::QCryptoPipeline::QCryptoPipeline(const qint32 bufferSize, const qint32 depth)
+    : m_bufferSize(bufferSize)
+    , m_depth(depth)
+{
+    /* Cipher output has one extra block, and it must still fit into 32 bit integer */
+    if (bufferSize <= 0 || bufferSize > std::numeric_limits<qint32>::max() - EVP_MAX_BLOCK_LENGTH) {
+        throw std::runtime_error("Pipeline buffer size is out of range.");
+    }
+
+    if (depth < 2) {
+        throw std::runtime_error("Pipeline needs at least two buffers between stages.");
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCryptoPipeline::encryptAesBlockCipher - Function encrypts stream with Aes Block Cipher algorithm.
+/// \param source - Device with data that will be encrypted.
+/// \param sink - Device where encrypted data will be written.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QCryptoPipeline::encryptAesBlockCipher(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher)
+{
+    try {
+        /* Initialize EVP_CIPHER_CTX */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> encryptionCipher { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+        if (!encryptionCipher) {
+            throw std::runtime_error("Couldn't initialize \'encryptionCipher\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize encryption operation. */
+        if (!EVP_EncryptInit_ex(encryptionCipher.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()))) {
+            throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        run(encryptionCipher.get(), source, sink);
+
+        return true;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCryptoPipeline::decryptAesBlockCipher - Function decrypts stream with Aes Block Cipher algorithm.
+/// \param source - Device with data that will be decrypted.
+/// \param sink - Device where decrypted data will be written.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QCryptoPipeline::decryptAesBlockCipher(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher)
+{
+    try {
+        /* Initialize EVP_CIPHER_CTX */
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> decryptionCipher { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free };
+        if (!decryptionCipher) {
+            throw std::runtime_error("Couldn't initialize \'decryptionCipher\'. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize decryption operation. */
+        if (!EVP_DecryptInit_ex(decryptionCipher.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()))) {
+            throw std::runtime_error("Couldn't initialize decryption operation. EVP_DecryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        run(decryptionCipher.get(), source, sink);
+
+        return true;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCryptoPipeline::encryptAesGcm - Function encrypts stream with AES GCM algorithm.
+/// \param source - Device with data that will be encrypted.
+/// \param sink - Device where encrypted data will be written.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param tag - Authentication tag. Will be written by function.
+/// \param aad - Additional authenticated data. Must be used in decryption.
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QCryptoPipeline::encryptAesGcm(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv, QByteArray& tag,
+    const QByteArray& aad, const EVP_CIPHER* cipher)
+{
+    try {
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> encryptionCipher = QGcm::createContext(cipher, key, iv, aad, true);
+
+        run(encryptionCipher.get(), source, sink);
+
+        /* Get the tag */
+        tag.resize(16);
+        QGcm::getTag(encryptionCipher.get(), tag.data(), tag.size());
+
+        return true;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCryptoPipeline::decryptAesGcm - Function decrypts stream with AES GCM algorithm.
+/// \param source - Device with data that will be decrypted.
+/// \param sink - Device where decrypted data will be written.
+/// \param key - AES key. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initialization vector. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param tag - Authentication tag from encryption.
+/// \param aad - Additional authenticated data.
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (gcm) - 128, 192, 256. Example: EVP_aes_256_gcm().
+/// \return Returns 'true' on success. Throws, if authentication fails.
+///
+bool QSimpleCrypto::QCryptoPipeline::decryptAesGcm(QIODevice* source, QIODevice* sink, const QByteArray& key, const QByteArray& iv, const QByteArray& tag,
+    const QByteArray& aad, const EVP_CIPHER* cipher)
+{
+    try {
+        std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> decryptionCipher = QGcm::createContext(cipher, key, iv, aad, false);
+
+        /* Set expected tag value. Checked when last block is finalized */
+        QGcm::setTag(decryptionCipher.get(), tag.constData(), tag.size());
+
+        run(decryptionCipher.get(), source, sink);
+
+        return true;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCryptoPipeline::statistics - Function returns statistics of last run. Can be called from any thread, also while pipeline runs.
+/// \return Returns bytes, wall time and busy time of every stage.
+///
+QSimpleCrypto::QCryptoPipeline::Statistics QSimpleCrypto::QCryptoPipeline::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    return m_statistics;
+}
+
+///
+/// \brief QSimpleCrypto::QCryptoPipeline::run - Function runs reader, cipher and writer stages over initialized cipher context.
+/// \param context - Initialized OpenSSL EVP_CIPHER_CTX.
+/// \param source - Source device.
+/// \param sink - Sink device.
+///
+void QSimpleCrypto::QCryptoPipeline::run(EVP_CIPHER_CTX* context, QIODevice* source, QIODevice* sink)
+{
+    if (!source || !sink || !source->isOpen() || !sink->isOpen()) {
+        throw std::runtime_error("Pipeline devices must be open.");
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    /* Free blocks go back to the stage that fills them, so memory is bounded by depth */
+    PipelineQueue freeInput, readQueue, freeOutput, writeQueue;
+    for (qint32 i = 0; i < m_depth; ++i) {
+        freeInput.push(PipelineBlock { QByteArray(m_bufferSize, Qt::Uninitialized), 0 });
+        freeOutput.push(PipelineBlock { QByteArray(m_bufferSize + EVP_MAX_BLOCK_LENGTH, Qt::Uninitialized), 0 });
+    }
+
+    /* First failure stops all stages */
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    const auto fail = [&](std::exception_ptr exception) {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = exception;
+            }
+        }
+
+        freeInput.abort();
+        readQueue.abort();
+        freeOutput.abort();
+        writeQueue.abort();
+    };
+    const auto failed = [&]() {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        return static_cast<bool>(error);
+    };
+
+    /* Stages run on different threads, so counters are published to m_statistics only after they finish */
+    std::atomic<qint64> readTime { 0 };
+    std::atomic<qint64> writeTime { 0 };
+    std::atomic<qint64> bytesWritten { 0 };
+    qint64 cipherTime = 0;
+    qint64 bytesRead = 0;
+
+    std::thread reader([&]() {
+        try {
+            PipelineBlock block;
+            while (freeInput.pop(block)) {
+                QElapsedTimer readTimer;
+                readTimer.start();
+
+                /* Fill whole buffer, so cipher always gets large blocks */
+                block.size = 0;
+                while (block.size < m_bufferSize) {
+                    const qint64 length = source->read(block.data.data() + block.size, m_bufferSize - block.size);
+                    if (length < 0) {
+                        throw std::runtime_error("Couldn't read from source device. Error: " + source->errorString().toUtf8());
+                    }
+
+                    if (length == 0) {
+                        break;
+                    }
+
+                    block.size += length;
+                }
+
+                readTime += readTimer.nsecsElapsed();
+
+                if (block.size == 0) {
+                    break;
+                }
+
+                const bool last = block.size < m_bufferSize;
+                if (!readQueue.push(std::move(block)) || last) {
+                    break;
+                }
+            }
+
+            readQueue.close();
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    std::thread writer([&]() {
+        try {
+            PipelineBlock block;
+            while (writeQueue.pop(block)) {
+                QElapsedTimer writeTimer;
+                writeTimer.start();
+
+                qint64 written = 0;
+                while (written < block.size) {
+                    const qint64 length = sink->write(block.data.constData() + written, block.size - written);
+                    if (length <= 0) {
+                        throw std::runtime_error("Couldn't write to sink device. Error: " + sink->errorString().toUtf8());
+                    }
+
+                    written += length;
+                }
+
+                writeTime += writeTimer.nsecsElapsed();
+                bytesWritten += written;
+
+                if (!freeOutput.push(std::move(block))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    /* Cipher stage runs on calling thread */
+    try {
+        PipelineBlock input;
+        PipelineBlock output;
+
+        while (readQueue.pop(input)) {
+            if (!freeOutput.pop(output)) {
+                break;
+            }
+
+            QElapsedTimer cipherTimer;
+            cipherTimer.start();
+
+            qint32 length = 0;
+            if (!EVP_CipherUpdate(context, reinterpret_cast<unsigned char*>(output.data.data()), &length,
+                    reinterpret_cast<const unsigned char*>(input.data.constData()), static_cast<qint32>(input.size))) {
+                throw std::runtime_error("Couldn't transform block. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            cipherTime += cipherTimer.nsecsElapsed();
+            bytesRead += input.size;
+            output.size = length;
+
+            if (!writeQueue.push(std::move(output)) || !freeInput.push(std::move(input))) {
+                break;
+            }
+        }
+
+        /* Finalize only if all data went through cipher */
+        if (!failed() && freeOutput.pop(output)) {
+            qint32 length = 0;
+            if (!EVP_CipherFinal_ex(context, reinterpret_cast<unsigned char*>(output.data.data()), &length)) {
+                throw std::runtime_error("Couldn't finalize stream. EVP_CipherFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            output.size = length;
+            writeQueue.push(std::move(output));
+        }
+
+        writeQueue.close();
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    reader.join();
+    writer.join();
+
+    {
+        std::lock_guard<std::mutex> lock(m_statisticsMutex);
+        m_statistics.bytesRead = bytesRead;
+        m_statistics.bytesWritten = bytesWritten;
+        m_statistics.elapsed = timer.nsecsElapsed();
+        m_statistics.readTime = readTime;
+        m_statistics.cipherTime = cipherTime;
+        m_statistics.writeTime = writeTime;
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
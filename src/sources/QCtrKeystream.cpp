@@ -0,0 +1,257 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QCtrKeystream.h"
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::QCtrKeystream - Initializes CTR session, fills ring buffer and starts background thread.
+/// \param key - AES key. Size must match cipher key length. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param iv - Initial counter block with 16 bytes.
+/// \param cipher - OpenSSL EVP_CIPHER in CTR mode - 128, 192, 256. Example: EVP_aes_256_ctr().
+/// \param ringSize - Size of ring buffer. Must be power of two and at least two chunks.
+///
+QSimpleCrypto::QCtrKeystream::QCtrKeystream(const QByteArray& key, const QByteArray& iv, const EVP_CIPHER* cipher, const qint64 ringSize)
+{
+    try {
+        if (EVP_CIPHER_get_mode(cipher) != EVP_CIPH_CTR_MODE) {
+            throw std::runtime_error("Keystream session can be used only with CTR mode.");
+        }
+
+        if (key.size() != EVP_CIPHER_get_key_length(cipher)) {
+            throw std::runtime_error("Key size doesn't match cipher key length.");
+        }
+
+        if (iv.size() != AES_BLOCK_SIZE) {
+            throw std::runtime_error("Initial counter block must have 16 bytes.");
+        }
+
+        /* Power of two lets ring position be computed with mask */
+        if (ringSize < 2 * ctrKeystreamChunkSize || (ringSize & (ringSize - 1)) != 0) {
+            throw std::runtime_error("Ring size must be power of two and at least two chunks.");
+        }
+
+        /* Initialize EVP_CIPHER_CTX */
+        m_context.reset(EVP_CIPHER_CTX_new());
+        if (!m_context) {
+            throw std::runtime_error("Couldn't initialize cipher context. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_EncryptInit_ex(m_context.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), reinterpret_cast<const unsigned char*>(iv.data()))) {
+            throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Keystream is cipher text of zeros */
+        m_ringSize = ringSize;
+        m_ring.reset(new unsigned char[static_cast<size_t>(ringSize)]());
+
+        /* First fill is synchronous, so session is hot when constructor returns */
+        generate();
+
+        m_producer = std::thread(&QCtrKeystream::produce, this);
+    } catch (const std::exception& exception) {
+        /* Destructor isn't called for partially constructed object */
+        if (m_ring) {
+            OPENSSL_cleanse(m_ring.get(), static_cast<size_t>(m_ringSize));
+        }
+
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::~QCtrKeystream - Stops background thread and cleans keystream.
+///
+QSimpleCrypto::QCtrKeystream::~QCtrKeystream()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+    m_condition.notify_one();
+
+    if (m_producer.joinable()) {
+        m_producer.join();
+    }
+
+    if (m_ring) {
+        OPENSSL_cleanse(m_ring.get(), static_cast<size_t>(m_ringSize));
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::encrypt - Function encrypts data with next part of keystream.
+/// \param data - Pointer to data that will be encrypted.
+/// \param size - Size of data.
+/// \param output - Output buffer with at least 'size' bytes. May be equal to 'data'.
+/// \return Returns position of first used keystream byte.
+///
+qint64 QSimpleCrypto::QCtrKeystream::encrypt(const unsigned char* data, const qint64 size, unsigned char* output)
+{
+    return transform(data, size, output);
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::encrypt - Function encrypts data with next part of keystream.
+/// \param data - Data that will be encrypted in place.
+/// \return Returns position of first used keystream byte.
+///
+qint64 QSimpleCrypto::QCtrKeystream::encrypt(QByteArray& data)
+{
+    unsigned char* buffer = reinterpret_cast<unsigned char*>(data.data());
+    return transform(buffer, data.size(), buffer);
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::decrypt - Function decrypts data with next part of keystream. CTR decryption is the same XOR as encryption.
+/// \param data - Pointer to data that will be decrypted.
+/// \param size - Size of data.
+/// \param output - Output buffer with at least 'size' bytes. May be equal to 'data'.
+/// \return Returns position of first used keystream byte.
+///
+qint64 QSimpleCrypto::QCtrKeystream::decrypt(const unsigned char* data, const qint64 size, unsigned char* output)
+{
+    return transform(data, size, output);
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::decrypt - Function decrypts data with next part of keystream. CTR decryption is the same XOR as encryption.
+/// \param data - Data that will be decrypted in place.
+/// \return Returns position of first used keystream byte.
+///
+qint64 QSimpleCrypto::QCtrKeystream::decrypt(QByteArray& data)
+{
+    unsigned char* buffer = reinterpret_cast<unsigned char*>(data.data());
+    return transform(buffer, data.size(), buffer);
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::position - Function returns number of keystream bytes already used.
+/// \return Returns position of next keystream byte.
+///
+qint64 QSimpleCrypto::QCtrKeystream::position() const
+{
+    return m_consumed.load(std::memory_order_relaxed);
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::available - Function returns number of precomputed keystream bytes, that can be used without waiting.
+/// \return Returns number of ready bytes.
+///
+qint64 QSimpleCrypto::QCtrKeystream::available() const
+{
+    return m_produced.load(std::memory_order_acquire) - m_consumed.load(std::memory_order_relaxed);
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::generate - Function generates keystream into ring buffer until it is full.
+///
+void QSimpleCrypto::QCtrKeystream::generate()
+{
+    const qint64 mask = m_ringSize - 1;
+    qint64 produced = m_produced.load(std::memory_order_relaxed);
+
+    while (m_ringSize - (produced - m_consumed.load(std::memory_order_acquire)) >= ctrKeystreamChunkSize) {
+        /* Chunk size divides ring size, so chunk never wraps */
+        unsigned char* chunk = m_ring.get() + (produced & mask);
+        qint32 length = 0;
+
+        std::fill(chunk, chunk + ctrKeystreamChunkSize, 0);
+        if (!EVP_EncryptUpdate(m_context.get(), chunk, &length, chunk, ctrKeystreamChunkSize)) {
+            throw std::runtime_error("Couldn't generate keystream. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Publish chunk to consumer */
+        produced += ctrKeystreamChunkSize;
+        m_produced.store(produced, std::memory_order_release);
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::produce - Background thread function, that refills ring buffer.
+///
+void QSimpleCrypto::QCtrKeystream::produce()
+{
+    try {
+        while (true) {
+            {
+                /* Sleep until half of ring is used. Consumer wakes producer only when it is waiting */
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_producerWaiting = true;
+                m_condition.wait(lock, [this]() {
+                    return m_stopped || m_produced.load() - m_consumed.load() <= m_ringSize / 2;
+                });
+                m_producerWaiting = false;
+
+                if (m_stopped) {
+                    return;
+                }
+            }
+
+            generate();
+        }
+    } catch (...) {
+        m_error = std::current_exception();
+        m_failed.store(true, std::memory_order_release);
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QCtrKeystream::transform - Function XORs data with next part of keystream.
+/// \param data - Pointer to data.
+/// \param size - Size of data.
+/// \param output - Output buffer with at least 'size' bytes.
+/// \return Returns position of first used keystream byte.
+///
+qint64 QSimpleCrypto::QCtrKeystream::transform(const unsigned char* data, qint64 size, unsigned char* output)
+{
+    const qint64 mask = m_ringSize - 1;
+    const qint64 start = m_consumed.load(std::memory_order_relaxed);
+    qint64 consumed = start;
+
+    while (size > 0) {
+        const qint64 ready = m_produced.load(std::memory_order_acquire) - consumed;
+
+        /* Message is larger than precomputed keystream. Wait for producer */
+        if (ready == 0) {
+            if (m_failed.load(std::memory_order_acquire)) {
+                std::rethrow_exception(m_error);
+            }
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        /* XOR up to the end of ready keystream or ring, whichever comes first */
+        const qint64 offset = consumed & mask;
+        const qint64 length = std::min({ size, ready, m_ringSize - offset });
+        unsigned char* keystream = m_ring.get() + offset;
+
+        for (qint64 i = 0; i < length; ++i) {
+            output[i] = data[i] ^ keystream[i];
+        }
+
+        /* Used keystream is wiped before it is given back to producer, so ring holds only unused bytes */
+        OPENSSL_cleanse(keystream, static_cast<size_t>(length));
+
+        data += length;
+        output += length;
+        size -= length;
+        consumed += length;
+
+        m_consumed.store(consumed);
+
+        if (m_producerWaiting.load() && m_produced.load(std::memory_order_relaxed) - consumed <= m_ringSize / 2) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_condition.notify_one();
+        }
+    }
+
+    return start;
+}
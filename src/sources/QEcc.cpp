@@ -0,0 +1,350 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QEcc.h"
+#include "include/QRsa.h"
+
+QSimpleCrypto::QEcc::QEcc()
+{
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::generateEccKeys - Function generates key pair on curve.
+/// \param curve - Curve. Example: QEcc::Curve::Ed25519.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QEcc::generateEccKeys(const Curve curve)
+{
+    try {
+        EVP_PKEY* key = nullptr;
+        switch (curve) {
+        case Curve::Ed25519:
+            key = EVP_PKEY_Q_keygen(nullptr, nullptr, "ED25519");
+            break;
+        case Curve::P256:
+            key = EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", "P-256");
+            break;
+        case Curve::X25519:
+            key = EVP_PKEY_Q_keygen(nullptr, nullptr, "X25519");
+            break;
+        }
+
+        if (!key) {
+            throw std::runtime_error("Couldn't generate EVP_PKEY key. EVP_PKEY_Q_keygen(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return key;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::savePublicKey - Saves to file public key in PEM format.
+/// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param filePath - Path and file name where the file will be saved. Example: "/root/ec.pem"
+///
+void QSimpleCrypto::QEcc::savePublicKey(EVP_PKEY* key, const QByteArray& filePath)
+{
+    try {
+        std::unique_ptr<BIO, void (*)(BIO*)> publicKeyFile { BIO_new_file(filePath.constData(), "w+"), BIO_free_all };
+        if (!publicKeyFile) {
+            throw std::runtime_error("Couldn't initialize publicKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!PEM_write_bio_PUBKEY(publicKeyFile.get(), key)) {
+            throw std::runtime_error("Couldn't save public key. PEM_write_bio_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::savePrivateKey - Saves to file private key in PKCS#8 PEM format.
+/// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param filePath - Path and file name where the file will be saved. Example: "/root/ec.pem"
+/// \param password - Private key password.
+/// \param cipher - Cipher that encrypts key, when password is set. Example: EVP_aes_256_cbc().
+///
+void QSimpleCrypto::QEcc::savePrivateKey(EVP_PKEY* key, const QByteArray& filePath, const QByteArray& password, const EVP_CIPHER* cipher)
+{
+    try {
+        std::unique_ptr<BIO, void (*)(BIO*)> privateKeyFile { BIO_new_file(filePath.constData(), "w+"), BIO_free_all };
+        if (!privateKeyFile) {
+            throw std::runtime_error("Couldn't initialize privateKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Password without cipher would be silently ignored, so AES-256-CBC is used */
+        const EVP_CIPHER* keyCipher = password.isEmpty() ? nullptr : (cipher ? cipher : EVP_aes_256_cbc());
+        if (!PEM_write_bio_PKCS8PrivateKey(privateKeyFile.get(), key, keyCipher, password.isEmpty() ? nullptr : password.constData(), password.size(), nullptr, nullptr)) {
+            throw std::runtime_error("Couldn't save private key. PEM_write_bio_PKCS8PrivateKey(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::getPublicKeyFromFile - Gets public key from PEM file.
+/// \param filePath - File path to public key file.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QEcc::getPublicKeyFromFile(const QByteArray& filePath)
+{
+    try {
+        std::unique_ptr<BIO, void (*)(BIO*)> publicKeyFile { BIO_new_file(filePath.constData(), "r"), BIO_free_all };
+        if (!publicKeyFile) {
+            throw std::runtime_error("Couldn't initialize publicKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        EVP_PKEY* key = PEM_read_bio_PUBKEY(publicKeyFile.get(), nullptr, nullptr, nullptr);
+        if (!key) {
+            throw std::runtime_error("Couldn't read public key. PEM_read_bio_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return key;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::getPrivateKeyFromFile - Gets private key from PEM file.
+/// \param filePath - File path to private key file.
+/// \param password - Private key password.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QEcc::getPrivateKeyFromFile(const QByteArray& filePath, const QByteArray& password)
+{
+    try {
+        std::unique_ptr<BIO, void (*)(BIO*)> privateKeyFile { BIO_new_file(filePath.constData(), "r"), BIO_free_all };
+        if (!privateKeyFile) {
+            throw std::runtime_error("Couldn't initialize privateKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Empty password is passed as empty string, so OpenSSL doesn't prompt on terminal */
+        EVP_PKEY* key = PEM_read_bio_PrivateKey(privateKeyFile.get(), nullptr, nullptr, const_cast<char*>(password.constData()));
+        if (!key) {
+            throw std::runtime_error("Couldn't read private key. PEM_read_bio_PrivateKey(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return key;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::publicKeyToDer - Function encodes public key as DER SubjectPublicKeyInfo.
+/// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \details Encoding doesn't depend on key type, so QRsa encoder is used.
+/// \return Returns DER bytes.
+///
+QByteArray QSimpleCrypto::QEcc::publicKeyToDer(EVP_PKEY* key)
+{
+    return QRsa().publicKeyToDer(key);
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::privateKeyToDer - Function encodes private key as unencrypted DER PKCS#8.
+/// \param key - EC key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \details Encoding doesn't depend on key type, so QRsa encoder is used.
+/// \return Returns DER bytes.
+///
+QByteArray QSimpleCrypto::QEcc::privateKeyToDer(EVP_PKEY* key)
+{
+    return QRsa().privateKeyToDer(key);
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::publicKeyFromDer - Function decodes public key from DER SubjectPublicKeyInfo.
+/// \param der - DER bytes.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QEcc::publicKeyFromDer(const QByteArray& der)
+{
+    try {
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(der.constData());
+        EVP_PKEY* key = d2i_PUBKEY(nullptr, &input, der.size());
+        if (!key) {
+            throw std::runtime_error("Couldn't decode public key. d2i_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return key;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::privateKeyFromDer - Function decodes private key from unencrypted DER PKCS#8.
+/// \param der - DER bytes.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QEcc::privateKeyFromDer(const QByteArray& der)
+{
+    try {
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(der.constData());
+        EVP_PKEY* key = d2i_AutoPrivateKey(nullptr, &input, der.size());
+        if (!key) {
+            throw std::runtime_error("Couldn't decode private key. d2i_AutoPrivateKey(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return key;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::sign - Function signs data with Ed25519 or ECDSA private key.
+/// \param data - Data that will be signed.
+/// \param key - Ed25519 or P-256 private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param md - Hash algorithm for ECDSA (OpenSSL EVP_MD). Example: EVP_sha256(). Ignored for Ed25519, that hashes data itself.
+/// \return Returns signature. Ed25519 signature has 64 bytes, ECDSA signature is DER encoded.
+///
+QByteArray QSimpleCrypto::QEcc::sign(const QByteArray& data, EVP_PKEY* key, const EVP_MD* md)
+{
+    try {
+        std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX*)> context { EVP_MD_CTX_new(), EVP_MD_CTX_free };
+        if (!context) {
+            throw std::runtime_error("Couldn't initialize EVP_MD_CTX. EVP_MD_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (EVP_DigestSignInit(context.get(), nullptr, signatureHash(key, md), nullptr, key) <= 0) {
+            throw std::runtime_error("Couldn't initialize signing operation. EVP_DigestSignInit(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Ed25519 can't sign in parts, so data is passed at once for both key types */
+        std::size_t signatureLength = 0;
+        if (EVP_DigestSign(context.get(), nullptr, &signatureLength, reinterpret_cast<const unsigned char*>(data.constData()), data.size()) <= 0) {
+            throw std::runtime_error("Couldn't determine signature length. EVP_DigestSign(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        QByteArray signature(static_cast<qint32>(signatureLength), Qt::Uninitialized);
+        if (EVP_DigestSign(context.get(), reinterpret_cast<unsigned char*>(signature.data()), &signatureLength, reinterpret_cast<const unsigned char*>(data.constData()), data.size()) <= 0) {
+            throw std::runtime_error("Couldn't sign data. EVP_DigestSign(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* ECDSA signature is DER encoded and may be shorter than maximum */
+        signature.resize(static_cast<qint32>(signatureLength));
+        return signature;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::verify - Function verifies Ed25519 or ECDSA signature.
+/// \param data - Signed data.
+/// \param signature - Signature.
+/// \param key - Ed25519 or P-256 public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param md - Hash algorithm for ECDSA (OpenSSL EVP_MD). Example: EVP_sha256(). Ignored for Ed25519.
+/// \return Returns 'true' if signature is valid.
+///
+bool QSimpleCrypto::QEcc::verify(const QByteArray& data, const QByteArray& signature, EVP_PKEY* key, const EVP_MD* md)
+{
+    try {
+        std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX*)> context { EVP_MD_CTX_new(), EVP_MD_CTX_free };
+        if (!context) {
+            throw std::runtime_error("Couldn't initialize EVP_MD_CTX. EVP_MD_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (EVP_DigestVerifyInit(context.get(), nullptr, signatureHash(key, md), nullptr, key) <= 0) {
+            throw std::runtime_error("Couldn't initialize verification operation. EVP_DigestVerifyInit(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Invalid signature is a result, not an error, so its reason is not left in error queue */
+        const bool valid = EVP_DigestVerify(context.get(), reinterpret_cast<const unsigned char*>(signature.constData()), signature.size(),
+                               reinterpret_cast<const unsigned char*>(data.constData()), data.size())
+            == 1;
+        if (!valid) {
+            ERR_clear_error();
+        }
+
+        return valid;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::deriveSharedSecret - Function computes X25519 or ECDH shared secret.
+/// \param privateKey - Own X25519 or P-256 private key.
+/// \param peerPublicKey - Public key of peer on the same curve.
+/// \return Returns shared secret. 32 bytes for both curves.
+///
+QByteArray QSimpleCrypto::QEcc::deriveSharedSecret(EVP_PKEY* privateKey, EVP_PKEY* peerPublicKey)
+{
+    try {
+        std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> context { EVP_PKEY_CTX_new(privateKey, nullptr), EVP_PKEY_CTX_free };
+        if (!context) {
+            throw std::runtime_error("Couldn't initialize EVP_PKEY_CTX. EVP_PKEY_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (EVP_PKEY_derive_init(context.get()) <= 0) {
+            throw std::runtime_error("Couldn't initialize key agreement. EVP_PKEY_derive_init(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Peer key is checked to be on the same curve */
+        if (EVP_PKEY_derive_set_peer(context.get(), peerPublicKey) <= 0) {
+            throw std::runtime_error("Couldn't set peer key. EVP_PKEY_derive_set_peer(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        std::size_t secretLength = 0;
+        if (EVP_PKEY_derive(context.get(), nullptr, &secretLength) <= 0) {
+            throw std::runtime_error("Couldn't determine shared secret length. EVP_PKEY_derive(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        QByteArray secret(static_cast<qint32>(secretLength), Qt::Uninitialized);
+        if (EVP_PKEY_derive(context.get(), reinterpret_cast<unsigned char*>(secret.data()), &secretLength) <= 0) {
+            throw std::runtime_error("Couldn't derive shared secret. EVP_PKEY_derive(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        secret.resize(static_cast<qint32>(secretLength));
+        return secret;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEcc::signatureHash - Function returns hash, that must be passed to OpenSSL for key type.
+/// \param key - Signature key.
+/// \param md - Hash requested by caller.
+/// \return Returns 'nullptr' for Ed25519 and 'md' for other keys.
+///
+const EVP_MD* QSimpleCrypto::QEcc::signatureHash(EVP_PKEY* key, const EVP_MD* md)
+{
+    if (!key) {
+        throw std::runtime_error("Key must be provided.");
+    }
+
+    return EVP_PKEY_get_id(key) == EVP_PKEY_ED25519 ? nullptr : md;
+}
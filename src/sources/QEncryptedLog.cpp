@@ -0,0 +1,550 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QEncryptedLog.h"
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace {
+///
+/// \brief logMagic - First bytes of log file.
+///
+const char logMagic[] = "QSCLOG01";
+
+///
+/// \brief logTagLength - Length of AES GCM tag in record header.
+///
+constexpr qint32 logTagLength = 16;
+
+///
+/// \brief logIndexEntrySize - Size of one index entry.
+///
+constexpr qint64 logIndexEntrySize = 8;
+
+///
+/// \brief logIndexHeaderSize - Size of index header, that holds end offset of records known to be on storage.
+///
+constexpr qint64 logIndexHeaderSize = 8;
+
+///
+/// \brief logIndexInitialCapacity - Number of index entries reserved for new index.
+///
+constexpr qint64 logIndexInitialCapacity = 1024;
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::QEncryptedLog - Opens or creates log, recovers it after crash and starts group commit thread.
+/// \param filePath - Path to log file. Index is stored next to it with '.idx' suffix.
+/// \param key - AES-256 key with 32 bytes.
+/// \param groupCommitRecords - Number of unsynced records, that starts group commit.
+/// \param groupCommitInterval - Time in milliseconds, after which unsynced records are synced.
+///
+QSimpleCrypto::QEncryptedLog::QEncryptedLog(const QString& filePath, const QByteArray& key, const qint32 groupCommitRecords, const qint32 groupCommitInterval)
+    : m_writer(filePath)
+    , m_reader(filePath)
+    , m_indexFile(filePath + ".idx")
+    , m_key(key)
+    , m_groupCommitRecords(qMax(1, groupCommitRecords))
+    , m_groupCommitInterval(qMax(1, groupCommitInterval))
+{
+    try {
+        if (key.size() != 32) {
+            throw std::runtime_error("Log key must have 32 bytes.");
+        }
+
+        /* Writer is unbuffered, so group commit can sync descriptor while another thread appends */
+        if (!m_writer.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+            throw std::runtime_error("Couldn't open log file. QFile::open(). Error: " + m_writer.errorString().toStdString());
+        }
+
+        /* Two writers would read the same epoch and reuse nonces, so lock is taken before header is read */
+        if (!QFileSync::tryLockExclusive(m_writer.handle())) {
+            throw std::runtime_error("Log is already open by another object or process.");
+        }
+
+        /* New or torn file gets fresh header */
+        if (m_writer.size() < logFileHeaderSize) {
+            QByteArray header(logFileHeaderSize, 0);
+            std::memcpy(header.data(), logMagic, 8);
+            std::memcpy(header.data() + 16, keyCheck().constData(), logTagLength);
+
+            if (!m_writer.resize(0) || !m_writer.seek(0) || m_writer.write(header) != header.size()) {
+                throw std::runtime_error("Couldn't write log header. Error: " + m_writer.errorString().toStdString());
+            }
+        }
+
+        QByteArray header(logFileHeaderSize, 0);
+        if (!m_writer.seek(0) || m_writer.read(header.data(), logFileHeaderSize) != logFileHeaderSize || std::memcmp(header.constData(), logMagic, 8) != 0) {
+            throw std::runtime_error("File is not encrypted log.");
+        }
+
+        /* Wrong key would make recovery drop valid records */
+        if (CRYPTO_memcmp(header.constData() + 16, keyCheck().constData(), logTagLength) != 0) {
+            throw std::runtime_error("Log is encrypted with another key.");
+        }
+
+        /* Every open gets new epoch, so offsets reused after recovery never repeat nonce */
+        const quint32 epoch = qFromLittleEndian<quint32>(header.constData() + 8);
+        if (epoch == std::numeric_limits<quint32>::max()) {
+            throw std::runtime_error("Log epoch is exhausted.");
+        }
+
+        m_epoch = epoch + 1;
+        qToLittleEndian<quint32>(m_epoch, header.data() + 8);
+
+        /* Epoch must be on storage before first record uses it */
+        if (!m_writer.seek(0) || m_writer.write(header) != header.size()) {
+            throw std::runtime_error("Couldn't update log epoch. Error: " + m_writer.errorString().toStdString());
+        }
+
+        QFileSync::syncData(m_writer);
+
+        if (!m_reader.open(QIODevice::ReadOnly)) {
+            throw std::runtime_error("Couldn't open log file for reading. QFile::open(). Error: " + m_reader.errorString().toStdString());
+        }
+
+        if (!m_indexFile.open(QIODevice::ReadWrite)) {
+            throw std::runtime_error("Couldn't open log index. QFile::open(). Error: " + m_indexFile.errorString().toStdString());
+        }
+
+        recover();
+
+        m_committer = std::thread(&QEncryptedLog::commit, this);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::~QEncryptedLog - Syncs remaining records and closes log.
+///
+QSimpleCrypto::QEncryptedLog::~QEncryptedLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_syncMutex);
+        m_stopped = true;
+    }
+    m_commitCondition.notify_all();
+
+    if (m_committer.joinable()) {
+        m_committer.join();
+    }
+
+    try {
+        if (!m_failed && m_writer.isOpen()) {
+            waitDurable(m_count);
+        }
+    } catch (...) {
+    }
+
+    if (m_index) {
+        m_indexFile.unmap(m_index);
+    }
+
+    OPENSSL_cleanse(m_key.data(), static_cast<size_t>(m_key.size()));
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::append - Function encrypts record and appends it to log.
+/// \param data - Record data.
+/// \param durable - If 'true', function waits until record is synced to storage.
+/// \return Returns number of record.
+///
+qint64 QSimpleCrypto::QEncryptedLog::append(const QByteArray& data, const bool durable)
+{
+    try {
+        if (m_failed) {
+            throw std::runtime_error("Log is failed and doesn't accept records.");
+        }
+
+        if (data.size() > std::numeric_limits<qint32>::max() - logRecordHeaderSize) {
+            throw std::runtime_error("Record is too large.");
+        }
+
+        qint64 record = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(m_appendMutex);
+
+            const qint64 offset = m_end;
+
+            QByteArray header(logRecordHeaderSize, 0);
+            qToLittleEndian<quint32>(static_cast<quint32>(data.size()), header.data());
+            qToLittleEndian<quint32>(m_epoch, header.data() + 4);
+
+            /* Length and epoch are authenticated, offset is bound through nonce */
+            QByteArray tag(logTagLength, 0);
+            const QByteArray cipherText = QAead().encryptAesGcm(data, m_key, nonce(m_epoch, offset), tag, header.left(8));
+            std::memcpy(header.data() + 8, tag.constData(), logTagLength);
+
+            /* Failed write leaves unknown bytes at offset. Next record would reuse nonce, so log stops accepting records */
+            if (!m_writer.seek(offset) || m_writer.write(header + cipherText) != logRecordHeaderSize + cipherText.size()) {
+                m_failed = true;
+                throw std::runtime_error("Couldn't write record. Error: " + m_writer.errorString().toStdString());
+            }
+
+            record = m_count;
+            if (record % logIndexInterval == 0) {
+                setIndexEntry(record / logIndexInterval, offset);
+            }
+
+            m_end = offset + logRecordHeaderSize + cipherText.size();
+            m_count.store(record + 1);
+        }
+
+        if (durable) {
+            waitDurable(record + 1);
+        } else if (m_count - m_synced >= m_groupCommitRecords) {
+            std::lock_guard<std::mutex> lock(m_syncMutex);
+            m_commitCondition.notify_one();
+        }
+
+        return record;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::sync - Function waits until all appended records are synced to storage.
+///
+void QSimpleCrypto::QEncryptedLog::sync()
+{
+    waitDurable(m_count);
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::read - Function reads and decrypts one record.
+/// \param record - Number of record.
+/// \return Returns record data. Throws, if record is out of range or fails authentication.
+///
+QByteArray QSimpleCrypto::QEncryptedLog::read(const qint64 record)
+{
+    try {
+        if (record < 0 || record >= m_count) {
+            throw std::runtime_error("Record number is out of range.");
+        }
+
+        std::lock_guard<std::mutex> lock(m_readMutex);
+
+        /* Start from nearest indexed record and skip headers, without decrypting skipped records */
+        qint64 offset = indexEntry(record / logIndexInterval);
+        QByteArray header;
+        QByteArray cipherText;
+
+        for (qint64 skipped = record - record % logIndexInterval; skipped < record; ++skipped) {
+            if (!readRecord(offset, header, nullptr)) {
+                throw std::runtime_error("Log record header is corrupted.");
+            }
+
+            offset += logRecordHeaderSize + qFromLittleEndian<quint32>(header.constData());
+        }
+
+        if (!readRecord(offset, header, &cipherText)) {
+            throw std::runtime_error("Log record header is corrupted.");
+        }
+
+        return decryptRecord(offset, header, cipherText);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::count - Function returns number of records in log.
+/// \return Returns number of records.
+///
+qint64 QSimpleCrypto::QEncryptedLog::count() const
+{
+    return m_count;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::keyCheck - Function computes tag, that tells if log is opened with right key.
+/// \return Returns 16 bytes tag.
+///
+QByteArray QSimpleCrypto::QEncryptedLog::keyCheck()
+{
+    QByteArray tag(logTagLength, 0);
+    (void)QAead().encryptAesGcm(QByteArray(), m_key, nonce(0, 0), tag, QByteArray(logMagic, 8));
+
+    return tag;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::recover - Function finds last valid record, rebuilds index tail and truncates torn data.
+///
+void QSimpleCrypto::QEncryptedLog::recover()
+{
+    const qint64 fileSize = m_reader.size();
+
+    mapIndex(qMax((m_indexFile.size() - logIndexHeaderSize) / logIndexEntrySize, logIndexInitialCapacity));
+
+    /* Synced end is written only after fsync, so records before it are on storage. Entries past it may point to lost records */
+    qint64 syncedEnd = static_cast<qint64>(qFromLittleEndian<quint64>(m_index));
+    if (syncedEnd < logFileHeaderSize || syncedEnd > fileSize) {
+        syncedEnd = logFileHeaderSize;
+    }
+
+    /* Index is synced lazily, so trust only increasing entries that point to valid headers */
+    qint64 entries = 0;
+    while (entries < m_indexCapacity) {
+        const qint64 offset = indexEntry(entries);
+        const qint64 previous = (entries == 0) ? 0 : indexEntry(entries - 1);
+
+        if ((entries == 0 && offset != logFileHeaderSize) || offset <= previous || offset >= syncedEnd) {
+            break;
+        }
+
+        ++entries;
+    }
+
+    QByteArray header;
+    while (entries > 0 && !readRecord(indexEntry(entries - 1), header, nullptr)) {
+        --entries;
+    }
+
+    /* Records after last trusted index entry may be torn or lost, so they are authenticated and their entries are rebuilt */
+    qint64 record = (entries > 0) ? (entries - 1) * logIndexInterval : 0;
+    qint64 offset = (entries > 0) ? indexEntry(entries - 1) : logFileHeaderSize;
+    QByteArray cipherText;
+
+    while (readRecord(offset, header, &cipherText)) {
+        try {
+            decryptRecord(offset, header, cipherText);
+        } catch (...) {
+            break;
+        }
+
+        if (record % logIndexInterval == 0) {
+            setIndexEntry(record / logIndexInterval, offset);
+        }
+
+        offset += logRecordHeaderSize + cipherText.size();
+        ++record;
+    }
+
+    /* Forget index entries of lost records */
+    const qint64 usedEntries = (record + logIndexInterval - 1) / logIndexInterval;
+    std::memset(m_index + logIndexHeaderSize + usedEntries * logIndexEntrySize, 0, static_cast<size_t>((m_indexCapacity - usedEntries) * logIndexEntrySize));
+
+    if (fileSize > offset && !m_writer.resize(offset)) {
+        throw std::runtime_error("Couldn't truncate torn log records. Error: " + m_writer.errorString().toStdString());
+    }
+
+    /* Recovered records may be only in page cache after process crash. Index must not keep stale entries, that new records would reach */
+    QFileSync::syncData(m_writer);
+    qToLittleEndian<quint64>(static_cast<quint64>(offset), m_index);
+    QFileSync::syncMapping(m_index, logIndexHeaderSize + m_indexCapacity * logIndexEntrySize);
+
+    m_end = offset;
+    m_count = record;
+    m_synced = record;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::readRecord - Function reads record header and cipher text at offset.
+/// \param offset - Offset of record header.
+/// \param header - Record header with logRecordHeaderSize bytes.
+/// \param cipherText - Cipher text. Not read if 'nullptr'.
+/// \return Returns 'false', if record doesn't fit into file or has invalid epoch.
+///
+bool QSimpleCrypto::QEncryptedLog::readRecord(const qint64 offset, QByteArray& header, QByteArray* cipherText)
+{
+    header.resize(logRecordHeaderSize);
+    if (!m_reader.seek(offset) || m_reader.read(header.data(), logRecordHeaderSize) != logRecordHeaderSize) {
+        return false;
+    }
+
+    /* Zero filled tail after crash has epoch 0, records from future epochs can't exist */
+    const qint64 length = qFromLittleEndian<quint32>(header.constData());
+    const quint32 epoch = qFromLittleEndian<quint32>(header.constData() + 4);
+    if (epoch == 0 || epoch > m_epoch || offset + logRecordHeaderSize + length > m_reader.size()) {
+        return false;
+    }
+
+    if (cipherText) {
+        cipherText->resize(static_cast<qint32>(length));
+        if (m_reader.read(cipherText->data(), length) != length) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::decryptRecord - Function authenticates and decrypts record.
+/// \param offset - Offset of record header.
+/// \param header - Record header.
+/// \param cipherText - Cipher text.
+/// \return Returns record data.
+///
+QByteArray QSimpleCrypto::QEncryptedLog::decryptRecord(const qint64 offset, const QByteArray& header, const QByteArray& cipherText)
+{
+    const quint32 epoch = qFromLittleEndian<quint32>(header.constData() + 4);
+    return QAead().decryptAesGcm(cipherText, m_key, nonce(epoch, offset), header.mid(8, logTagLength), header.left(8));
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::nonce - Function builds record nonce from epoch and offset.
+/// \param epoch - Epoch of record.
+/// \param offset - Offset of record header.
+/// \return Returns 12 bytes nonce.
+///
+QByteArray QSimpleCrypto::QEncryptedLog::nonce(const quint32 epoch, const qint64 offset)
+{
+    QByteArray nonce(12, 0);
+    qToLittleEndian<quint32>(epoch, nonce.data());
+    qToLittleEndian<quint64>(static_cast<quint64>(offset), nonce.data() + 4);
+
+    return nonce;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::indexEntry - Function returns offset of record 'entry * logIndexInterval'.
+/// \param entry - Number of index entry.
+/// \return Returns offset of record.
+///
+qint64 QSimpleCrypto::QEncryptedLog::indexEntry(const qint64 entry)
+{
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    return static_cast<qint64>(qFromLittleEndian<quint64>(m_index + logIndexHeaderSize + entry * logIndexEntrySize));
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::setIndexEntry - Function stores offset of record 'entry * logIndexInterval', growing index when needed.
+/// \param entry - Number of index entry.
+/// \param offset - Offset of record.
+///
+void QSimpleCrypto::QEncryptedLog::setIndexEntry(const qint64 entry, const qint64 offset)
+{
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+
+    if (entry >= m_indexCapacity) {
+        mapIndex(qMax(m_indexCapacity * 2, entry + 1));
+    }
+
+    qToLittleEndian<quint64>(static_cast<quint64>(offset), m_index + logIndexHeaderSize + entry * logIndexEntrySize);
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::mapIndex - Function resizes index file and maps it.
+/// \param capacity - Number of index entries.
+///
+void QSimpleCrypto::QEncryptedLog::mapIndex(const qint64 capacity)
+{
+    if (m_index) {
+        m_indexFile.unmap(m_index);
+        m_index = nullptr;
+    }
+
+    /* New part of file is zero filled, so unused entries read as empty */
+    const qint64 size = logIndexHeaderSize + capacity * logIndexEntrySize;
+    if (m_indexFile.size() < size && !m_indexFile.resize(size)) {
+        throw std::runtime_error("Couldn't resize log index. Error: " + m_indexFile.errorString().toStdString());
+    }
+
+    m_index = m_indexFile.map(0, size);
+    if (!m_index) {
+        throw std::runtime_error("Couldn't map log index. QFile::map(). Error: " + m_indexFile.errorString().toStdString());
+    }
+
+    m_indexCapacity = capacity;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::waitDurable - Function waits until first 'records' records are synced. One caller syncs, others wait for it.
+/// \param records - Number of records.
+///
+void QSimpleCrypto::QEncryptedLog::waitDurable(const qint64 records)
+{
+    std::unique_lock<std::mutex> lock(m_syncMutex);
+
+    while (m_synced < records) {
+        if (m_failed) {
+            throw std::runtime_error("Couldn't sync log to storage.");
+        }
+
+        /* Another caller is syncing. Its sync may already cover our records */
+        if (m_syncing) {
+            m_syncCondition.wait(lock);
+            continue;
+        }
+
+        /* Every record counted here is already written */
+        m_syncing = true;
+        lock.unlock();
+
+        qint64 target = 0;
+        qint64 targetEnd = 0;
+        {
+            std::lock_guard<std::mutex> appendLock(m_appendMutex);
+            target = m_count;
+            targetEnd = m_end;
+        }
+
+        bool synced = true;
+        try {
+            QFileSync::syncHandle(m_writer.handle());
+        } catch (...) {
+            synced = false;
+        }
+
+        lock.lock();
+        m_syncing = false;
+
+        if (!synced) {
+            m_failed = true;
+        } else if (target > m_synced) {
+            m_synced = target;
+
+            /* Written after fsync, so index never claims records, that could still be lost */
+            std::lock_guard<std::mutex> indexLock(m_indexMutex);
+            qToLittleEndian<quint64>(static_cast<quint64>(targetEnd), m_index);
+        }
+
+        m_syncCondition.notify_all();
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedLog::commit - Group commit thread function.
+///
+void QSimpleCrypto::QEncryptedLog::commit()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_syncMutex);
+            m_commitCondition.wait_for(lock, std::chrono::milliseconds(m_groupCommitInterval), [this]() {
+                return m_stopped || m_failed || m_count - m_synced >= m_groupCommitRecords;
+            });
+
+            if (m_stopped || m_failed) {
+                return;
+            }
+        }
+
+        const qint64 records = m_count;
+        if (records > m_synced) {
+            try {
+                waitDurable(records);
+            } catch (...) {
+                return;
+            }
+        }
+    }
+}
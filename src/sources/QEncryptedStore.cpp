@@ -0,0 +1,935 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QEncryptedStore.h"
+
+#include <QHash>
+#include <QVector>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace {
+///
+/// \brief storeMagic - First bytes of data file.
+///
+const char storeMagic[] = "QSCKV001";
+
+///
+/// \brief storeIndexMagic - First bytes of index file.
+///
+const char storeIndexMagic[] = "QSCKVI01";
+
+///
+/// \brief storeKeyHashLength - Length of keyed hash, that identifies key.
+///
+constexpr qint32 storeKeyHashLength = 16;
+
+///
+/// \brief storeNonceLength - Length of AES GCM nonce in record header.
+///
+constexpr qint32 storeNonceLength = 12;
+
+///
+/// \brief storeTagLength - Length of AES GCM tag in record header.
+///
+constexpr qint32 storeTagLength = 16;
+
+///
+/// \brief storeAadLength - Length of record header part, that is authenticated: flags, value length and key hash.
+///
+constexpr qint32 storeAadLength = 24;
+
+///
+/// \brief storeValueRecord - Record flag of stored value.
+///
+constexpr quint32 storeValueRecord = 1;
+
+///
+/// \brief storeRemovalRecord - Record flag of removed key.
+///
+constexpr quint32 storeRemovalRecord = 2;
+
+///
+/// \brief storeEmptySlot - Offset of index slot, that was never used.
+///
+constexpr qint64 storeEmptySlot = 0;
+
+///
+/// \brief storeRemovedSlot - Offset of index slot, which key was removed. Probing continues past it.
+///
+constexpr qint64 storeRemovedSlot = 1;
+
+///
+/// \brief storeInitialSlots - Number of slots in new index.
+///
+constexpr qint64 storeInitialSlots = 1024;
+
+///
+/// \brief deriveKey - Function derives subkey from master key with HMAC-SHA256.
+/// \param key - Master key.
+/// \param label - Purpose of subkey.
+/// \return Returns 32 bytes subkey.
+///
+QByteArray deriveKey(const QByteArray& key, const QByteArray& label)
+{
+    QByteArray subkey(32, 0);
+    quint32 subkeyLength = 0;
+
+    if (!HMAC(EVP_sha256(), key.constData(), key.size(), reinterpret_cast<const unsigned char*>(label.constData()), label.size(),
+            reinterpret_cast<unsigned char*>(subkey.data()), &subkeyLength)) {
+        throw std::runtime_error("Couldn't derive store key. HMAC(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    return subkey;
+}
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::QEncryptedStore - Opens or creates store and starts background compaction.
+/// \param filePath - Path to data file. Index is stored next to it with '.index' suffix.
+/// \param key - Master key with 32 bytes. Encryption and key hash keys are derived from it.
+/// \param backgroundCompaction - If 'true', data file is compacted by background thread.
+/// \details Throws, if store is already open by another object or process.
+///
+QSimpleCrypto::QEncryptedStore::QEncryptedStore(const QString& filePath, const QByteArray& key, const bool backgroundCompaction)
+    : m_filePath(filePath)
+    , m_dataFile(filePath)
+    , m_indexFile(filePath + ".index")
+{
+    try {
+        if (key.size() != 32) {
+            throw std::runtime_error("Store key must have 32 bytes.");
+        }
+
+        /* Separate keys, so key hashes reveal nothing about encryption key */
+        m_encryptionKey = deriveKey(key, "QSimpleCrypto store encryption key");
+        m_hashKey = deriveKey(key, "QSimpleCrypto store key hash");
+
+        /* Index file is never replaced, so its lock covers store for whole lifetime, also across compaction */
+        if (!m_indexFile.open(QIODevice::ReadWrite)) {
+            throw std::runtime_error("Couldn't open store index. QFile::open(). Error: " + m_indexFile.errorString().toStdString());
+        }
+
+        if (!QFileSync::tryLockExclusive(m_indexFile.handle())) {
+            throw std::runtime_error("Store is already open by another object or process.");
+        }
+
+        openData();
+        openIndex();
+
+        if (backgroundCompaction) {
+            m_compactor = std::thread(&QEncryptedStore::compactInBackground, this);
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::~QEncryptedStore - Syncs data, saves index and closes store.
+///
+QSimpleCrypto::QEncryptedStore::~QEncryptedStore()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        m_stopped = true;
+    }
+    m_stopCondition.notify_all();
+
+    if (m_compactor.joinable()) {
+        m_compactor.join();
+    }
+
+    try {
+        if (m_data) {
+            sync();
+
+            m_dataFile.unmap(m_data);
+            m_data = nullptr;
+
+            /* Clean close leaves no preallocated tail, so index covers whole file. Corrupted index is left dirty to be rebuilt */
+            if (m_dataFile.resize(m_end) && m_index && !m_indexCorrupted) {
+                QFileSync::syncData(m_dataFile);
+
+                /* Slots reach storage before clean header, so crash in between leaves index dirty */
+                QFileSync::syncMapping(m_index, storeIndexHeaderSize + m_slots * storeIndexSlotSize);
+                writeIndexHeader(m_end);
+                QFileSync::syncMapping(m_index, storeIndexHeaderSize);
+            }
+        }
+    } catch (...) {
+    }
+
+    if (m_data) {
+        m_dataFile.unmap(m_data);
+    }
+
+    if (m_index) {
+        m_indexFile.unmap(m_index);
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::put - Function stores value for key, replacing previous value.
+/// \param key - Key. Example: session identifier.
+/// \param value - Value that will be encrypted.
+///
+void QSimpleCrypto::QEncryptedStore::put(const QByteArray& key, const QByteArray& value)
+{
+    try {
+        const QByteArray hash = keyHash(key);
+
+        QWriteLocker locker(&m_lock);
+        checkUsable();
+
+        const qint64 offset = appendRecord(hash, value, false);
+        const qint64 previous = setSlot(reinterpret_cast<const unsigned char*>(hash.constData()), offset);
+
+        if (previous) {
+            m_liveBytes -= recordSize(indexedRecord(previous));
+        } else {
+            ++m_count;
+        }
+
+        m_liveBytes += recordSize(m_data + offset);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::get - Function reads and decrypts value of key.
+/// \param key - Key.
+/// \param found - Set to 'true' if key exists. Can be 'nullptr'.
+/// \return Returns value, or "" if key doesn't exist. Throws, if value fails authentication.
+///
+QByteArray QSimpleCrypto::QEncryptedStore::get(const QByteArray& key, bool* found)
+{
+    try {
+        const QByteArray hash = keyHash(key);
+
+        QReadLocker locker(&m_lock);
+        checkUsable();
+
+        const qint64 slot = findSlot(reinterpret_cast<const unsigned char*>(hash.constData()), false);
+        if (found) {
+            *found = slot >= 0;
+        }
+
+        if (slot < 0) {
+            return QByteArray();
+        }
+
+        /* Record is read straight from mapped data file */
+        return decryptRecord(indexedRecord(slotOffset(slot)));
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::contains - Function checks if key exists, without decrypting value.
+/// \param key - Key.
+/// \return Returns 'true' if key exists.
+///
+bool QSimpleCrypto::QEncryptedStore::contains(const QByteArray& key)
+{
+    const QByteArray hash = keyHash(key);
+
+    QReadLocker locker(&m_lock);
+    checkUsable();
+
+    return findSlot(reinterpret_cast<const unsigned char*>(hash.constData()), false) >= 0;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::remove - Function removes key.
+/// \param key - Key.
+/// \return Returns 'true' if key existed.
+///
+bool QSimpleCrypto::QEncryptedStore::remove(const QByteArray& key)
+{
+    try {
+        const QByteArray hash = keyHash(key);
+
+        QWriteLocker locker(&m_lock);
+        checkUsable();
+
+        const qint64 slot = findSlot(reinterpret_cast<const unsigned char*>(hash.constData()), false);
+        if (slot < 0) {
+            return false;
+        }
+
+        /* Removal record keeps key removed, when index is rebuilt from data file */
+        appendRecord(hash, QByteArray(), true);
+
+        m_liveBytes -= recordSize(indexedRecord(slotOffset(slot)));
+        --m_count;
+        removeSlot(slot);
+
+        return true;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::count - Function returns number of keys in store.
+/// \return Returns number of keys.
+///
+qint64 QSimpleCrypto::QEncryptedStore::count()
+{
+    QReadLocker locker(&m_lock);
+    return m_count;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::sync - Function waits until all written values reach storage.
+///
+void QSimpleCrypto::QEncryptedStore::sync()
+{
+    try {
+        QReadLocker locker(&m_lock);
+        checkUsable();
+
+        QFileSync::syncMapping(m_data, m_dataCapacity);
+        QFileSync::syncData(m_dataFile);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::compact - Function rewrites data file with live values only.
+/// \details Readers and writers keep working while live values are copied. They wait only while files are switched.
+///          If switch fails after data file was closed, store throws from every function and must be opened again.
+///
+void QSimpleCrypto::QEncryptedStore::compact()
+{
+    std::lock_guard<std::mutex> compactionLock(m_compactionMutex);
+
+    const QString compactPath = m_filePath + ".compact";
+
+    try {
+        /* Records are never changed after append, so snapshot of live offsets stays valid */
+        QVector<qint64> offsets;
+        qint64 snapshotEnd = 0;
+        {
+            QReadLocker locker(&m_lock);
+            checkUsable();
+
+            offsets.reserve(m_count);
+            for (qint64 slot = 0; slot < m_slots; ++slot) {
+                const qint64 offset = slotOffset(slot);
+                if (offset != storeEmptySlot && offset != storeRemovedSlot) {
+                    (void)indexedRecord(offset);
+                    offsets.append(offset);
+                }
+            }
+
+            snapshotEnd = m_end;
+        }
+
+        std::sort(offsets.begin(), offsets.end());
+
+        /* Own mapping, because writers may remap data file while records are copied */
+        QFile reader(m_filePath);
+        if (!reader.open(QIODevice::ReadOnly)) {
+            throw std::runtime_error("Couldn't open store for compaction. QFile::open(). Error: " + reader.errorString().toStdString());
+        }
+
+        uchar* snapshot = reader.map(0, snapshotEnd);
+        if (!snapshot) {
+            throw std::runtime_error("Couldn't map store for compaction. QFile::map(). Error: " + reader.errorString().toStdString());
+        }
+
+        QFile writer(compactPath);
+        if (!writer.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            reader.unmap(snapshot);
+            throw std::runtime_error("Couldn't create compacted store. QFile::open(). Error: " + writer.errorString().toStdString());
+        }
+
+        /* Records keep nonce and tag, so they are copied without decryption */
+        QHash<qint64, qint64> moved;
+        moved.reserve(offsets.size());
+
+        bool written = writer.write(reinterpret_cast<const char*>(snapshot), storeFileHeaderSize) == storeFileHeaderSize;
+        for (qint32 i = 0; written && i < offsets.size(); ++i) {
+            const qint64 size = recordSize(snapshot + offsets.at(i));
+
+            moved.insert(offsets.at(i), writer.pos());
+            written = writer.write(reinterpret_cast<const char*>(snapshot + offsets.at(i)), size) == size;
+        }
+
+        reader.unmap(snapshot);
+
+        if (!written) {
+            throw std::runtime_error("Couldn't write compacted store. Error: " + writer.errorString().toStdString());
+        }
+
+        QWriteLocker locker(&m_lock);
+
+        /*
+         * Values written during copy are appended after snapshot. Removal records of keys, that are not live anymore,
+         * are appended too, because value of such key may already be copied and index rebuild must not bring it back
+         */
+        qint64 removalBytes = 0;
+        for (qint64 offset = snapshotEnd; written && offset < m_end; offset += recordSize(m_data + offset)) {
+            const bool removal = qFromLittleEndian<quint32>(m_data + offset) == storeRemovalRecord;
+            const qint64 slot = findSlot(m_data + offset + 8, false);
+            if (removal ? slot >= 0 : (slot < 0 || slotOffset(slot) != offset)) {
+                continue;
+            }
+
+            const qint64 size = recordSize(m_data + offset);
+            if (removal) {
+                removalBytes += size;
+            } else {
+                moved.insert(offset, writer.pos());
+            }
+
+            written = writer.write(reinterpret_cast<const char*>(m_data + offset), size) == size;
+        }
+
+        if (!written) {
+            throw std::runtime_error("Couldn't write compacted store. Error: " + writer.errorString().toStdString());
+        }
+
+        const qint64 end = writer.pos();
+        QFileSync::syncData(writer);
+        writer.close();
+
+        /* Data file can't be replaced while it is mapped */
+        QFileSync::syncMapping(m_data, m_dataCapacity);
+
+        /* From here until files are mapped again store has no data mapping, so failure leaves it unusable */
+        m_failed = true;
+        m_dataFile.unmap(m_data);
+        m_data = nullptr;
+        m_dataFile.close();
+
+        /* Index stays dirty while store is open, so crash after replacement rebuilds it */
+        const bool replaced = QFileSync::replaceFile(compactPath, m_filePath);
+
+        openData();
+        if (!replaced) {
+            /* Old data file is mapped again and index still points into it */
+            m_failed = false;
+            throw std::runtime_error("Couldn't replace store with compacted store.");
+        }
+
+        /* Move every key to its offset in compacted file */
+        QVector<QPair<QByteArray, qint64>> entries;
+        entries.reserve(m_count);
+        for (qint64 slot = 0; slot < m_slots; ++slot) {
+            const qint64 offset = slotOffset(slot);
+            if (offset != storeEmptySlot && offset != storeRemovedSlot) {
+                const uchar* hash = m_index + storeIndexHeaderSize + slot * storeIndexSlotSize;
+                entries.append(qMakePair(QByteArray(reinterpret_cast<const char*>(hash), storeKeyHashLength), moved.value(offset)));
+            }
+        }
+
+        mapIndex(m_slots);
+        for (const auto& entry : entries) {
+            setSlot(reinterpret_cast<const unsigned char*>(entry.first.constData()), entry.second);
+        }
+
+        m_end = end;
+        m_liveBytes = end - storeFileHeaderSize - removalBytes;
+        writeIndexHeader(0);
+        m_failed = false;
+
+        /* Rename is durable only when directory reaches storage. Store is consistent either way, so it is synced last */
+        QFileSync::syncDirectory(m_filePath);
+    } catch (const std::exception& exception) {
+        QFile::remove(compactPath);
+        std::throw_with_nested(exception);
+    } catch (...) {
+        QFile::remove(compactPath);
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::keyHash - Function computes keyed hash of key, that is stored instead of key.
+/// \param key - Key.
+/// \return Returns 16 bytes hash.
+///
+QByteArray QSimpleCrypto::QEncryptedStore::keyHash(const QByteArray& key) const
+{
+    QByteArray hash(EVP_MAX_MD_SIZE, 0);
+    quint32 hashLength = 0;
+
+    if (!HMAC(EVP_sha256(), m_hashKey.constData(), m_hashKey.size(), reinterpret_cast<const unsigned char*>(key.constData()), key.size(),
+            reinterpret_cast<unsigned char*>(hash.data()), &hashLength)) {
+        throw std::runtime_error("Couldn't compute key hash. HMAC(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    hash.resize(storeKeyHashLength);
+    return hash;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::keyCheck - Function computes tag, that tells if store is opened with right key.
+/// \return Returns 16 bytes tag.
+/// \details Tag is AES GCM tag of empty message with zero nonce and file magic as authenticated data.
+///
+QByteArray QSimpleCrypto::QEncryptedStore::keyCheck() const
+{
+    QByteArray tag(storeTagLength, 0);
+    (void)QAead().encryptAesGcm(QByteArray(), m_encryptionKey, QByteArray(storeNonceLength, 0), tag, QByteArray(storeMagic, 8));
+
+    return tag;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::openData - Function opens data file, creates header and maps file.
+///
+void QSimpleCrypto::QEncryptedStore::openData()
+{
+    if (!m_dataFile.open(QIODevice::ReadWrite)) {
+        throw std::runtime_error("Couldn't open store. QFile::open(). Error: " + m_dataFile.errorString().toStdString());
+    }
+
+    /* New or torn file gets fresh header */
+    if (m_dataFile.size() < storeFileHeaderSize) {
+        QByteArray header(storeFileHeaderSize, 0);
+        std::memcpy(header.data(), storeMagic, 8);
+        std::memcpy(header.data() + 16, keyCheck().constData(), storeTagLength);
+
+        if (!m_dataFile.resize(0) || m_dataFile.write(header) != header.size()) {
+            throw std::runtime_error("Couldn't write store header. Error: " + m_dataFile.errorString().toStdString());
+        }
+
+        QFileSync::syncData(m_dataFile);
+    }
+
+    m_dataCapacity = 0;
+    mapData(m_dataFile.size());
+
+    if (std::memcmp(m_data, storeMagic, 8) != 0) {
+        throw std::runtime_error("File is not encrypted store.");
+    }
+
+    /* Wrong key would make index rebuild drop every record */
+    if (CRYPTO_memcmp(m_data + 16, keyCheck().constData(), storeTagLength) != 0) {
+        throw std::runtime_error("Store is encrypted with another key.");
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::openIndex - Function maps index and checks if it matches data file. Rebuilds index otherwise.
+///
+void QSimpleCrypto::QEncryptedStore::openIndex()
+{
+    /* Index is trusted only if it was saved by clean close of this data file */
+    bool valid = false;
+    if (m_indexFile.size() >= storeIndexHeaderSize) {
+        m_index = m_indexFile.map(0, m_indexFile.size());
+        if (!m_index) {
+            throw std::runtime_error("Couldn't map store index. QFile::map(). Error: " + m_indexFile.errorString().toStdString());
+        }
+
+        const qint64 slots = qFromLittleEndian<qint64>(m_index + 8);
+        const qint64 coveredSize = qFromLittleEndian<qint64>(m_index + 16);
+
+        valid = std::memcmp(m_index, storeIndexMagic, 8) == 0 && slots >= storeInitialSlots && (slots & (slots - 1)) == 0
+            && m_indexFile.size() == storeIndexHeaderSize + slots * storeIndexSlotSize && coveredSize >= storeFileHeaderSize
+            && coveredSize == m_dataFile.size();
+
+        if (valid) {
+            m_slots = slots;
+            m_end = coveredSize;
+            m_count = qFromLittleEndian<qint64>(m_index + 24);
+            m_liveBytes = qFromLittleEndian<qint64>(m_index + 32);
+
+            /* Removed slots also lengthen probing, so they count towards growth */
+            for (qint64 slot = 0; slot < m_slots; ++slot) {
+                if (slotOffset(slot) != storeEmptySlot) {
+                    ++m_usedSlots;
+                }
+            }
+        }
+    }
+
+    if (!valid) {
+        rebuildIndex();
+    }
+
+    /* Mark index dirty until clean close, then preallocate room for appends */
+    writeIndexHeader(0);
+    QFileSync::syncMapping(m_index, storeIndexHeaderSize);
+
+    mapData(m_end + storeGrowSize);
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::rebuildIndex - Function scans data file and builds index from records.
+///
+void QSimpleCrypto::QEncryptedStore::rebuildIndex()
+{
+    mapIndex(storeInitialSlots);
+    m_count = 0;
+    m_liveBytes = 0;
+
+    /* Scan stops at first torn or forged record. Everything before it was appended before it */
+    qint64 offset = storeFileHeaderSize;
+    while (offset + storeRecordHeaderSize <= m_dataCapacity) {
+        const uchar* record = m_data + offset;
+        const quint32 flags = qFromLittleEndian<quint32>(record);
+
+        if ((flags != storeValueRecord && flags != storeRemovalRecord) || offset + recordSize(record) > m_dataCapacity
+            || (flags == storeRemovalRecord && recordSize(record) != storeRecordHeaderSize)) {
+            break;
+        }
+
+        try {
+            (void)decryptRecord(record);
+        } catch (...) {
+            break;
+        }
+
+        if (flags == storeValueRecord) {
+            const qint64 previous = setSlot(record + 8, offset);
+            if (previous) {
+                m_liveBytes -= recordSize(m_data + previous);
+            } else {
+                ++m_count;
+            }
+
+            m_liveBytes += recordSize(record);
+        } else {
+            const qint64 slot = findSlot(record + 8, false);
+            if (slot >= 0) {
+                m_liveBytes -= recordSize(m_data + slotOffset(slot));
+                --m_count;
+                removeSlot(slot);
+            }
+        }
+
+        offset += recordSize(record);
+    }
+
+    /* Drop torn tail, so stale bytes after it can't be read as records later */
+    m_end = offset;
+    m_dataFile.unmap(m_data);
+    m_data = nullptr;
+    m_dataCapacity = 0;
+
+    if (!m_dataFile.resize(m_end)) {
+        throw std::runtime_error("Couldn't truncate store. Error: " + m_dataFile.errorString().toStdString());
+    }
+
+    mapData(m_end);
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::mapData - Function resizes data file and maps it.
+/// \param capacity - New data file size.
+///
+void QSimpleCrypto::QEncryptedStore::mapData(const qint64 capacity)
+{
+    if (m_data) {
+        m_dataFile.unmap(m_data);
+        m_data = nullptr;
+    }
+
+    if (m_dataFile.size() < capacity && !m_dataFile.resize(capacity)) {
+        throw std::runtime_error("Couldn't resize store. Error: " + m_dataFile.errorString().toStdString());
+    }
+
+    m_data = m_dataFile.map(0, capacity);
+    if (!m_data) {
+        throw std::runtime_error("Couldn't map store. QFile::map(). Error: " + m_dataFile.errorString().toStdString());
+    }
+
+    m_dataCapacity = capacity;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::mapIndex - Function resizes index file to number of slots, maps it and clears slots.
+/// \param slots - Number of slots. Must be power of two.
+///
+void QSimpleCrypto::QEncryptedStore::mapIndex(const qint64 slots)
+{
+    if (m_index) {
+        m_indexFile.unmap(m_index);
+        m_index = nullptr;
+    }
+
+    const qint64 size = storeIndexHeaderSize + slots * storeIndexSlotSize;
+    if (!m_indexFile.resize(size)) {
+        throw std::runtime_error("Couldn't resize store index. Error: " + m_indexFile.errorString().toStdString());
+    }
+
+    m_index = m_indexFile.map(0, size);
+    if (!m_index) {
+        throw std::runtime_error("Couldn't map store index. QFile::map(). Error: " + m_indexFile.errorString().toStdString());
+    }
+
+    std::memset(m_index, 0, size);
+    std::memcpy(m_index, storeIndexMagic, 8);
+
+    m_slots = slots;
+    m_usedSlots = 0;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::writeIndexHeader - Function writes index header.
+/// \param coveredSize - Data size covered by index. '0' marks index as dirty.
+///
+void QSimpleCrypto::QEncryptedStore::writeIndexHeader(const qint64 coveredSize)
+{
+    std::memcpy(m_index, storeIndexMagic, 8);
+    qToLittleEndian<qint64>(m_slots, m_index + 8);
+    qToLittleEndian<qint64>(coveredSize, m_index + 16);
+    qToLittleEndian<qint64>(m_count, m_index + 24);
+    qToLittleEndian<qint64>(m_liveBytes, m_index + 32);
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::findSlot - Function finds index slot of key hash.
+/// \param hash - Key hash.
+/// \param insert - If 'true', returns first free slot when key hash is not found.
+/// \return Returns slot number, or -1 if key hash is not found and 'insert' is 'false'.
+///
+qint64 QSimpleCrypto::QEncryptedStore::findSlot(const unsigned char* hash, const bool insert) const
+{
+    /* Key hash is uniformly distributed, so its first bytes are good slot number */
+    const qint64 mask = m_slots - 1;
+    qint64 freeSlot = -1;
+
+    for (qint64 slot = qFromLittleEndian<quint64>(hash) & mask, probes = 0; probes < m_slots; slot = (slot + 1) & mask, ++probes) {
+        const uchar* entry = m_index + storeIndexHeaderSize + slot * storeIndexSlotSize;
+        const qint64 offset = qFromLittleEndian<qint64>(entry + storeKeyHashLength);
+
+        if (offset == storeEmptySlot) {
+            return insert ? (freeSlot >= 0 ? freeSlot : slot) : -1;
+        }
+
+        if (offset == storeRemovedSlot) {
+            if (freeSlot < 0) {
+                freeSlot = slot;
+            }
+        } else if (std::memcmp(entry, hash, storeKeyHashLength) == 0) {
+            return slot;
+        }
+    }
+
+    return insert ? freeSlot : -1;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::setSlot - Function stores record offset for key hash, growing index when needed.
+/// \param hash - Key hash.
+/// \param offset - Record offset.
+/// \return Returns previous record offset, or 0 if key hash was not in index.
+///
+qint64 QSimpleCrypto::QEncryptedStore::setSlot(const unsigned char* hash, const qint64 offset)
+{
+    /* Keep at most half of slots used, so probe sequences stay short */
+    if ((m_usedSlots + 1) * 2 > m_slots) {
+        QVector<QPair<QByteArray, qint64>> entries;
+        entries.reserve(m_count);
+
+        for (qint64 slot = 0; slot < m_slots; ++slot) {
+            const qint64 slotValue = slotOffset(slot);
+            if (slotValue != storeEmptySlot && slotValue != storeRemovedSlot) {
+                const uchar* entry = m_index + storeIndexHeaderSize + slot * storeIndexSlotSize;
+                entries.append(qMakePair(QByteArray(reinterpret_cast<const char*>(entry), storeKeyHashLength), slotValue));
+            }
+        }
+
+        /* Plenty of removed slots are dropped by rehash alone */
+        qint64 slots = m_slots;
+        while ((entries.size() + 1) * 4 > slots) {
+            slots *= 2;
+        }
+
+        const QByteArray copy(reinterpret_cast<const char*>(hash), storeKeyHashLength);
+
+        mapIndex(slots);
+        for (const auto& entry : entries) {
+            setSlot(reinterpret_cast<const unsigned char*>(entry.first.constData()), entry.second);
+        }
+
+        return setSlot(reinterpret_cast<const unsigned char*>(copy.constData()), offset);
+    }
+
+    const qint64 slot = findSlot(hash, true);
+    uchar* entry = m_index + storeIndexHeaderSize + slot * storeIndexSlotSize;
+    const qint64 previous = slotOffset(slot);
+
+    if (previous == storeEmptySlot) {
+        ++m_usedSlots;
+    }
+
+    std::memmove(entry, hash, storeKeyHashLength);
+    qToLittleEndian<qint64>(offset, entry + storeKeyHashLength);
+
+    return previous == storeEmptySlot || previous == storeRemovedSlot ? 0 : previous;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::removeSlot - Function removes key hash from index.
+/// \param slot - Slot number.
+///
+void QSimpleCrypto::QEncryptedStore::removeSlot(const qint64 slot)
+{
+    qToLittleEndian<qint64>(storeRemovedSlot, m_index + storeIndexHeaderSize + slot * storeIndexSlotSize + storeKeyHashLength);
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::slotOffset - Function returns record offset stored in slot.
+/// \param slot - Slot number.
+/// \return Returns record offset, storeEmptySlot or storeRemovedSlot.
+///
+qint64 QSimpleCrypto::QEncryptedStore::slotOffset(const qint64 slot) const
+{
+    return qFromLittleEndian<qint64>(m_index + storeIndexHeaderSize + slot * storeIndexSlotSize + storeKeyHashLength);
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::appendRecord - Function encrypts value and appends record to data file.
+/// \param hash - Key hash.
+/// \param value - Value. Ignored for removal record.
+/// \param removal - If 'true', record marks key as removed.
+/// \return Returns record offset.
+///
+qint64 QSimpleCrypto::QEncryptedStore::appendRecord(const QByteArray& hash, const QByteArray& value, const bool removal)
+{
+    const QByteArray data = removal ? QByteArray() : value;
+    if (data.size() > std::numeric_limits<qint32>::max() - storeRecordHeaderSize) {
+        throw std::runtime_error("Store value is too large.");
+    }
+
+    const qint64 size = storeRecordHeaderSize + data.size();
+    if (m_end + size > m_dataCapacity) {
+        mapData(qMax(m_dataCapacity + storeGrowSize, m_end + size));
+    }
+
+    /* Flags, length and key hash are authenticated, so value can't be moved to another key */
+    QByteArray header(storeRecordHeaderSize, 0);
+    qToLittleEndian<quint32>(removal ? storeRemovalRecord : storeValueRecord, header.data());
+    qToLittleEndian<quint32>(static_cast<quint32>(data.size()), header.data() + 4);
+    std::memcpy(header.data() + 8, hash.constData(), storeKeyHashLength);
+
+    /* Random nonce lets compaction copy records without encrypting them again */
+    const QByteArray nonce = QRandomPool::generate(storeNonceLength);
+    std::memcpy(header.data() + 24, nonce.constData(), storeNonceLength);
+
+    QByteArray tag(storeTagLength, 0);
+    const QByteArray cipherText = QAead().encryptAesGcm(data, m_encryptionKey, nonce, tag, header.left(storeAadLength));
+    std::memcpy(header.data() + 36, tag.constData(), storeTagLength);
+
+    /* Record is published to readers only by index update after this copy */
+    const qint64 offset = m_end;
+    std::memcpy(m_data + offset, header.constData(), storeRecordHeaderSize);
+    std::memcpy(m_data + offset + storeRecordHeaderSize, cipherText.constData(), cipherText.size());
+    m_end += size;
+
+    return offset;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::decryptRecord - Function authenticates and decrypts record.
+/// \param record - Pointer to record header.
+/// \return Returns value.
+///
+QByteArray QSimpleCrypto::QEncryptedStore::decryptRecord(const unsigned char* record) const
+{
+    const char* header = reinterpret_cast<const char*>(record);
+    const qint32 length = static_cast<qint32>(qFromLittleEndian<quint32>(record + 4));
+
+    return QAead().decryptAesGcm(QByteArray::fromRawData(header + storeRecordHeaderSize, length), m_encryptionKey,
+        QByteArray::fromRawData(header + 24, storeNonceLength), QByteArray::fromRawData(header + 36, storeTagLength),
+        QByteArray::fromRawData(header, storeAadLength));
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::indexedRecord - Function returns record, that index points to, after checking it lies inside data file.
+/// \param offset - Record offset read from index.
+/// \return Returns pointer to record header.
+///
+const unsigned char* QSimpleCrypto::QEncryptedStore::indexedRecord(const qint64 offset) const
+{
+    if (offset < storeFileHeaderSize || offset > m_end - storeRecordHeaderSize || offset + recordSize(m_data + offset) > m_end) {
+        m_indexCorrupted = true;
+        throw std::runtime_error("Store index is corrupted. Record offset is outside of data file.");
+    }
+
+    return m_data + offset;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::recordSize - Function returns size of record including header.
+/// \param record - Pointer to record header.
+/// \return Returns record size.
+///
+qint64 QSimpleCrypto::QEncryptedStore::recordSize(const unsigned char* record)
+{
+    return storeRecordHeaderSize + static_cast<qint64>(qFromLittleEndian<quint32>(record + 4));
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::checkUsable - Function throws, if compaction failed while files were switched. Lock must be held.
+///
+void QSimpleCrypto::QEncryptedStore::checkUsable() const
+{
+    if (m_failed) {
+        throw std::runtime_error("Store is unusable after failed compaction and must be opened again.");
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::needsCompaction - Function checks if more than half of large data file is dead records.
+/// \return Returns 'true' if compaction is worth running.
+///
+bool QSimpleCrypto::QEncryptedStore::needsCompaction()
+{
+    QReadLocker locker(&m_lock);
+
+    const qint64 size = m_end - storeFileHeaderSize;
+    return !m_failed && size > storeCompactionMinSize && m_liveBytes * 2 < size;
+}
+
+///
+/// \brief QSimpleCrypto::QEncryptedStore::compactInBackground - Background compaction thread function.
+///
+void QSimpleCrypto::QEncryptedStore::compactInBackground()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_stopMutex);
+            if (m_stopCondition.wait_for(lock, std::chrono::milliseconds(storeCompactionInterval), [this] { return m_stopped; })) {
+                return;
+            }
+        }
+
+        /* Failed compaction leaves store untouched, so it is retried on next check */
+        try {
+            if (needsCompaction()) {
+                compact();
+            }
+        } catch (...) {
+        }
+    }
+}
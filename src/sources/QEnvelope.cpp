@@ -0,0 +1,358 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QEnvelope.h"
+
+#include <cstring>
+
+namespace {
+///
+/// \brief envelopeMagic - First bytes of every envelope. Last two characters are format version.
+///
+const char envelopeMagic[] = "QSCENV01";
+
+///
+/// \brief envelopeMagicLength - Size of envelope magic without terminating zero.
+///
+constexpr qint64 envelopeMagicLength = sizeof(envelopeMagic) - 1;
+
+///
+/// \brief envelopeMaxWrappedKeyLength - Largest accepted wrapped key. That is RSA modulus of 16384 bits.
+///
+constexpr quint32 envelopeMaxWrappedKeyLength = 2048;
+
+///
+/// \brief The BoundedDevice class - Read only view of device, that ends given number of bytes after current position.
+/// \details Lets pipeline read cipher text up to tag, as pipeline reads source until 'read()' returns 0.
+///
+class BoundedDevice : public QIODevice {
+public:
+    BoundedDevice(QIODevice* device, const qint64 size)
+        : m_device(device)
+        , m_remaining(size)
+    {
+    }
+
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+        const qint64 size = m_device->read(data, qMin(maxSize, m_remaining));
+        if (size > 0) {
+            m_remaining -= size;
+        }
+
+        return size;
+    }
+
+    qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+    QIODevice* m_device;
+    qint64 m_remaining;
+};
+
+///
+/// \brief readExactly - Function reads given number of bytes from device.
+/// \param device - Device.
+/// \param size - Number of bytes.
+/// \return Returns bytes. Throws, if device ends earlier.
+///
+QByteArray readExactly(QIODevice* device, const qint64 size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    qint64 done = 0;
+    while (done < size) {
+        const qint64 read = device->read(data.data() + done, size - done);
+        if (read <= 0) {
+            throw std::runtime_error("Envelope is truncated.");
+        }
+
+        done += read;
+    }
+
+    return data;
+}
+} // namespace
+
+QSimpleCrypto::QEnvelope::QEnvelope()
+{
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::seal - Function encrypts data for holder of RSA private key.
+/// \param data - Data that will be encrypted.
+/// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param aad - Additional authenticated data. Must be used in opening.
+/// \param md - Hash algorithm of OAEP padding (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \return Returns envelope.
+///
+QByteArray QSimpleCrypto::QEnvelope::seal(const QByteArray& data, EVP_PKEY* key, const QByteArray& aad, const EVP_MD* md)
+{
+    QByteArray contentKey;
+    try {
+        QByteArray nonce;
+        const QByteArray header = createHeader(key, md, contentKey, nonce);
+
+        QByteArray tag(envelopeTagLength, 0);
+        const QByteArray cipherText = QAead().encryptAesGcm(data, contentKey, nonce, tag, header + aad);
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+
+        return header + cipherText + tag;
+    } catch (const std::exception& exception) {
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::open - Function decrypts envelope made by seal() or sealStream().
+/// \param envelope - Envelope.
+/// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param aad - Additional authenticated data, that was used in sealing.
+/// \return Returns decrypted data. Throws, if envelope is malformed, key doesn't match or authentication fails.
+///
+QByteArray QSimpleCrypto::QEnvelope::open(const QByteArray& envelope, EVP_PKEY* key, const QByteArray& aad)
+{
+    QByteArray contentKey;
+    try {
+        if (envelope.size() < fixedHeaderSize()) {
+            throw std::runtime_error("Envelope is truncated.");
+        }
+
+        const qint64 size = headerSize(envelope.left(fixedHeaderSize()));
+        if (envelope.size() < size + envelopeTagLength) {
+            throw std::runtime_error("Envelope is truncated.");
+        }
+
+        QByteArray nonce;
+        (void)parseHeader(envelope, key, contentKey, nonce);
+
+        const QByteArray cipherText = envelope.mid(size, envelope.size() - size - envelopeTagLength);
+        const QByteArray tag = envelope.right(envelopeTagLength);
+        const QByteArray plainText = QAead().decryptAesGcm(cipherText, contentKey, nonce, tag, envelope.left(size) + aad);
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+
+        return plainText;
+    } catch (const std::exception& exception) {
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::sealStream - Function encrypts stream for holder of RSA private key.
+/// \param source - Device with data that will be encrypted.
+/// \param sink - Device where envelope will be written.
+/// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param aad - Additional authenticated data. Must be used in opening.
+/// \param md - Hash algorithm of OAEP padding (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \param bufferSize - Size of pipeline buffer. Example: pipelineBufferSize.
+/// \return Returns 'true' on success.
+///
+bool QSimpleCrypto::QEnvelope::sealStream(QIODevice* source, QIODevice* sink, EVP_PKEY* key, const QByteArray& aad, const EVP_MD* md, const qint32 bufferSize)
+{
+    QByteArray contentKey;
+    try {
+        if (!source || !sink) {
+            throw std::runtime_error("Envelope devices must be provided.");
+        }
+
+        QByteArray nonce;
+        const QByteArray header = createHeader(key, md, contentKey, nonce);
+        if (sink->write(header) != header.size()) {
+            throw std::runtime_error("Couldn't write envelope header. QIODevice::write(). Error: " + sink->errorString().toStdString());
+        }
+
+        QByteArray tag;
+        QCryptoPipeline(bufferSize).encryptAesGcm(source, sink, contentKey, nonce, tag, header + aad);
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+
+        if (sink->write(tag) != tag.size()) {
+            throw std::runtime_error("Couldn't write envelope tag. QIODevice::write(). Error: " + sink->errorString().toStdString());
+        }
+
+        return true;
+    } catch (const std::exception& exception) {
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::openStream - Function decrypts envelope stream made by seal() or sealStream().
+/// \param source - Random access device (QFile, QBuffer) with envelope. Envelope runs from current position to end of device.
+/// \param sink - Device where decrypted data will be written.
+/// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param aad - Additional authenticated data, that was used in sealing.
+/// \param bufferSize - Size of pipeline buffer. Example: pipelineBufferSize.
+/// \return Returns 'true' on success. Throws, if envelope is malformed, key doesn't match or authentication fails.
+///
+bool QSimpleCrypto::QEnvelope::openStream(QIODevice* source, QIODevice* sink, EVP_PKEY* key, const QByteArray& aad, const qint32 bufferSize)
+{
+    QByteArray contentKey;
+    try {
+        if (!source || !sink) {
+            throw std::runtime_error("Envelope devices must be provided.");
+        }
+
+        if (source->isSequential()) {
+            throw std::runtime_error("Envelope source must be random access device.");
+        }
+
+        QByteArray header = readExactly(source, fixedHeaderSize());
+        const qint64 size = headerSize(header);
+        header += readExactly(source, size - fixedHeaderSize());
+
+        QByteArray nonce;
+        (void)parseHeader(header, key, contentKey, nonce);
+
+        /* Tag is needed before first block is decrypted, so it is read from end of device */
+        const qint64 bodyPosition = source->pos();
+        const qint64 bodySize = source->size() - bodyPosition - envelopeTagLength;
+        if (bodySize < 0) {
+            throw std::runtime_error("Envelope is truncated.");
+        }
+
+        if (!source->seek(bodyPosition + bodySize)) {
+            throw std::runtime_error("Couldn't seek to envelope tag. QIODevice::seek(). Error: " + source->errorString().toStdString());
+        }
+
+        const QByteArray tag = readExactly(source, envelopeTagLength);
+        if (!source->seek(bodyPosition)) {
+            throw std::runtime_error("Couldn't seek to envelope body. QIODevice::seek(). Error: " + source->errorString().toStdString());
+        }
+
+        BoundedDevice body(source, bodySize);
+        if (!body.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            throw std::runtime_error("Couldn't open envelope body.");
+        }
+
+        QCryptoPipeline(bufferSize).decryptAesGcm(&body, sink, contentKey, nonce, tag, header + aad);
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+
+        /* Leave source after envelope, as sequential read would */
+        (void)source->seek(bodyPosition + bodySize + envelopeTagLength);
+
+        return true;
+    } catch (const std::exception& exception) {
+        OPENSSL_cleanse(contentKey.data(), contentKey.size());
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::createHeader - Function generates content key and nonce, and builds envelope header with wrapped content key.
+/// \param key - RSA public key.
+/// \param md - Hash algorithm of OAEP padding.
+/// \param contentKey - Generated content key. Will be written by function.
+/// \param nonce - Generated nonce. Will be written by function.
+/// \return Returns envelope header.
+///
+QByteArray QSimpleCrypto::QEnvelope::createHeader(EVP_PKEY* key, const EVP_MD* md, QByteArray& contentKey, QByteArray& nonce)
+{
+    contentKey = QRandomPool::generate(envelopeKeyLength);
+    nonce = QRandomPool::generate(envelopeNonceLength);
+
+    /* The only RSA operation of message */
+    std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> context { QRsaKey::createContext(key, QRsaKey::Operation::Encrypt, RSA_PKCS1_OAEP_PADDING, md), EVP_PKEY_CTX_free };
+
+    std::size_t wrappedKeyLength = 0;
+    if (EVP_PKEY_encrypt(context.get(), nullptr, &wrappedKeyLength, reinterpret_cast<const unsigned char*>(contentKey.constData()), contentKey.size()) <= 0) {
+        throw std::runtime_error("Couldn't determine wrapped key length. EVP_PKEY_encrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    QByteArray header(fixedHeaderSize() + static_cast<qint64>(wrappedKeyLength), 0);
+    uchar* data = reinterpret_cast<uchar*>(header.data());
+
+    if (EVP_PKEY_encrypt(context.get(), data + fixedHeaderSize(), &wrappedKeyLength, reinterpret_cast<const unsigned char*>(contentKey.constData()), contentKey.size()) <= 0) {
+        throw std::runtime_error("Couldn't wrap content key. EVP_PKEY_encrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    header.resize(fixedHeaderSize() + static_cast<qint64>(wrappedKeyLength));
+    memcpy(data, envelopeMagic, envelopeMagicLength);
+    qToLittleEndian<quint32>(static_cast<quint32>(EVP_MD_get_type(md)), data + envelopeMagicLength);
+    qToLittleEndian<quint32>(static_cast<quint32>(wrappedKeyLength), data + envelopeMagicLength + 4);
+    memcpy(data + envelopeMagicLength + 8, nonce.constData(), envelopeNonceLength);
+
+    return header;
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::parseHeader - Function reads envelope header and unwraps content key.
+/// \param header - Bytes starting with envelope header. Must contain at least 'headerSize' bytes.
+/// \param key - RSA private key.
+/// \param contentKey - Unwrapped content key. Will be written by function.
+/// \param nonce - Nonce. Will be written by function.
+/// \return Returns header size.
+///
+qint64 QSimpleCrypto::QEnvelope::parseHeader(const QByteArray& header, EVP_PKEY* key, QByteArray& contentKey, QByteArray& nonce)
+{
+    const qint64 size = headerSize(header.left(fixedHeaderSize()));
+    const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+
+    const EVP_MD* md = EVP_get_digestbynid(static_cast<qint32>(qFromLittleEndian<quint32>(data + envelopeMagicLength)));
+    if (!md) {
+        throw std::runtime_error("Envelope uses unknown OAEP hash.");
+    }
+
+    nonce = header.mid(envelopeMagicLength + 8, envelopeNonceLength);
+
+    std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> context { QRsaKey::createContext(key, QRsaKey::Operation::Decrypt, RSA_PKCS1_OAEP_PADDING, md), EVP_PKEY_CTX_free };
+
+    /* RSA output buffer has modulus size, content key is copied out of it and buffer is cleaned */
+    std::size_t contentKeyLength = static_cast<std::size_t>(EVP_PKEY_get_size(key));
+    QByteArray buffer(static_cast<qint64>(contentKeyLength), 0);
+    if (EVP_PKEY_decrypt(context.get(), reinterpret_cast<unsigned char*>(buffer.data()), &contentKeyLength, data + fixedHeaderSize(), size - fixedHeaderSize()) <= 0
+        || contentKeyLength != envelopeKeyLength) {
+        OPENSSL_cleanse(buffer.data(), buffer.size());
+        throw std::runtime_error("Couldn't unwrap content key. EVP_PKEY_decrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    contentKey = buffer.left(envelopeKeyLength);
+    OPENSSL_cleanse(buffer.data(), buffer.size());
+
+    return size;
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::headerSize - Function returns size of header, that starts with given fixed part.
+/// \param fixedPart - First fixedHeaderSize() bytes of envelope.
+/// \return Returns header size. Throws, if magic doesn't match.
+///
+qint64 QSimpleCrypto::QEnvelope::headerSize(const QByteArray& fixedPart)
+{
+    if (fixedPart.size() < fixedHeaderSize() || memcmp(fixedPart.constData(), envelopeMagic, envelopeMagicLength) != 0) {
+        throw std::runtime_error("Data is not an envelope.");
+    }
+
+    const quint32 wrappedKeyLength = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(fixedPart.constData()) + envelopeMagicLength + 4);
+    if (wrappedKeyLength == 0 || wrappedKeyLength > envelopeMaxWrappedKeyLength) {
+        throw std::runtime_error("Envelope has invalid wrapped key size.");
+    }
+
+    return fixedHeaderSize() + wrappedKeyLength;
+}
+
+///
+/// \brief QSimpleCrypto::QEnvelope::fixedHeaderSize - Function returns size of header part, that doesn't depend on RSA key size.
+/// \return Returns size in bytes.
+///
+qint64 QSimpleCrypto::QEnvelope::fixedHeaderSize()
+{
+    return envelopeMagicLength + 4 + 4 + envelopeNonceLength;
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QKeyCache.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+///
+/// \brief QSimpleCrypto::QKeyCache::QKeyCache - Creates empty cache.
+/// \param capacity - Number of parsed keys, that cache keeps.
+///
+QSimpleCrypto::QKeyCache::QKeyCache(const qint32 capacity)
+    : m_capacity(qMax(1, capacity))
+{
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::~QKeyCache - Releases cache references. Keys handed out stay valid.
+///
+QSimpleCrypto::QKeyCache::~QKeyCache()
+{
+    clear();
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::global - Function returns process wide cache.
+/// \return Returns cache with default capacity.
+///
+QSimpleCrypto::QKeyCache& QSimpleCrypto::QKeyCache::global()
+{
+    static QKeyCache cache;
+    return cache;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::initializeSecureHeap - Function initializes OpenSSL secure heap for decrypted private keys.
+/// \param size - Size of secure heap. Must be power of two.
+/// \param minimum - Minimum secure heap allocation. Must be power of two.
+/// \details Must be called once at startup, before other threads use OpenSSL. Secure heap can't be initialized later safely.
+/// \return Returns 'true' if secure heap is in use. 'false' means platform doesn't support it and keys are kept in regular heap.
+///
+bool QSimpleCrypto::QKeyCache::initializeSecureHeap(const qint64 size, const qint64 minimum)
+{
+    if (CRYPTO_secure_malloc_initialized()) {
+        return true;
+    }
+
+    /* '2' means heap is initialized, but could not be locked in memory. It is still cleared on free */
+    return CRYPTO_secure_malloc_init(static_cast<std::size_t>(size), static_cast<std::size_t>(minimum)) != 0;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::getPublicKey - Function returns parsed public key for PEM or DER SubjectPublicKeyInfo.
+/// \param encoded - Encoded public key.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QKeyCache::getPublicKey(const QByteArray& encoded)
+{
+    try {
+        return lookup('P', encoded, QByteArray());
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::getPrivateKey - Function returns parsed private key for PEM or DER encoding.
+/// \param encoded - Encoded private key.
+/// \param password - Private key password. Part of lookup, so wrong password never returns key parsed with right one.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QKeyCache::getPrivateKey(const QByteArray& encoded, const QByteArray& password)
+{
+    try {
+        return lookup('S', encoded, password);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::getPrivateKeyFromFile - Function returns decrypted private key of PEM or DER file.
+/// \param filePath - File path to private key file.
+/// \param password - Private key password. Part of lookup, so wrong password never returns key decrypted with right one.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QKeyCache::getPrivateKeyFromFile(const QByteArray& filePath, const QByteArray& password)
+{
+    try {
+        const QByteArray version = fileVersion(filePath);
+        const QByteArray id = cacheId('F', filePath + '\0' + version, password);
+        if (EVP_PKEY* key = find(id)) {
+            return key;
+        }
+
+        QRsa loader;
+        std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY*)> key { loader.getPrivateKeyFromFile(filePath, password), EVP_PKEY_free };
+
+        /* File was replaced while it was read, so key may belong to either version. It is returned, but not cached */
+        if (fileVersion(filePath) != version) {
+            return key.release();
+        }
+
+        return insert(id, key.release(), filePath);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::removeFile - Function drops decrypted key of file, for example after key was revoked.
+/// \param filePath - File path to private key file.
+///
+void QSimpleCrypto::QKeyCache::removeFile(const QByteArray& filePath)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto file = m_files.find(filePath);
+    if (file != m_files.end()) {
+        erase(m_entries.find(file.value()));
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::remove - Function drops parsed key of encoding, for example after key was revoked.
+/// \param encoded - Encoded key.
+/// \param password - Password, that key was loaded with. Empty for public keys and unencrypted private keys.
+///
+void QSimpleCrypto::QKeyCache::remove(const QByteArray& encoded, const QByteArray& password)
+{
+    const QByteArray ids[] = { cacheId('P', encoded, QByteArray()), cacheId('S', encoded, password) };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const QByteArray& id : ids) {
+        const auto found = m_entries.find(id);
+        if (found != m_entries.end()) {
+            erase(found);
+        }
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::clear - Function drops all parsed keys.
+///
+void QSimpleCrypto::QKeyCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const Entry& entry : m_entries) {
+        EVP_PKEY_free(entry.key);
+    }
+
+    m_entries.clear();
+    m_order.clear();
+    m_files.clear();
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::statistics - Function returns number of entries, hits, misses and secure heap state.
+/// \return Returns statistics snapshot.
+///
+QSimpleCrypto::QKeyCache::Statistics QSimpleCrypto::QKeyCache::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Statistics statistics;
+    statistics.entries = m_entries.size();
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.secureHeap = CRYPTO_secure_malloc_initialized();
+
+    /* CRYPTO_secure_used() can't be called before secure heap is initialized */
+    if (statistics.secureHeap) {
+        statistics.secureHeapUsed = static_cast<qint64>(CRYPTO_secure_used());
+    }
+
+    return statistics;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::lookup - Function returns cached key with incremented reference count, or parses and caches it.
+/// \param type - 'P' for public key and 'S' for private key.
+/// \param encoded - Encoded key.
+/// \param password - Private key password.
+/// \return Returns key owned by caller.
+///
+EVP_PKEY* QSimpleCrypto::QKeyCache::lookup(const char type, const QByteArray& encoded, const QByteArray& password)
+{
+    /* Hash is computed outside lock, so lookups of different keys run in parallel */
+    const QByteArray id = cacheId(type, encoded, password);
+    if (EVP_PKEY* key = find(id)) {
+        return key;
+    }
+
+    /* Parsing runs without lock. If two threads parse the same key, the second result is dropped */
+    QRsa loader;
+    return insert(id, type == 'P' ? loader.getPublicKeyFromBuffer(encoded) : loader.getPrivateKeyFromBuffer(encoded, password));
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::find - Function returns cached key with incremented reference count and counts hit or miss.
+/// \param id - Lookup id.
+/// \return Returns key owned by caller or 'nullptr' on miss.
+///
+EVP_PKEY* QSimpleCrypto::QKeyCache::find(const QByteArray& id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_entries.find(id);
+    if (found == m_entries.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+
+    m_order.splice(m_order.begin(), m_order, found->position);
+    ++m_hits;
+
+    EVP_PKEY_up_ref(found->key);
+    return found->key;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::insert - Function caches parsed key, unless other thread cached the same key first.
+/// \param id - Lookup id.
+/// \param key - Parsed key. Ownership is taken.
+/// \param filePath - File of key. Previous key of the same file is dropped.
+/// \return Returns key owned by caller.
+///
+EVP_PKEY* QSimpleCrypto::QKeyCache::insert(const QByteArray& id, EVP_PKEY* key, const QByteArray& filePath)
+{
+    std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY*)> parsed { key, EVP_PKEY_free };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_entries.find(id);
+    if (found != m_entries.end()) {
+        EVP_PKEY_up_ref(found->key);
+        return found->key;
+    }
+
+    /* Key of previous file version can't be returned anymore, so it is dropped right away */
+    if (!filePath.isEmpty()) {
+        const auto file = m_files.find(filePath);
+        if (file != m_files.end()) {
+            erase(m_entries.find(file.value()));
+        }
+    }
+
+    if (m_entries.size() >= m_capacity) {
+        erase(m_entries.find(m_order.back()));
+    }
+
+    /* One reference stays in cache, another one goes to caller */
+    m_order.push_front(id);
+    m_entries.insert(id, Entry { parsed.get(), m_order.begin(), filePath });
+    if (!filePath.isEmpty()) {
+        m_files.insert(filePath, id);
+    }
+    EVP_PKEY_up_ref(parsed.get());
+
+    return parsed.release();
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::erase - Function drops entry. Mutex must be locked.
+/// \param entry - Entry iterator.
+///
+void QSimpleCrypto::QKeyCache::erase(QHash<QByteArray, Entry>::iterator entry)
+{
+    if (entry == m_entries.end()) {
+        return;
+    }
+
+    if (!entry->filePath.isEmpty()) {
+        m_files.remove(entry->filePath);
+    }
+
+    EVP_PKEY_free(entry->key);
+    m_order.erase(entry->position);
+    m_entries.erase(entry);
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::cacheId - Function computes lookup id of key.
+/// \param type - 'P' for public key and 'S' for private key.
+/// \param encoded - Encoded key.
+/// \param password - Private key password.
+/// \return Returns SHA-256 of type, password and encoding.
+///
+QByteArray QSimpleCrypto::QKeyCache::cacheId(const char type, const QByteArray& encoded, const QByteArray& password)
+{
+    std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX*)> context { EVP_MD_CTX_new(), EVP_MD_CTX_free };
+    if (!context) {
+        throw std::runtime_error("Couldn't initialize EVP_MD_CTX. EVP_MD_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    /* Password length is hashed first, so password and encoding can't shift into each other */
+    const quint64 passwordLength = static_cast<quint64>(password.size());
+    QByteArray id(EVP_MAX_MD_SIZE, Qt::Uninitialized);
+    quint32 idLength = 0;
+    if (!EVP_DigestInit_ex(context.get(), EVP_sha256(), nullptr)
+        || !EVP_DigestUpdate(context.get(), &type, 1)
+        || !EVP_DigestUpdate(context.get(), &passwordLength, sizeof(passwordLength))
+        || !EVP_DigestUpdate(context.get(), password.constData(), password.size())
+        || !EVP_DigestUpdate(context.get(), encoded.constData(), encoded.size())
+        || !EVP_DigestFinal_ex(context.get(), reinterpret_cast<unsigned char*>(id.data()), &idLength)) {
+        throw std::runtime_error("Couldn't compute key id. EVP_DigestFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    id.resize(static_cast<qint32>(idLength));
+    return id;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyCache::fileVersion - Function returns device, inode, modification time and size of file.
+/// \param filePath - File path.
+/// \return Returns bytes, that change when file is replaced or rewritten.
+///
+QByteArray QSimpleCrypto::QKeyCache::fileVersion(const QByteArray& filePath)
+{
+#if defined(Q_OS_WIN)
+    /* Windows has no inode, so replacement is detected by modification time and size */
+    struct _stat64 status;
+    if (_wstat64(QString::fromUtf8(filePath).toStdWString().c_str(), &status) != 0) {
+        throw std::runtime_error("Couldn't get key file status. _wstat64(). Error: " + QByteArray(std::strerror(errno)));
+    }
+
+    const qint64 fields[] = { status.st_dev, 0, status.st_mtime, 0, status.st_size };
+#else
+    struct stat status;
+    if (stat(filePath.constData(), &status) != 0) {
+        throw std::runtime_error("Couldn't get key file status. stat(). Error: " + QByteArray(std::strerror(errno)));
+    }
+
+#if defined(Q_OS_DARWIN)
+    const qint64 modificationNanoseconds = status.st_mtimespec.tv_nsec;
+#else
+    const qint64 modificationNanoseconds = status.st_mtim.tv_nsec;
+#endif
+
+    const qint64 fields[] = { static_cast<qint64>(status.st_dev), static_cast<qint64>(status.st_ino), static_cast<qint64>(status.st_mtime), modificationNanoseconds,
+        static_cast<qint64>(status.st_size) };
+#endif
+
+    return QByteArray(reinterpret_cast<const char*>(fields), sizeof(fields));
+}
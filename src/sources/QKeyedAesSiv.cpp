@@ -0,0 +1,325 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QKeyedAesSiv.h"
+
+namespace {
+///
+/// \brief doubleBlock - Function multiplies block by x in GF(2^128), as "dbl" in RFC 5297.
+/// \param block - Block that will be doubled in place.
+///
+void doubleBlock(unsigned char* block)
+{
+    const unsigned char carry = (block[0] & 0x80) ? 0x87 : 0x00;
+
+    for (qint32 i = 0; i < aesSivTagLength - 1; ++i) {
+        block[i] = static_cast<unsigned char>((block[i] << 1) | (block[i + 1] >> 7));
+    }
+
+    block[aesSivTagLength - 1] = static_cast<unsigned char>((block[aesSivTagLength - 1] << 1) ^ carry);
+}
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QKeyedAesSiv::QKeyedAesSiv - Initializes AES-SIV contexts for key.
+/// \param key - AES-SIV key. Size selects cipher: 32 bytes for AES-128-SIV, 48 for AES-192-SIV and 64 for AES-256-SIV.
+///
+QSimpleCrypto::QKeyedAesSiv::QKeyedAesSiv(const QByteArray& key)
+{
+    try {
+        /* AES-SIV key is two AES keys: one for S2V (CMAC) and one for CTR */
+        const char* cipherName = nullptr;
+        const char* macCipherName = nullptr;
+        switch (key.size()) {
+        case 32:
+            cipherName = "AES-128-SIV";
+            macCipherName = "AES-128-CBC";
+            break;
+        case 48:
+            cipherName = "AES-192-SIV";
+            macCipherName = "AES-192-CBC";
+            break;
+        case 64:
+            cipherName = "AES-256-SIV";
+            macCipherName = "AES-256-CBC";
+            break;
+        default:
+            throw std::runtime_error("AES-SIV key size must be 32, 48 or 64 bytes.");
+        }
+
+        /* Fetch cipher implementation */
+        std::unique_ptr<EVP_CIPHER, void (*)(EVP_CIPHER*)> cipher { EVP_CIPHER_fetch(nullptr, cipherName, nullptr), EVP_CIPHER_free };
+        if (!cipher) {
+            throw std::runtime_error("Couldn't fetch AES-SIV cipher. EVP_CIPHER_fetch(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Initialize EVP_CIPHER_CTX */
+        m_encryptionTemplate.reset(EVP_CIPHER_CTX_new());
+        m_decryptionTemplate.reset(EVP_CIPHER_CTX_new());
+        m_context.reset(EVP_CIPHER_CTX_new());
+        if (!m_encryptionTemplate || !m_decryptionTemplate || !m_context) {
+            throw std::runtime_error("Couldn't initialize cipher contexts. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Run key expansion once. SIV state can't be reset with the same key, so messages are processed on copies */
+        if (!EVP_EncryptInit_ex(m_encryptionTemplate.get(), cipher.get(), nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr)) {
+            throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_DecryptInit_ex(m_decryptionTemplate.get(), cipher.get(), nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr)) {
+            throw std::runtime_error("Couldn't initialize decryption operation. EVP_DecryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* First half of key is S2V (CMAC) key. It is needed only for empty messages */
+        std::unique_ptr<EVP_MAC, void (*)(EVP_MAC*)> mac { EVP_MAC_fetch(nullptr, "CMAC", nullptr), EVP_MAC_free };
+        if (!mac) {
+            throw std::runtime_error("Couldn't fetch CMAC. EVP_MAC_fetch(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        m_macTemplate.reset(EVP_MAC_CTX_new(mac.get()));
+        if (!m_macTemplate) {
+            throw std::runtime_error("Couldn't initialize CMAC context. EVP_MAC_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        const OSSL_PARAM parameters[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_CIPHER, const_cast<char*>(macCipherName), 0),
+            OSSL_PARAM_construct_end()
+        };
+
+        if (!EVP_MAC_init(m_macTemplate.get(), reinterpret_cast<const unsigned char*>(key.data()), static_cast<size_t>(key.size() / 2), parameters)) {
+            throw std::runtime_error("Couldn't initialize CMAC. EVP_MAC_init(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedAesSiv::clone - Function copies initialized contexts, without running key expansion again.
+/// \return Returns independent copy, that can be used from another thread.
+///
+QSimpleCrypto::QKeyedAesSiv QSimpleCrypto::QKeyedAesSiv::clone() const
+{
+    try {
+        QKeyedAesSiv copy;
+
+        /* Initialize EVP_CIPHER_CTX */
+        copy.m_encryptionTemplate.reset(EVP_CIPHER_CTX_new());
+        copy.m_decryptionTemplate.reset(EVP_CIPHER_CTX_new());
+        copy.m_context.reset(EVP_CIPHER_CTX_new());
+        if (!copy.m_encryptionTemplate || !copy.m_decryptionTemplate || !copy.m_context) {
+            throw std::runtime_error("Couldn't initialize cipher contexts. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Copy expanded keys */
+        if (!EVP_CIPHER_CTX_copy(copy.m_encryptionTemplate.get(), m_encryptionTemplate.get()) || !EVP_CIPHER_CTX_copy(copy.m_decryptionTemplate.get(), m_decryptionTemplate.get())) {
+            throw std::runtime_error("Couldn't copy cipher contexts. EVP_CIPHER_CTX_copy(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        copy.m_macTemplate.reset(EVP_MAC_CTX_dup(m_macTemplate.get()));
+        if (!copy.m_macTemplate) {
+            throw std::runtime_error("Couldn't copy CMAC context. EVP_MAC_CTX_dup(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return copy;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedAesSiv::encrypt - Function encrypts data with AES-SIV.
+/// \param data - Data that will be encrypted.
+/// \param aad - Additional authenticated data. Empty aad is not authenticated.
+/// \return Returns synthetic IV followed by cipher text.
+///
+QByteArray QSimpleCrypto::QKeyedAesSiv::encrypt(const QByteArray& data, const QByteArray& aad)
+{
+    QByteArray cipherText(data.size() + aesSivTagLength, Qt::Uninitialized);
+    encrypt(reinterpret_cast<const unsigned char*>(data.data()), data.size(), reinterpret_cast<unsigned char*>(cipherText.data()), aad);
+
+    return cipherText;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedAesSiv::encrypt - Function encrypts raw buffer with AES-SIV.
+/// \param data - Pointer to data that will be encrypted.
+/// \param size - Size of data.
+/// \param output - Output buffer with at least 'size + aesSivTagLength' bytes.
+/// \param aad - Additional authenticated data. Empty aad is not authenticated.
+///
+void QSimpleCrypto::QKeyedAesSiv::encrypt(const unsigned char* data, const qint32 size, unsigned char* output, const QByteArray& aad)
+{
+    try {
+        /* Empty message has no cipher text, only synthetic IV */
+        if (size == 0) {
+            emptyMessageSiv(aad, output);
+            return;
+        }
+
+        /* Start from expanded key template */
+        if (!EVP_CIPHER_CTX_copy(m_context.get(), m_encryptionTemplate.get())) {
+            throw std::runtime_error("Couldn't copy cipher context. EVP_CIPHER_CTX_copy(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        qint32 length = 0;
+
+        /* Provide AAD as one S2V component */
+        if (!aad.isEmpty() && !EVP_EncryptUpdate(m_context.get(), nullptr, &length, reinterpret_cast<const unsigned char*>(aad.data()), aad.size())) {
+            throw std::runtime_error("Couldn't provide aad data. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* SIV accepts whole message in one update */
+        if (!EVP_EncryptUpdate(m_context.get(), output + aesSivTagLength, &length, data, size)) {
+            throw std::runtime_error("Couldn't provide message to be encrypted. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_EncryptFinal_ex(m_context.get(), output + aesSivTagLength + length, &length)) {
+            throw std::runtime_error("Couldn't finalize encryption. EVP_EncryptFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Synthetic IV is stored in front of cipher text, as described in RFC 5297 */
+        if (!EVP_CIPHER_CTX_ctrl(m_context.get(), EVP_CTRL_AEAD_GET_TAG, aesSivTagLength, output)) {
+            throw std::runtime_error("Couldn't get tag. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedAesSiv::decrypt - Function decrypts data encrypted with AES-SIV.
+/// \param data - Synthetic IV followed by cipher text.
+/// \param aad - Additional authenticated data.
+/// \return Returns decrypted data. Throws, if authentication fails.
+///
+QByteArray QSimpleCrypto::QKeyedAesSiv::decrypt(const QByteArray& data, const QByteArray& aad)
+{
+    if (data.size() < aesSivTagLength) {
+        throw std::runtime_error("Encrypted data is shorter than synthetic IV.");
+    }
+
+    QByteArray plainText(data.size() - aesSivTagLength, Qt::Uninitialized);
+    decrypt(reinterpret_cast<const unsigned char*>(data.data()), data.size(), reinterpret_cast<unsigned char*>(plainText.data()), aad);
+
+    return plainText;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedAesSiv::decrypt - Function decrypts raw buffer encrypted with AES-SIV.
+/// \param data - Pointer to synthetic IV followed by cipher text.
+/// \param size - Size of data. Must be at least aesSivTagLength.
+/// \param output - Output buffer with at least 'size - aesSivTagLength' bytes.
+/// \param aad - Additional authenticated data.
+///
+void QSimpleCrypto::QKeyedAesSiv::decrypt(const unsigned char* data, const qint32 size, unsigned char* output, const QByteArray& aad)
+{
+    try {
+        if (size < aesSivTagLength) {
+            throw std::runtime_error("Encrypted data is shorter than synthetic IV.");
+        }
+
+        /* Empty message is authenticated by comparing synthetic IV */
+        if (size == aesSivTagLength) {
+            unsigned char siv[aesSivTagLength];
+            emptyMessageSiv(aad, siv);
+
+            if (CRYPTO_memcmp(siv, data, aesSivTagLength) != 0) {
+                throw std::runtime_error("Couldn't decrypt message or authentication failed.");
+            }
+
+            return;
+        }
+
+        /* Start from expanded key template */
+        if (!EVP_CIPHER_CTX_copy(m_context.get(), m_decryptionTemplate.get())) {
+            throw std::runtime_error("Couldn't copy cipher context. EVP_CIPHER_CTX_copy(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Synthetic IV must be set before cipher text is provided. Tag is copied, because OpenSSL expects writable buffer */
+        unsigned char tag[aesSivTagLength];
+        std::copy(data, data + aesSivTagLength, tag);
+
+        if (!EVP_CIPHER_CTX_ctrl(m_context.get(), EVP_CTRL_AEAD_SET_TAG, aesSivTagLength, tag)) {
+            throw std::runtime_error("Couldn't set tag. EVP_CIPHER_CTX_ctrl(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        qint32 length = 0;
+
+        /* Provide AAD as one S2V component */
+        if (!aad.isEmpty() && !EVP_DecryptUpdate(m_context.get(), nullptr, &length, reinterpret_cast<const unsigned char*>(aad.data()), aad.size())) {
+            throw std::runtime_error("Couldn't provide aad data. EVP_DecryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Authentication is checked during update, failed message is not returned */
+        if (!EVP_DecryptUpdate(m_context.get(), output, &length, data + aesSivTagLength, size - aesSivTagLength)) {
+            throw std::runtime_error("Couldn't decrypt message or authentication failed. EVP_DecryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_DecryptFinal_ex(m_context.get(), output + length, &length)) {
+            throw std::runtime_error("Couldn't finalize decryption. EVP_DecryptFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedAesSiv::emptyMessageSiv - Function computes synthetic IV of empty message.
+/// \param aad - Additional authenticated data. Empty aad is not authenticated.
+/// \param siv - Output buffer with aesSivTagLength bytes.
+///
+void QSimpleCrypto::QKeyedAesSiv::emptyMessageSiv(const QByteArray& aad, unsigned char* siv)
+{
+    try {
+        /* Computes CMAC of one buffer on copy of keyed template */
+        const auto cmac = [this](const unsigned char* data, const size_t size, unsigned char* output) {
+            std::unique_ptr<EVP_MAC_CTX, void (*)(EVP_MAC_CTX*)> context { EVP_MAC_CTX_dup(m_macTemplate.get()), EVP_MAC_CTX_free };
+            if (!context) {
+                throw std::runtime_error("Couldn't copy CMAC context. EVP_MAC_CTX_dup(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            size_t length = 0;
+            if (!EVP_MAC_update(context.get(), data, size) || !EVP_MAC_final(context.get(), output, &length, aesSivTagLength)) {
+                throw std::runtime_error("Couldn't compute CMAC. EVP_MAC_final(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+        };
+
+        /* S2V from RFC 5297: D = CMAC(zero), D = dbl(D) xor CMAC(aad) */
+        unsigned char block[aesSivTagLength] = {};
+        unsigned char digest[aesSivTagLength];
+        cmac(block, aesSivTagLength, digest);
+
+        if (!aad.isEmpty()) {
+            cmac(reinterpret_cast<const unsigned char*>(aad.data()), static_cast<size_t>(aad.size()), block);
+            doubleBlock(digest);
+
+            for (qint32 i = 0; i < aesSivTagLength; ++i) {
+                digest[i] ^= block[i];
+            }
+        }
+
+        /* Last component is empty message: T = dbl(D) xor pad(""), V = CMAC(T) */
+        doubleBlock(digest);
+        digest[0] ^= 0x80;
+
+        cmac(digest, aesSivTagLength, siv);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
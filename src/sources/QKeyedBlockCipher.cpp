@@ -0,0 +1,190 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QKeyedBlockCipher.h"
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::QKeyedBlockCipher - Initializes encryption and decryption contexts for key.
+/// \param key - AES key. Size must match cipher key length. Example: "AABBCCEEFFGGHHKKLLMMNNOOPPRRSSTT"
+/// \param cipher - Can be used with OpenSSL EVP_CIPHER (ecb, cbc, cfb, ofb, ctr) - 128, 192, 256. Example: EVP_aes_256_cbc().
+///
+QSimpleCrypto::QKeyedBlockCipher::QKeyedBlockCipher(const QByteArray& key, const EVP_CIPHER* cipher)
+{
+    try {
+        if (key.size() != EVP_CIPHER_get_key_length(cipher)) {
+            throw std::runtime_error("Key size doesn't match cipher key length.");
+        }
+
+        /* Initialize EVP_CIPHER_CTX */
+        m_encryptionContext.reset(EVP_CIPHER_CTX_new());
+        m_decryptionContext.reset(EVP_CIPHER_CTX_new());
+        if (!m_encryptionContext || !m_decryptionContext) {
+            throw std::runtime_error("Couldn't initialize cipher contexts. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Run key expansion once. IV is provided on every call */
+        if (!EVP_EncryptInit_ex(m_encryptionContext.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr)) {
+            throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_DecryptInit_ex(m_decryptionContext.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr)) {
+            throw std::runtime_error("Couldn't initialize decryption operation. EVP_DecryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::clone - Function copies initialized contexts, without running key expansion again.
+/// \return Returns independent copy, that can be used from another thread.
+///
+QSimpleCrypto::QKeyedBlockCipher QSimpleCrypto::QKeyedBlockCipher::clone() const
+{
+    try {
+        QKeyedBlockCipher copy;
+
+        /* Initialize EVP_CIPHER_CTX */
+        copy.m_encryptionContext.reset(EVP_CIPHER_CTX_new());
+        copy.m_decryptionContext.reset(EVP_CIPHER_CTX_new());
+        if (!copy.m_encryptionContext || !copy.m_decryptionContext) {
+            throw std::runtime_error("Couldn't initialize cipher contexts. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Copy expanded key schedule */
+        if (!EVP_CIPHER_CTX_copy(copy.m_encryptionContext.get(), m_encryptionContext.get()) || !EVP_CIPHER_CTX_copy(copy.m_decryptionContext.get(), m_decryptionContext.get())) {
+            throw std::runtime_error("Couldn't copy cipher contexts. EVP_CIPHER_CTX_copy(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return copy;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::encrypt - Function encrypts data with bound key.
+/// \param data - Data that will be encrypted.
+/// \param iv - Initialization vector. Size must match cipher IV length. Ignored for ECB.
+/// \return Returns encrypted data.
+///
+QByteArray QSimpleCrypto::QKeyedBlockCipher::encrypt(const QByteArray& data, const QByteArray& iv)
+{
+    if (iv.size() < ivLength()) {
+        throw std::runtime_error("IV size doesn't match cipher IV length.");
+    }
+
+    QByteArray cipherText(data.size() + blockSize(), Qt::Uninitialized);
+    cipherText.resize(encrypt(reinterpret_cast<const unsigned char*>(data.data()), data.size(), reinterpret_cast<unsigned char*>(cipherText.data()), reinterpret_cast<const unsigned char*>(iv.data())));
+
+    return cipherText;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::encrypt - Function encrypts raw buffer with bound key.
+/// \param data - Pointer to data that will be encrypted.
+/// \param size - Size of data.
+/// \param output - Output buffer. Must have at least 'size + blockSize()' bytes. May be equal to 'data'.
+/// \param iv - Pointer to initialization vector with 'ivLength()' bytes. Ignored for ECB.
+/// \return Returns size of encrypted data.
+///
+qint32 QSimpleCrypto::QKeyedBlockCipher::encrypt(const unsigned char* data, const qint32 size, unsigned char* output, const unsigned char* iv)
+{
+    return transform(m_encryptionContext.get(), data, size, output, iv);
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::decrypt - Function decrypts data with bound key.
+/// \param data - Data that will be decrypted.
+/// \param iv - Initialization vector. Size must match cipher IV length. Ignored for ECB.
+/// \return Returns decrypted data.
+///
+QByteArray QSimpleCrypto::QKeyedBlockCipher::decrypt(const QByteArray& data, const QByteArray& iv)
+{
+    if (iv.size() < ivLength()) {
+        throw std::runtime_error("IV size doesn't match cipher IV length.");
+    }
+
+    QByteArray plainText(data.size() + blockSize(), Qt::Uninitialized);
+    plainText.resize(decrypt(reinterpret_cast<const unsigned char*>(data.data()), data.size(), reinterpret_cast<unsigned char*>(plainText.data()), reinterpret_cast<const unsigned char*>(iv.data())));
+
+    return plainText;
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::decrypt - Function decrypts raw buffer with bound key.
+/// \param data - Pointer to data that will be decrypted.
+/// \param size - Size of data.
+/// \param output - Output buffer. Must have at least 'size + blockSize()' bytes. May be equal to 'data'.
+/// \param iv - Pointer to initialization vector with 'ivLength()' bytes. Ignored for ECB.
+/// \return Returns size of decrypted data.
+///
+qint32 QSimpleCrypto::QKeyedBlockCipher::decrypt(const unsigned char* data, const qint32 size, unsigned char* output, const unsigned char* iv)
+{
+    return transform(m_decryptionContext.get(), data, size, output, iv);
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::ivLength - Function returns initialization vector length of bound cipher.
+/// \return Returns IV length in bytes. Zero for ECB.
+///
+qint32 QSimpleCrypto::QKeyedBlockCipher::ivLength() const
+{
+    return EVP_CIPHER_CTX_get_iv_length(m_encryptionContext.get());
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::blockSize - Function returns block size of bound cipher.
+/// \return Returns block size in bytes. One for stream-like modes.
+///
+qint32 QSimpleCrypto::QKeyedBlockCipher::blockSize() const
+{
+    return EVP_CIPHER_CTX_get_block_size(m_encryptionContext.get());
+}
+
+///
+/// \brief QSimpleCrypto::QKeyedBlockCipher::transform - Function resets IV of initialized context and runs it over data.
+/// \param context - Initialized encryption or decryption context.
+/// \param data - Input data.
+/// \param size - Size of input data.
+/// \param output - Output buffer.
+/// \param iv - Pointer to initialization vector.
+/// \return Returns size of output data.
+///
+qint32 QSimpleCrypto::QKeyedBlockCipher::transform(EVP_CIPHER_CTX* context, const unsigned char* data, const qint32 size, unsigned char* output, const unsigned char* iv)
+{
+    try {
+        /* Reset operation state and IV. Key schedule stays untouched, because key is not provided */
+        if (!EVP_CipherInit_ex(context, nullptr, nullptr, nullptr, iv, -1)) {
+            throw std::runtime_error("Couldn't reset cipher operation. EVP_CipherInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        qint32 outputLength = 0;
+        qint32 finalLength = 0;
+
+        /* Provide the message and obtain the output */
+        if (!EVP_CipherUpdate(context, output, &outputLength, data, size)) {
+            throw std::runtime_error("Couldn't provide message to cipher. EVP_CipherUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Finalize the operation. For decryption that checks padding */
+        if (!EVP_CipherFinal_ex(context, output + outputLength, &finalLength)) {
+            throw std::runtime_error("Couldn't finalize cipher operation. EVP_CipherFinal_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return outputLength + finalLength;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
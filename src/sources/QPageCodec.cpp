@@ -0,0 +1,252 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QPageCodec.h"
+
+#include <QtEndian>
+
+///
+/// \brief QSimpleCrypto::QPageCodec::QPageCodec - Initializes contexts for key.
+/// \param key - AES key. 64 bytes for XTS and 32 bytes for GCM.
+/// \param mode - Page encryption mode.
+/// \param pageSize - Page size. Must be power of two from 512 to 65536 bytes. Example: 4096, 8192, 16384.
+///
+QSimpleCrypto::QPageCodec::QPageCodec(const QByteArray& key, const Mode mode, const qint32 pageSize)
+    : m_mode(mode)
+    , m_pageSize(pageSize)
+{
+    try {
+        if (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize - 1)) != 0) {
+            throw std::runtime_error("Page size must be power of two from 512 to 65536 bytes.");
+        }
+
+        const EVP_CIPHER* cipher = (mode == Mode::Xts) ? EVP_aes_256_xts() : EVP_aes_256_gcm();
+        if (key.size() != EVP_CIPHER_get_key_length(cipher)) {
+            throw std::runtime_error("Key size doesn't match cipher key length.");
+        }
+
+        /* Initialize EVP_CIPHER_CTX */
+        m_encryptionContext.reset(EVP_CIPHER_CTX_new());
+        m_decryptionContext.reset(EVP_CIPHER_CTX_new());
+        if (!m_encryptionContext || !m_decryptionContext) {
+            throw std::runtime_error("Couldn't initialize cipher contexts. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Run key expansion once. Tweak or nonce is provided for every page */
+        if (!EVP_EncryptInit_ex(m_encryptionContext.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr)) {
+            throw std::runtime_error("Couldn't initialize encryption operation. EVP_EncryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_DecryptInit_ex(m_decryptionContext.get(), cipher, nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr)) {
+            throw std::runtime_error("Couldn't initialize decryption operation. EVP_DecryptInit_ex(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::clone - Function copies initialized contexts, without running key expansion again.
+/// \return Returns independent copy, that can be used from another thread.
+///
+QSimpleCrypto::QPageCodec QSimpleCrypto::QPageCodec::clone() const
+{
+    try {
+        QPageCodec copy;
+        copy.m_mode = m_mode;
+        copy.m_pageSize = m_pageSize;
+
+        /* Initialize EVP_CIPHER_CTX */
+        copy.m_encryptionContext.reset(EVP_CIPHER_CTX_new());
+        copy.m_decryptionContext.reset(EVP_CIPHER_CTX_new());
+        if (!copy.m_encryptionContext || !copy.m_decryptionContext) {
+            throw std::runtime_error("Couldn't initialize cipher contexts. EVP_CIPHER_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Copy expanded keys */
+        if (!EVP_CIPHER_CTX_copy(copy.m_encryptionContext.get(), m_encryptionContext.get()) || !EVP_CIPHER_CTX_copy(copy.m_decryptionContext.get(), m_decryptionContext.get())) {
+            throw std::runtime_error("Couldn't copy cipher contexts. EVP_CIPHER_CTX_copy(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        return copy;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::pageSize - Function returns page size.
+/// \return Returns page size in bytes.
+///
+qint32 QSimpleCrypto::QPageCodec::pageSize() const
+{
+    return m_pageSize;
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::payloadSize - Function returns number of page bytes, that storage engine can use.
+/// \return Returns page size without reserved tail.
+///
+qint32 QSimpleCrypto::QPageCodec::payloadSize() const
+{
+    return (m_mode == Mode::Gcm) ? m_pageSize - pageGcmReservedSize : m_pageSize;
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::encryptPage - Function encrypts page in place.
+/// \param page - Pointer to page with 'pageSize()' bytes. In GCM mode reserved tail is overwritten.
+/// \param pageNumber - Page number. Page must be decrypted with the same number.
+///
+void QSimpleCrypto::QPageCodec::encryptPage(unsigned char* page, const quint64 pageNumber)
+{
+    try {
+        EVP_CIPHER_CTX* context = m_encryptionContext.get();
+        const qint32 payload = payloadSize();
+
+        /* Page number is little endian sector number (IEEE 1619) in XTS and aad in GCM */
+        unsigned char number[16] = {};
+        qToLittleEndian<quint64>(pageNumber, number);
+
+        unsigned char* nonce = page + payload;
+        if (m_mode == Mode::Gcm) {
+            QRandomPool::fill(nonce, pageGcmNonceLength);
+        }
+
+        /* Reset operation with new tweak or nonce. Key schedule stays untouched */
+        QGcm::setIv(context, (m_mode == Mode::Xts) ? number : nonce);
+
+        qint32 length = 0;
+
+        if (m_mode == Mode::Gcm && !EVP_EncryptUpdate(context, nullptr, &length, number, sizeof(quint64))) {
+            throw std::runtime_error("Couldn't provide page number. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_EncryptUpdate(context, page, &length, page, payload)) {
+            throw std::runtime_error("Couldn't encrypt page. EVP_EncryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Tag is written into page tail after nonce. XTS has no tag */
+        QGcm::finalize(context, page + length, &length, (m_mode == Mode::Gcm) ? nonce + pageGcmNonceLength : nullptr, pageGcmTagLength);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::decryptPage - Function decrypts page in place.
+/// \param page - Pointer to page with 'pageSize()' bytes.
+/// \param pageNumber - Page number used in encryption.
+///
+void QSimpleCrypto::QPageCodec::decryptPage(unsigned char* page, const quint64 pageNumber)
+{
+    try {
+        EVP_CIPHER_CTX* context = m_decryptionContext.get();
+        const qint32 payload = payloadSize();
+
+        unsigned char number[16] = {};
+        qToLittleEndian<quint64>(pageNumber, number);
+
+        unsigned char* nonce = page + payload;
+
+        /* Reset operation with tweak or nonce stored in page tail */
+        QGcm::setIv(context, (m_mode == Mode::Xts) ? number : nonce);
+
+        qint32 length = 0;
+
+        if (m_mode == Mode::Gcm && !EVP_DecryptUpdate(context, nullptr, &length, number, sizeof(quint64))) {
+            throw std::runtime_error("Couldn't provide page number. EVP_DecryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!EVP_DecryptUpdate(context, page, &length, page, payload)) {
+            throw std::runtime_error("Couldn't decrypt page. EVP_DecryptUpdate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Fails if page is corrupted */
+        QGcm::finalize(context, page + length, &length, (m_mode == Mode::Gcm) ? nonce + pageGcmNonceLength : nullptr, pageGcmTagLength);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::encryptPages - Function encrypts list of pages in place.
+/// \param pages - Pointers to pages with 'pageSize()' bytes.
+/// \param pageNumbers - Page numbers. Size must match pages.
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+///
+void QSimpleCrypto::QPageCodec::encryptPages(const QVector<unsigned char*>& pages, const QVector<quint64>& pageNumbers, const qint32 threadCount) const
+{
+    transformPages(pages, pageNumbers, threadCount, true);
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::decryptPages - Function decrypts list of pages in place.
+/// \param pages - Pointers to pages with 'pageSize()' bytes.
+/// \param pageNumbers - Page numbers. Size must match pages.
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+///
+void QSimpleCrypto::QPageCodec::decryptPages(const QVector<unsigned char*>& pages, const QVector<quint64>& pageNumbers, const qint32 threadCount) const
+{
+    transformPages(pages, pageNumbers, threadCount, false);
+}
+
+///
+/// \brief QSimpleCrypto::QPageCodec::transformPages - Function runs single page function over list of pages on several threads.
+/// \param pages - Pointers to pages.
+/// \param pageNumbers - Page numbers.
+/// \param threadCount - Number of threads.
+/// \param encrypt - 'true' for encryption and 'false' for decryption.
+///
+void QSimpleCrypto::QPageCodec::transformPages(const QVector<unsigned char*>& pages, const QVector<quint64>& pageNumbers, const qint32 threadCount, const bool encrypt) const
+{
+    try {
+        if (pages.size() != pageNumbers.size()) {
+            throw std::runtime_error("Every page must have page number.");
+        }
+
+        /* One page is several microseconds of work, so few pages per thread already pay off */
+        const qint64 count = pages.size();
+        const qint32 threads = QBatchRunner::threadCount(threadCount, count, 8);
+
+        QBatchRunner::run(count, threads, [&](const qint64 begin, const qint64 end) {
+            QPageCodec codec = clone();
+            std::exception_ptr error;
+
+            /* Failed page doesn't stop other pages of the range */
+            for (qint64 i = begin; i < end; ++i) {
+                try {
+                    if (encrypt) {
+                        codec.encryptPage(pages[i], pageNumbers[i]);
+                    } else {
+                        codec.decryptPage(pages[i], pageNumbers[i]);
+                    }
+                } catch (...) {
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        });
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QPasswordHasher.h"
+
+#include <algorithm>
+
+namespace {
+///
+/// \brief passwordHashPrefix - First field of encoded hash.
+///
+const char passwordHashPrefix[] = "$scrypt$";
+
+///
+/// \brief encodeBase64 - Function encodes bytes with base64 without padding, as used by encoded hashes.
+/// \param data - Bytes.
+/// \return Returns base64 text.
+///
+QByteArray encodeBase64(const QByteArray& data)
+{
+    return data.toBase64(QByteArray::Base64Encoding | QByteArray::OmitTrailingEquals);
+}
+
+///
+/// \brief elapsedMicroseconds - Function returns time between two points in microseconds.
+/// \param begin - Start time.
+/// \param end - End time.
+/// \return Returns microseconds.
+///
+qint64 elapsedMicroseconds(const std::chrono::steady_clock::time_point& begin, const std::chrono::steady_clock::time_point& end)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+}
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::QPasswordHasher - Starts worker threads.
+/// \param workerCount - Number of worker threads. '0' means QThread::idealThreadCount().
+/// \param memoryBudget - Memory that all running derivations may use together.
+/// \param queueLimit - Number of requests, that may wait for worker. Further requests are rejected.
+/// \param cost - scrypt cost parameter N for new hashes. Must be power of two.
+/// \param blockSize - scrypt block size parameter r for new hashes.
+/// \param parallelism - scrypt parallelization parameter p for new hashes.
+///
+QSimpleCrypto::QPasswordHasher::QPasswordHasher(const qint32 workerCount, const qint64 memoryBudget, const qint32 queueLimit,
+    const quint64 cost, const quint64 blockSize, const quint64 parallelism)
+    : m_cost(cost)
+    , m_blockSize(blockSize)
+    , m_parallelism(parallelism)
+    , m_memoryBudget(memoryBudget)
+    , m_queueLimit(qMax(0, queueLimit))
+{
+    try {
+        if (cost < 2 || (cost & (cost - 1)) != 0 || blockSize == 0 || parallelism == 0) {
+            throw std::runtime_error("Invalid scrypt parameters.");
+        }
+
+        /* Budget that can't fit even one derivation would reject every request */
+        if (QBlockCipher::scryptMemory(cost, blockSize, parallelism) > memoryBudget) {
+            throw std::runtime_error("Memory budget is smaller than one scrypt derivation.");
+        }
+
+        m_waits.reserve(passwordHasherLatencyWindow);
+        m_latencies.reserve(passwordHasherLatencyWindow);
+
+        const qint32 workers = workerCount > 0 ? workerCount : qMax(1, QThread::idealThreadCount());
+        for (qint32 i = 0; i < workers; ++i) {
+            m_workers.emplace_back(&QPasswordHasher::work, this);
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::~QPasswordHasher - Finishes running derivations and fails queued requests.
+///
+QSimpleCrypto::QPasswordHasher::~QPasswordHasher()
+{
+    std::deque<Job> queue;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+        queue.swap(m_queue);
+    }
+    m_condition.notify_all();
+
+    for (auto& job : queue) {
+        const auto error = std::make_exception_ptr(std::runtime_error("Password hasher is stopped."));
+        if (job.expected.isEmpty()) {
+            job.hashResult.set_exception(error);
+        } else {
+            job.verifyResult.set_exception(error);
+        }
+    }
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::hash - Function queues hashing of password with random salt.
+/// \param password - Password.
+/// \return Returns future with encoded hash. Throws at once, if queue is full.
+///
+std::future<QByteArray> QSimpleCrypto::QPasswordHasher::hash(const QByteArray& password)
+{
+    try {
+        Job job;
+        job.password = password;
+        job.salt = QRandomPool::generate(passwordHasherSaltLength);
+        job.cost = m_cost;
+        job.blockSize = m_blockSize;
+        job.parallelism = m_parallelism;
+        job.memory = QBlockCipher::scryptMemory(m_cost, m_blockSize, m_parallelism);
+
+        std::future<QByteArray> result = job.hashResult.get_future();
+        submit(std::move(job));
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::verify - Function queues verification of password against encoded hash.
+/// \param password - Password.
+/// \param encodedHash - Hash returned by QPasswordHasher::hash().
+/// \return Returns future with 'true' if password matches. Throws at once, if queue is full or hash is malformed.
+///
+std::future<bool> QSimpleCrypto::QPasswordHasher::verify(const QByteArray& password, const QByteArray& encodedHash)
+{
+    try {
+        /* "$scrypt$ln=15,r=8,p=1$<salt>$<hash>" splits to "", "scrypt", parameters, salt and hash */
+        const auto fields = encodedHash.split('$');
+        if (!encodedHash.startsWith(passwordHashPrefix) || fields.size() != 5) {
+            throw std::runtime_error("Malformed password hash.");
+        }
+
+        Job job;
+        job.password = password;
+        job.salt = QByteArray::fromBase64(fields.at(3));
+        job.expected = QByteArray::fromBase64(fields.at(4));
+
+        for (const auto& parameter : fields.at(2).split(',')) {
+            bool valid = false;
+            const quint64 value = parameter.mid(parameter.indexOf('=') + 1).toULongLong(&valid);
+
+            if (!valid || value == 0) {
+                throw std::runtime_error("Malformed password hash parameters.");
+            }
+
+            if (parameter.startsWith("ln=") && value < 64) {
+                job.cost = Q_UINT64_C(1) << value;
+            } else if (parameter.startsWith("r=")) {
+                job.blockSize = value;
+            } else if (parameter.startsWith("p=")) {
+                job.parallelism = value;
+            } else {
+                throw std::runtime_error("Malformed password hash parameters.");
+            }
+        }
+
+        if (job.cost == 0 || job.blockSize == 0 || job.parallelism == 0 || job.expected.isEmpty()) {
+            throw std::runtime_error("Malformed password hash.");
+        }
+
+        /* Parameters come from stored hash, so scryptMemory() is checked without overflow before anything is allocated */
+        const quint64 budgetBlocks = static_cast<quint64>(m_memoryBudget) / 128;
+        if (job.blockSize > budgetBlocks || job.cost > budgetBlocks || job.parallelism > budgetBlocks
+            || job.cost + job.parallelism + 2 > budgetBlocks / job.blockSize) {
+            throw std::runtime_error("Password hash needs more memory than budget allows.");
+        }
+
+        job.memory = QBlockCipher::scryptMemory(job.cost, job.blockSize, job.parallelism);
+
+        std::future<bool> result = job.verifyResult.get_future();
+        submit(std::move(job));
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::metrics - Function returns queue depth, memory usage, counters and latency percentiles.
+/// \return Returns metrics snapshot.
+///
+QSimpleCrypto::QPasswordHasher::Metrics QSimpleCrypto::QPasswordHasher::metrics() const
+{
+    Metrics metrics;
+    std::vector<qint64> waits;
+    std::vector<qint64> latencies;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        metrics.queueDepth = static_cast<qint64>(m_queue.size());
+        metrics.running = m_running;
+        metrics.memoryInUse = m_memoryInUse;
+        metrics.accepted = m_accepted;
+        metrics.rejected = m_rejected;
+        metrics.completed = m_completed;
+
+        waits = m_waits;
+        latencies = m_latencies;
+    }
+
+    /* Percentiles are calculated outside of lock, so workers don't wait for it */
+    metrics.waitP50 = percentile(waits, 0.5);
+    metrics.waitP99 = percentile(waits, 0.99);
+    metrics.latencyP50 = percentile(latencies, 0.5);
+    metrics.latencyP99 = percentile(latencies, 0.99);
+
+    return metrics;
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::submit - Function puts job into queue or rejects it.
+/// \param job - Job with filled parameters.
+///
+void QSimpleCrypto::QPasswordHasher::submit(Job&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        /* Full queue means workers are behind already. Waiting longer would only raise latency of every request */
+        if (m_stopped || static_cast<qint64>(m_queue.size()) >= m_queueLimit) {
+            ++m_rejected;
+            throw std::runtime_error("Password hasher queue is full.");
+        }
+
+        ++m_accepted;
+        job.submitted = std::chrono::steady_clock::now();
+        m_queue.push_back(std::move(job));
+    }
+
+    m_condition.notify_one();
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::work - Worker thread function.
+///
+void QSimpleCrypto::QPasswordHasher::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        /* Jobs start in order. Head job waits until budget has room for it, so large jobs are not starved by small ones */
+        m_condition.wait(lock, [this] { return m_stopped || (!m_queue.empty() && m_memoryInUse + m_queue.front().memory <= m_memoryBudget); });
+        if (m_stopped) {
+            return;
+        }
+
+        Job job = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        m_memoryInUse += job.memory;
+        ++m_running;
+
+        const auto started = std::chrono::steady_clock::now();
+        lock.unlock();
+
+        /* Next queued job may fit into remaining budget */
+        m_condition.notify_one();
+
+        try {
+            const QByteArray derived = QBlockCipher().deriveKeyScrypt(job.password, job.salt,
+                job.expected.isEmpty() ? passwordHasherHashLength : job.expected.size(), job.cost, job.blockSize, job.parallelism);
+
+            if (job.expected.isEmpty()) {
+                qint32 log2Cost = 0;
+                while ((Q_UINT64_C(1) << log2Cost) < job.cost) {
+                    ++log2Cost;
+                }
+
+                job.hashResult.set_value(QByteArray(passwordHashPrefix) + "ln=" + QByteArray::number(log2Cost) + ",r=" + QByteArray::number(job.blockSize)
+                    + ",p=" + QByteArray::number(job.parallelism) + "$" + encodeBase64(job.salt) + "$" + encodeBase64(derived));
+            } else {
+                job.verifyResult.set_value(CRYPTO_memcmp(derived.constData(), job.expected.constData(), derived.size()) == 0);
+            }
+        } catch (...) {
+            if (job.expected.isEmpty()) {
+                job.hashResult.set_exception(std::current_exception());
+            } else {
+                job.verifyResult.set_exception(std::current_exception());
+            }
+        }
+
+        const auto finished = std::chrono::steady_clock::now();
+
+        lock.lock();
+        m_memoryInUse -= job.memory;
+        --m_running;
+        ++m_completed;
+        record(elapsedMicroseconds(job.submitted, started), elapsedMicroseconds(job.submitted, finished));
+
+        /* Released memory may let waiting worker start */
+        m_condition.notify_all();
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::record - Function stores wait and latency of finished job. Must be called with m_mutex locked.
+/// \param wait - Time in queue in microseconds.
+/// \param latency - Time from request to result in microseconds.
+///
+void QSimpleCrypto::QPasswordHasher::record(const qint64 wait, const qint64 latency)
+{
+    /* Ring of last passwordHasherLatencyWindow samples */
+    if (m_samples < passwordHasherLatencyWindow) {
+        m_waits.push_back(wait);
+        m_latencies.push_back(latency);
+    } else {
+        m_waits[m_samples % passwordHasherLatencyWindow] = wait;
+        m_latencies[m_samples % passwordHasherLatencyWindow] = latency;
+    }
+
+    ++m_samples;
+}
+
+///
+/// \brief QSimpleCrypto::QPasswordHasher::percentile - Function calculates percentile of samples.
+/// \param samples - Samples. Order is changed.
+/// \param fraction - Percentile as fraction. Example: 0.99.
+/// \return Returns sample at percentile, or 0 if there are no samples.
+///
+qint64 QSimpleCrypto::QPasswordHasher::percentile(std::vector<qint64>& samples, const double fraction)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+
+    const auto position = samples.begin() + static_cast<qint64>(fraction * (samples.size() - 1));
+    std::nth_element(samples.begin(), position, samples.end());
+
+    return *position;
+}
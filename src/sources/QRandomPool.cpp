@@ -0,0 +1,178 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QRandomPool.h"
+
+#include <atomic>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <pthread.h>
+#endif
+
+namespace {
+///
+/// \brief forkGeneration - Counter that is incremented in child process after every fork().
+///
+std::atomic<quint64> forkGeneration { 0 };
+
+///
+/// \brief RandomState - Per-thread DRBG and buffer of not yet used random bytes.
+///
+struct RandomState {
+    std::unique_ptr<EVP_RAND_CTX, void (*)(EVP_RAND_CTX*)> drbg { nullptr, EVP_RAND_CTX_free };
+    unsigned char buffer[randomPoolBufferSize];
+    qint64 available = 0;
+    quint64 generation = 0;
+
+    ~RandomState()
+    {
+        OPENSSL_cleanse(buffer, sizeof(buffer));
+    }
+};
+
+thread_local RandomState randomState;
+
+///
+/// \brief registerForkHandler - Function registers fork handler once per process.
+///
+void registerForkHandler()
+{
+#ifdef Q_OS_UNIX
+    static const bool registered = (pthread_atfork(nullptr, nullptr, [] { forkGeneration.fetch_add(1, std::memory_order_relaxed); }) == 0);
+    Q_UNUSED(registered)
+#endif
+}
+
+///
+/// \brief initializeDrbg - Function creates new CTR-DRBG for current thread, seeded from OpenSSL primary DRBG.
+/// \param state - Current thread state.
+///
+void initializeDrbg(RandomState& state)
+{
+    registerForkHandler();
+
+    /* Drop everything that was generated before fork or by previous DRBG */
+    OPENSSL_cleanse(state.buffer, sizeof(state.buffer));
+    state.available = 0;
+    state.generation = forkGeneration.load(std::memory_order_relaxed);
+    state.drbg.reset();
+
+    /* Fetch DRBG implementation */
+    std::unique_ptr<EVP_RAND, void (*)(EVP_RAND*)> rand { EVP_RAND_fetch(nullptr, "CTR-DRBG", nullptr), EVP_RAND_free };
+    if (!rand) {
+        throw std::runtime_error("Couldn't fetch CTR-DRBG. EVP_RAND_fetch(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    /* Initialize DRBG with primary DRBG as parent, so seed never comes from the same source twice */
+    state.drbg.reset(EVP_RAND_CTX_new(rand.get(), RAND_get0_primary(nullptr)));
+    if (!state.drbg) {
+        throw std::runtime_error("Couldn't initialize DRBG. EVP_RAND_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    OSSL_PARAM params[2];
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_DRBG_PARAM_CIPHER, const_cast<char*>("AES-256-CTR"), 0);
+    params[1] = OSSL_PARAM_construct_end();
+
+    if (!EVP_RAND_instantiate(state.drbg.get(), 256, 0, nullptr, 0, params)) {
+        state.drbg.reset();
+        throw std::runtime_error("Couldn't instantiate DRBG. EVP_RAND_instantiate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+}
+
+///
+/// \brief generateBytes - Function generates random bytes directly with DRBG.
+/// \param state - Current thread state.
+/// \param data - Output buffer.
+/// \param size - Number of bytes.
+///
+void generateBytes(RandomState& state, unsigned char* data, qint64 size)
+{
+    while (size > 0) {
+        const qint64 length = qMin<qint64>(size, randomPoolMaxRequest);
+
+        if (!EVP_RAND_generate(state.drbg.get(), data, length, 0, 0, nullptr, 0)) {
+            throw std::runtime_error("Couldn't generate random bytes. EVP_RAND_generate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        data += length;
+        size -= length;
+    }
+}
+} // namespace
+
+QSimpleCrypto::QRandomPool::QRandomPool()
+{
+}
+
+///
+/// \brief QSimpleCrypto::QRandomPool::fill - Function fills buffer with cryptographically secure random bytes.
+/// \param data - Pointer to buffer that will be filled.
+/// \param size - Size of buffer.
+///
+void QSimpleCrypto::QRandomPool::fill(unsigned char* data, const qint64 size)
+{
+    try {
+        RandomState& state = randomState;
+
+        /* Create DRBG on first use and recreate it in child process after fork */
+        if (!state.drbg || state.generation != forkGeneration.load(std::memory_order_relaxed)) {
+            initializeDrbg(state);
+        }
+
+        /* Large requests don't need buffering */
+        if (size >= randomPoolBufferSize) {
+            generateBytes(state, data, size);
+            return;
+        }
+
+        qint64 offset = 0;
+        while (offset < size) {
+            if (state.available == 0) {
+                generateBytes(state, state.buffer, randomPoolBufferSize);
+                state.available = randomPoolBufferSize;
+            }
+
+            /* Take bytes from the end of buffer and erase them, so every byte is used only once */
+            const qint64 length = qMin(size - offset, state.available);
+            unsigned char* source = state.buffer + state.available - length;
+
+            std::memcpy(data + offset, source, length);
+            OPENSSL_cleanse(source, length);
+
+            state.available -= length;
+            offset += length;
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRandomPool::fill - Function fills QByteArray with cryptographically secure random bytes.
+/// \param data - Data that will be overwritten with random bytes. Size of data is not changed.
+///
+void QSimpleCrypto::QRandomPool::fill(QByteArray& data)
+{
+    fill(reinterpret_cast<unsigned char*>(data.data()), data.size());
+}
+
+///
+/// \brief QSimpleCrypto::QRandomPool::generate - Function generates cryptographically secure random bytes.
+/// \param size - Number of generated bytes.
+/// \return Returns random bytes.
+///
+QByteArray QSimpleCrypto::QRandomPool::generate(const qint64 size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    fill(data);
+
+    return data;
+}
@@ -15,21 +15,30 @@ QSimpleCrypto::QRsa::QRsa()
 ///
 /// \brief QSimpleCrypto::QRsa::generateRsaKeys - Function generate Rsa Keys and returns them in OpenSSL structure.
 /// \param bits - RSA key size. For example: 2048, 4096.
-/// \param rsaBigNumber - The exponent is an odd number, typically 3, 17 or 65537.
-/// \return Returns 'OpenSSL RSA structure' or 'nullptr', if error happened. Returned value must be cleaned up with 'RSA_free()' to avoid memory leak.
+/// \param exponent - Public exponent. Odd number, typically 65537 (RSA_F4).
+/// \param primes - Number of primes in modulus. From 2 to maxPrimes(bits).
+/// \return Returns 'OpenSSL EVP RSA structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
 ///
-EVP_PKEY* QSimpleCrypto::QRsa::generateRsaKeys(quint32 bits, quint32 rsaPrimeNumber)
+EVP_PKEY* QSimpleCrypto::QRsa::generateRsaKeys(quint32 bits, quint64 exponent, quint32 primes)
 {
     try {
+        /* OpenSSL accepts even exponent and too many primes at this point and fails only inside generation, so they are checked first */
+        if (exponent < 3 || exponent % 2 == 0) {
+            throw std::runtime_error("Couldn't generate RSA key. Public exponent must be odd and greater than 1. Exponent: " + QByteArray::number(exponent));
+        }
+
+        if (primes < 2 || primes > maxPrimes(bits)) {
+            throw std::runtime_error("Couldn't generate RSA key. Number of primes is not permitted for key size. Primes: " + QByteArray::number(primes) + ", bits: " + QByteArray::number(bits));
+        }
+
         /* Initialize RSA */
-        EVP_PKEY* rsaKeys = nullptr;
-        EVP_PKEY_CTX* rsaKeysContext = EVP_PKEY_CTX_new_from_name(nullptr, "RSA", nullptr);
+        std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> rsaKeysContext { EVP_PKEY_CTX_new_from_name(nullptr, "RSA", nullptr), EVP_PKEY_CTX_free };
         if (!rsaKeysContext) {
             throw std::runtime_error("Couldn't initialize EVP_PKEY_CTX. EVP_PKEY_CTX_new_from_name(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
         /* Initializes a public key algorithm */
-        if (!EVP_PKEY_keygen_init(rsaKeysContext)) {
+        if (EVP_PKEY_keygen_init(rsaKeysContext.get()) <= 0) {
             throw std::runtime_error("Couldn't initialize public key algorithm. EVP_PKEY_keygen_init(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -40,22 +49,26 @@ EVP_PKEY* QSimpleCrypto::QRsa::generateRsaKeys(quint32 bits, quint32 rsaPrimeNum
         }
 
         /* Set big number */
-        if (!BN_set_word(bigNumber.get(), rsaPrimeNumber)) {
+        if (!BN_set_word(bigNumber.get(), exponent)) {
             throw std::runtime_error("Couldn't set bigNumber. BN_set_word(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        /* Generate key pair and store it in RSA */
-        OSSL_PARAM params[3];
-        params[0] = OSSL_PARAM_construct_uint("bits", &bits);
-        params[1] = OSSL_PARAM_construct_uint("primes", &rsaPrimeNumber);
-        params[2] = OSSL_PARAM_construct_end();
+        /* Set up key size, number of primes and public exponent to RSA key context */
+        if (EVP_PKEY_CTX_set_rsa_keygen_bits(rsaKeysContext.get(), static_cast<qint32>(bits)) <= 0) {
+            throw std::runtime_error("Couldn't set RSA key size. EVP_PKEY_CTX_set_rsa_keygen_bits(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (EVP_PKEY_CTX_set_rsa_keygen_primes(rsaKeysContext.get(), static_cast<qint32>(primes)) <= 0) {
+            throw std::runtime_error("Couldn't set number of primes. EVP_PKEY_CTX_set_rsa_keygen_primes(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
 
-        /* Set up params to RSA key context */
-        if (!EVP_PKEY_CTX_set_params(rsaKeysContext, params)) {
-            throw std::runtime_error("Couldn't set PKEY params. EVP_PKEY_CTX_set_params(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        if (EVP_PKEY_CTX_set1_rsa_keygen_pubexp(rsaKeysContext.get(), bigNumber.get()) <= 0) {
+            throw std::runtime_error("Couldn't set public exponent. EVP_PKEY_CTX_set1_rsa_keygen_pubexp(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        if (!EVP_PKEY_generate(rsaKeysContext, &rsaKeys)) {
+        /* Generate key pair and store it in RSA */
+        EVP_PKEY* rsaKeys = nullptr;
+        if (EVP_PKEY_generate(rsaKeysContext.get(), &rsaKeys) <= 0) {
             throw std::runtime_error("Couldn't generate EVP_PKEY key. EVP_PKEY_generate(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -67,6 +80,133 @@ EVP_PKEY* QSimpleCrypto::QRsa::generateRsaKeys(quint32 bits, quint32 rsaPrimeNum
     }
 }
 
+///
+/// \brief QSimpleCrypto::QRsa::maxPrimes - Function returns maximum number of primes, that OpenSSL permits for modulus bit length.
+/// \param bits - RSA key size.
+/// \return Returns number from 2 to 5.
+///
+quint32 QSimpleCrypto::QRsa::maxPrimes(const quint32 bits)
+{
+    if (bits >= 8192) {
+        return 5;
+    } else if (bits >= 4096) {
+        return 4;
+    } else if (bits >= 1024) {
+        return 3;
+    }
+
+    return 2;
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::benchmarkPrimes - Function measures key generation, signing and decryption of keys with every permitted prime count.
+/// \param bits - RSA key size. For example: 4096.
+/// \param iterations - Number of signatures and decryptions measured for every key.
+/// \return Returns timings for prime counts from 2 to maxPrimes(bits).
+///
+QVector<QSimpleCrypto::QRsa::PrimesBenchmark> QSimpleCrypto::QRsa::benchmarkPrimes(const quint32 bits, const qint32 iterations)
+{
+    try {
+        QRsa rsa;
+        const QByteArray message = QByteArray(32, 'm');
+        const qint32 rounds = qMax(1, iterations);
+
+        QVector<PrimesBenchmark> results;
+        for (quint32 primes = 2; primes <= maxPrimes(bits); ++primes) {
+            PrimesBenchmark result;
+            result.primes = primes;
+
+            QElapsedTimer timer;
+            timer.start();
+            std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY*)> key { rsa.generateRsaKeys(bits, RSA_F4, primes), EVP_PKEY_free };
+            result.generateTime = timer.nsecsElapsed();
+
+            /* Encryption uses public exponent only, so it is the same for all prime counts and is done outside timer */
+            const QByteArray cipherText = rsa.encrypt(message, key.get());
+
+            timer.restart();
+            for (qint32 round = 0; round < rounds; ++round) {
+                (void)rsa.sign(message, key.get());
+            }
+            result.signTime = timer.nsecsElapsed() / rounds;
+
+            timer.restart();
+            for (qint32 round = 0; round < rounds; ++round) {
+                if (rsa.decrypt(cipherText, key.get()) != message) {
+                    throw std::runtime_error("Couldn't benchmark RSA key. Decrypted message doesn't match. Primes: " + QByteArray::number(primes));
+                }
+            }
+            result.decryptTime = timer.nsecsElapsed() / rounds;
+
+            results.append(result);
+        }
+
+        return results;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::generateRsaKeysBatch - Function generates many RSA key pairs on several threads and hands out every key as soon as it is ready.
+/// \param count - Number of key pairs.
+/// \param bits - RSA key size. For example: 2048, 4096.
+/// \param exponent - Public exponent. For example: 65537.
+/// \param callback - Function '(qint64 index, EVP_PKEY* key)', that takes ownership of every key. Calls are serialized, but come from worker threads in completion order.
+/// \param cancelled - Optional flag. When it is set, threads finish keys in progress and start no new ones.
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \details Every key is made by generateRsaKeys(), so batch keys are the same as single keys.
+/// \return Returns number of keys passed to callback.
+///
+qint64 QSimpleCrypto::QRsa::generateRsaKeysBatch(const qint64 count, const quint32 bits, const quint64 exponent, const std::function<void(qint64, EVP_PKEY*)>& callback,
+    const std::atomic<bool>* cancelled, const qint32 threadCount)
+{
+    try {
+        if (count <= 0) {
+            return 0;
+        }
+
+        std::atomic<qint64> nextIndex { 0 };
+        std::atomic<qint64> delivered { 0 };
+        std::atomic<bool> failed { false };
+        std::mutex callbackMutex;
+
+        /* Generation time varies a lot between keys, so ranges are not fixed. Every thread takes next index, when it is free */
+        const qint32 threads = QBatchRunner::threadCount(threadCount, count, 1);
+        QBatchRunner::run(threads, threads, [&](const qint64 begin, const qint64 end) {
+            Q_UNUSED(begin)
+            Q_UNUSED(end)
+
+            try {
+                while (!failed.load(std::memory_order_relaxed) && !(cancelled && cancelled->load(std::memory_order_relaxed))) {
+                    const qint64 index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+                    if (index >= count) {
+                        return;
+                    }
+
+                    std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY*)> key { generateRsaKeys(bits, exponent), EVP_PKEY_free };
+
+                    std::lock_guard<std::mutex> lock(callbackMutex);
+                    callback(index, key.get());
+                    (void)key.release();
+                    delivered.fetch_add(1, std::memory_order_relaxed);
+                }
+            } catch (...) {
+                failed.store(true, std::memory_order_relaxed);
+                throw;
+            }
+        });
+
+        return delivered.load();
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
 ///
 /// \brief QSimpleCrypto::QRsa::savePublicKey - Saves to file RSA public key.
 /// \param key - RSA key. Must be provided with not null EVP_PKEY OpenSSL struct.
@@ -75,20 +215,16 @@ EVP_PKEY* QSimpleCrypto::QRsa::generateRsaKeys(quint32 bits, quint32 rsaPrimeNum
 void QSimpleCrypto::QRsa::savePublicKey(EVP_PKEY* key, const QByteArray& filePath)
 {
     try {
-        /* Initialize FILE */
-        FILE* publicKeyFile = fopen(filePath, "w+");
+        /* Initialize BIO. Closed on every path, so errors don't leak file handle */
+        std::unique_ptr<BIO, void (*)(BIO*)> publicKeyFile { BIO_new_file(filePath.constData(), "w+"), BIO_free_all };
         if (!publicKeyFile) {
-            throw std::runtime_error("Couldn't initialize FILE.");
+            throw std::runtime_error("Couldn't initialize publicKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
         /* Write public key on file */
-        if (!PEM_write_PUBKEY(publicKeyFile, key)) {
-            throw std::runtime_error("Couldn't save public key. PEM_write_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        if (!PEM_write_bio_PUBKEY(publicKeyFile.get(), key)) {
+            throw std::runtime_error("Couldn't save public key. PEM_write_bio_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
-
-        /* Close FILE to avoid memory leak */
-        fflush(publicKeyFile);
-        fclose(publicKeyFile);
     } catch (const std::exception& exception) {
         std::throw_with_nested(exception);
     } catch (...) {
@@ -106,20 +242,16 @@ void QSimpleCrypto::QRsa::savePublicKey(EVP_PKEY* key, const QByteArray& filePat
 void QSimpleCrypto::QRsa::savePrivateKey(EVP_PKEY* key, const QByteArray& fileName, QByteArray password, const EVP_CIPHER* cipher)
 {
     try {
-        /* Initialize FILE */
-        FILE* privateKeyFile = fopen(fileName, "w+");
+        /* Initialize BIO. Closed on every path, so errors don't leak file handle */
+        std::unique_ptr<BIO, void (*)(BIO*)> privateKeyFile { BIO_new_file(fileName.constData(), "w+"), BIO_free_all };
         if (!privateKeyFile) {
-            throw std::runtime_error("Couldn't initialize FILE.");
+            throw std::runtime_error("Couldn't initialize privateKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
         /* Write private key to file */
-        if (!PEM_write_PrivateKey(privateKeyFile, key, cipher, reinterpret_cast<unsigned char*>(password.data()), password.size(), nullptr, nullptr)) {
-            throw std::runtime_error("Couldn't save private key. PEM_write_PrivateKey(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        if (!PEM_write_bio_PrivateKey(privateKeyFile.get(), key, cipher, reinterpret_cast<unsigned char*>(password.data()), password.size(), nullptr, nullptr)) {
+            throw std::runtime_error("Couldn't save private key. PEM_write_bio_PrivateKey(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
-
-        /* Close FILE to avoid memory leak */
-        fflush(privateKeyFile);
-        fclose(privateKeyFile);
     } catch (const std::exception& exception) {
         std::throw_with_nested(exception);
     } catch (...) {
@@ -128,32 +260,117 @@ void QSimpleCrypto::QRsa::savePrivateKey(EVP_PKEY* key, const QByteArray& fileNa
 }
 
 ///
-/// \brief QSimpleCrypto::QRsa::getPublicKeyFromFile - Gets RSA public key from a file.
+/// \brief QSimpleCrypto::QRsa::getPublicKeyFromFile - Gets RSA public key from a PEM or DER file.
 /// \param filePath - File path to public key file.
 /// \return Returns 'OpenSSL EVP_PKEY structure' or 'nullptr', if error happened. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
 ///
 EVP_PKEY* QSimpleCrypto::QRsa::getPublicKeyFromFile(const QByteArray& filePath)
 {
     try {
-        /* Initialize read FILE */
-        FILE* publicKeyFile = fopen(filePath, "r");
-        if (!publicKeyFile) {
-            throw std::runtime_error("Couldn't initialize FILE.");
-        }
+        /* Format is recognized from content, so PEM and DER files are both accepted */
+        return getPublicKeyFromBuffer(readFile(filePath));
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::getPrivateKeyFromFile - Gets RSA private key from a PEM or DER file.
+/// \param filePath - File path to private key file.
+/// \param password - Private key password. Used by encrypted PEM and encrypted DER PKCS#8.
+/// \return Returns 'OpenSSL EVP_PKEY structure' or 'nullptr', if error happened. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QRsa::getPrivateKeyFromFile(const QByteArray& filePath, const QByteArray& password)
+{
+    QByteArray data;
+    try {
+        /* Format is recognized from content, so PEM and DER files are both accepted */
+        data = readFile(filePath);
+        EVP_PKEY* keyStore = getPrivateKeyFromBuffer(data, password);
+        OPENSSL_cleanse(data.data(), data.size());
+
+        return keyStore;
+    } catch (const std::exception& exception) {
+        OPENSSL_cleanse(data.data(), data.size());
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
 
-        /* Initialize EVP_PKEY */
+///
+/// \brief QSimpleCrypto::QRsa::getPublicKeyFromBuffer - Gets public key from PEM or DER SubjectPublicKeyInfo in memory.
+/// \param data - Encoded public key. PEM is recognized by "-----BEGIN" prefix, anything else is parsed as DER.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QRsa::getPublicKeyFromBuffer(const QByteArray& data)
+{
+    try {
         EVP_PKEY* keyStore = nullptr;
-        if (!(keyStore = EVP_PKEY_new())) {
-            throw std::runtime_error("Couldn't initialize keyStore. EVP_PKEY_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        if (isPem(data)) {
+            /* Memory BIO reads buffer in place */
+            std::unique_ptr<BIO, void (*)(BIO*)> buffer { BIO_new_mem_buf(data.constData(), data.size()), BIO_free_all };
+            if (!buffer) {
+                throw std::runtime_error("Couldn't initialize buffer. BIO_new_mem_buf(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            keyStore = PEM_read_bio_PUBKEY(buffer.get(), nullptr, nullptr, nullptr);
+        } else {
+            const unsigned char* input = reinterpret_cast<const unsigned char*>(data.constData());
+            keyStore = d2i_PUBKEY(nullptr, &input, data.size());
         }
 
-        /* Write private key to file */
-        if (!PEM_read_PUBKEY(publicKeyFile, &keyStore, nullptr, nullptr)) {
-            throw std::runtime_error("Couldn't read private key. PEM_read_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        if (!keyStore) {
+            throw std::runtime_error("Couldn't read public key. PEM_read_bio_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        /* Close FILE to avoid memory leak */
-        fclose(publicKeyFile);
+        return keyStore;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::getPrivateKeyFromBuffer - Gets private key from PEM or DER in memory.
+/// \param data - Encoded private key. PEM is recognized by "-----BEGIN" prefix, anything else is parsed as DER PKCS#8 or PKCS#1.
+/// \param password - Private key password. Used by encrypted PEM and encrypted DER PKCS#8.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QRsa::getPrivateKeyFromBuffer(const QByteArray& data, const QByteArray& password)
+{
+    try {
+        EVP_PKEY* keyStore = nullptr;
+        if (isPem(data)) {
+            std::unique_ptr<BIO, void (*)(BIO*)> buffer { BIO_new_mem_buf(data.constData(), data.size()), BIO_free_all };
+            if (!buffer) {
+                throw std::runtime_error("Couldn't initialize buffer. BIO_new_mem_buf(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+
+            keyStore = PEM_read_bio_PrivateKey(buffer.get(), nullptr, nullptr, static_cast<void*>(const_cast<char*>(password.constData())));
+        } else {
+            const unsigned char* input = reinterpret_cast<const unsigned char*>(data.constData());
+            keyStore = d2i_AutoPrivateKey(nullptr, &input, data.size());
+
+            /* Encrypted PKCS#8 is not recognized by d2i_AutoPrivateKey, so it is tried next */
+            if (!keyStore && !password.isEmpty()) {
+                ERR_clear_error();
+
+                std::unique_ptr<BIO, void (*)(BIO*)> buffer { BIO_new_mem_buf(data.constData(), data.size()), BIO_free_all };
+                if (!buffer) {
+                    throw std::runtime_error("Couldn't initialize buffer. BIO_new_mem_buf(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+                }
+
+                keyStore = d2i_PKCS8PrivateKey_bio(buffer.get(), nullptr, nullptr, static_cast<void*>(const_cast<char*>(password.constData())));
+            }
+        }
+
+        if (!keyStore) {
+            throw std::runtime_error("Couldn't read private key. PEM_read_bio_PrivateKey(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
 
         return keyStore;
     } catch (const std::exception& exception) {
@@ -164,35 +381,98 @@ EVP_PKEY* QSimpleCrypto::QRsa::getPublicKeyFromFile(const QByteArray& filePath)
 }
 
 ///
-/// \brief QSimpleCrypto::QRsa::getPrivateKeyFromFile - Gets RSA private key from a file.
-/// \param filePath - File path to private key file.
-/// \param password - Private key password.
-/// \return Returns 'OpenSSL EVP_PKEY structure' or 'nullptr', if error happened. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+/// \brief QSimpleCrypto::QRsa::savePublicKeyDer - Saves to file public key in DER SubjectPublicKeyInfo format.
+/// \param key - RSA key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param filePath - Public key file path.
 ///
-EVP_PKEY* QSimpleCrypto::QRsa::getPrivateKeyFromFile(const QByteArray& filePath, const QByteArray& password)
+void QSimpleCrypto::QRsa::savePublicKeyDer(EVP_PKEY* key, const QByteArray& filePath)
+{
+    try {
+        std::unique_ptr<BIO, void (*)(BIO*)> publicKeyFile { BIO_new_file(filePath.constData(), "wb"), BIO_free_all };
+        if (!publicKeyFile) {
+            throw std::runtime_error("Couldn't initialize publicKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        if (!i2d_PUBKEY_bio(publicKeyFile.get(), key)) {
+            throw std::runtime_error("Couldn't save public key. i2d_PUBKEY_bio(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::savePrivateKeyDer - Saves to file private key in DER PKCS#8 format.
+/// \param key - RSA key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param filePath - Private key file path.
+/// \param password - Private key password. If set, key is saved as encrypted PKCS#8.
+/// \param cipher - Cipher of encrypted PKCS#8. 'nullptr' means EVP_aes_256_cbc().
+///
+void QSimpleCrypto::QRsa::savePrivateKeyDer(EVP_PKEY* key, const QByteArray& filePath, const QByteArray& password, const EVP_CIPHER* cipher)
 {
     try {
-        /* Initialize read FILE */
-        FILE* privateKeyFile = fopen(filePath, "r");
+        std::unique_ptr<BIO, void (*)(BIO*)> privateKeyFile { BIO_new_file(filePath.constData(), "wb"), BIO_free_all };
         if (!privateKeyFile) {
-            throw std::runtime_error("Couldn't initialize FILE.");
+            throw std::runtime_error("Couldn't initialize privateKeyFile. BIO_new_file(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        /* Initialize EVP_PKEY */
-        EVP_PKEY* keyStore = nullptr;
-        if (!(keyStore = EVP_PKEY_new())) {
-            throw std::runtime_error("Couldn't initialize keyStore. EVP_PKEY_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        writePrivateKeyDer(privateKeyFile.get(), key, password, cipher);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::publicKeyToDer - Function encodes public key as DER SubjectPublicKeyInfo.
+/// \param key - RSA or any other key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \return Returns DER bytes.
+///
+QByteArray QSimpleCrypto::QRsa::publicKeyToDer(EVP_PKEY* key)
+{
+    try {
+        const qint32 size = i2d_PUBKEY(key, nullptr);
+        if (size <= 0) {
+            throw std::runtime_error("Couldn't determine public key size. i2d_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        /* Write private key to file */
-        if (!PEM_read_PrivateKey(privateKeyFile, &keyStore, nullptr, static_cast<void*>(const_cast<char*>(password.data())))) { /// FIXME: Couldn't read private key. PEM_read_bio_PrivateKey(). Error: error:1E08010C:DECODER routines::unsupported
-            throw std::runtime_error("Couldn't read private key. PEM_read_PrivateKey(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        QByteArray der(size, Qt::Uninitialized);
+        unsigned char* output = reinterpret_cast<unsigned char*>(der.data());
+        if (i2d_PUBKEY(key, &output) != size) {
+            throw std::runtime_error("Couldn't encode public key. i2d_PUBKEY(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
-        /* Close FILE to avoid memory leak */
-        fclose(privateKeyFile);
+        return der;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
 
-        return keyStore;
+///
+/// \brief QSimpleCrypto::QRsa::privateKeyToDer - Function encodes private key as DER PKCS#8.
+/// \param key - RSA or any other key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param password - Private key password. If set, key is encoded as encrypted PKCS#8.
+/// \param cipher - Cipher of encrypted PKCS#8. 'nullptr' means EVP_aes_256_cbc().
+/// \return Returns DER bytes.
+///
+QByteArray QSimpleCrypto::QRsa::privateKeyToDer(EVP_PKEY* key, const QByteArray& password, const EVP_CIPHER* cipher)
+{
+    try {
+        std::unique_ptr<BIO, void (*)(BIO*)> buffer { BIO_new(BIO_s_secmem()), BIO_free_all };
+        if (!buffer) {
+            throw std::runtime_error("Couldn't initialize buffer. BIO_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        writePrivateKeyDer(buffer.get(), key, password, cipher);
+
+        char* data = nullptr;
+        const long size = BIO_get_mem_data(buffer.get(), &data);
+        return QByteArray(data, static_cast<qint32>(size));
     } catch (const std::exception& exception) {
         std::throw_with_nested(exception);
     } catch (...) {
@@ -210,19 +490,19 @@ EVP_PKEY* QSimpleCrypto::QRsa::getPrivateKeyFromFile(const QByteArray& filePath,
 QByteArray QSimpleCrypto::QRsa::encrypt(QByteArray plainText, EVP_PKEY* key, const quint16 padding)
 {
     try {
-        /* Initialize CTX for 'key' */
-        EVP_PKEY_CTX* rsaKeyContext = EVP_PKEY_CTX_new(key, nullptr);
+        /* Initialize CTX for 'key'. Freed on every path, so repeated calls don't leak */
+        std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> rsaKeyContext { EVP_PKEY_CTX_new(key, nullptr), EVP_PKEY_CTX_free };
         if (!rsaKeyContext) {
             throw std::runtime_error("Couldn't initialize EVP_PKEY_CTX. EVP_PKEY_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
         /* Initialize encrypt operation for RSA */
-        if (!EVP_PKEY_encrypt_init(rsaKeyContext)) {
+        if (!EVP_PKEY_encrypt_init(rsaKeyContext.get())) {
             throw std::runtime_error("Couldn't initialize encrypt operation. EVP_PKEY_encrypt_init(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
         /* Set RSA padding for encryption */
-        if (!EVP_PKEY_CTX_set_rsa_padding(rsaKeyContext, padding)) {
+        if (!EVP_PKEY_CTX_set_rsa_padding(rsaKeyContext.get(), padding)) {
             throw std::runtime_error("Couldn't set RSA padding for encrypt operation. EVP_PKEY_CTX_set_rsa_padding(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -232,7 +512,7 @@ QByteArray QSimpleCrypto::QRsa::encrypt(QByteArray plainText, EVP_PKEY* key, con
         /* Determine encrypted buffer length */
         std::size_t encryptedDataLength;
 
-        if (!EVP_PKEY_encrypt(rsaKeyContext, nullptr, &encryptedDataLength, plainData, plainText.size())) {
+        if (!EVP_PKEY_encrypt(rsaKeyContext.get(), nullptr, &encryptedDataLength, plainData, plainText.size())) {
             throw std::runtime_error("Couldn't determine encrypted buffer length. EVP_PKEY_encrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -243,7 +523,7 @@ QByteArray QSimpleCrypto::QRsa::encrypt(QByteArray plainText, EVP_PKEY* key, con
         }
 
         /* Encrypt actual data */
-        if (!EVP_PKEY_encrypt(rsaKeyContext, cipherText.get(), &encryptedDataLength, plainData, plainText.size())) {
+        if (!EVP_PKEY_encrypt(rsaKeyContext.get(), cipherText.get(), &encryptedDataLength, plainData, plainText.size())) {
             throw std::runtime_error("Couldn't encrypt data. EVP_PKEY_encrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -265,19 +545,19 @@ QByteArray QSimpleCrypto::QRsa::encrypt(QByteArray plainText, EVP_PKEY* key, con
 QByteArray QSimpleCrypto::QRsa::decrypt(QByteArray cipherText, EVP_PKEY* key, const quint16 padding)
 {
     try {
-        /* Initialize CTX for 'key' */
-        EVP_PKEY_CTX* rsaKeyContext = EVP_PKEY_CTX_new(key, nullptr);
+        /* Initialize CTX for 'key'. Freed on every path, so repeated calls don't leak */
+        std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> rsaKeyContext { EVP_PKEY_CTX_new(key, nullptr), EVP_PKEY_CTX_free };
         if (!rsaKeyContext) {
             throw std::runtime_error("Couldn't initialize EVP_PKEY_CTX. EVP_PKEY_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
         /* Initialize encrypt operation for RSA */
-        if (!EVP_PKEY_decrypt_init(rsaKeyContext)) {
+        if (!EVP_PKEY_decrypt_init(rsaKeyContext.get())) {
             throw std::runtime_error("Couldn't initialize encrypt operation. EVP_PKEY_encrypt_init(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
         /* Set RSA padding for encryption */
-        if (!EVP_PKEY_CTX_set_rsa_padding(rsaKeyContext, padding)) {
+        if (!EVP_PKEY_CTX_set_rsa_padding(rsaKeyContext.get(), padding)) {
             throw std::runtime_error("Couldn't set RSA padding for encrypt operation. EVP_PKEY_CTX_set_rsa_padding(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -287,7 +567,7 @@ QByteArray QSimpleCrypto::QRsa::decrypt(QByteArray cipherText, EVP_PKEY* key, co
         /* Determine decrypted buffer length */
         std::size_t decryptedDataLength;
 
-        if (!EVP_PKEY_decrypt(rsaKeyContext, nullptr, &decryptedDataLength, cipherTextData, cipherText.size())) {
+        if (!EVP_PKEY_decrypt(rsaKeyContext.get(), nullptr, &decryptedDataLength, cipherTextData, cipherText.size())) {
             throw std::runtime_error("Couldn't determine decrypted buffer length. EVP_PKEY_encrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -298,7 +578,7 @@ QByteArray QSimpleCrypto::QRsa::decrypt(QByteArray cipherText, EVP_PKEY* key, co
         }
 
         /* Encrypt actual data */
-        if (!EVP_PKEY_decrypt(rsaKeyContext, plainText.get(), &decryptedDataLength, cipherTextData, cipherText.size())) {
+        if (!EVP_PKEY_decrypt(rsaKeyContext.get(), plainText.get(), &decryptedDataLength, cipherTextData, cipherText.size())) {
             throw std::runtime_error("Couldn't encrypt data. EVP_PKEY_encrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
         }
 
@@ -309,3 +589,263 @@ QByteArray QSimpleCrypto::QRsa::decrypt(QByteArray cipherText, EVP_PKEY* key, co
         throw;
     }
 }
+
+///
+/// \brief QSimpleCrypto::QRsa::sign - Function hashes data and signs hash with RSA private key.
+/// \param data - Data that will be signed.
+/// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+/// \param md - Hash algorithm (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \return Returns signature.
+///
+QByteArray QSimpleCrypto::QRsa::sign(const QByteArray& data, EVP_PKEY* key, const quint16 padding, const EVP_MD* md)
+{
+    try {
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        const quint32 hashLength = digest(data.constData(), data.size(), md, hash);
+
+        return signDigest(QByteArray(reinterpret_cast<const char*>(hash), hashLength), key, padding, md);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::signDigest - Function signs precomputed hash with RSA private key.
+/// \param digest - Hash of data computed with 'md'.
+/// \param key - RSA private key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+/// \param md - Hash algorithm, that digest was computed with (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \return Returns signature.
+///
+QByteArray QSimpleCrypto::QRsa::signDigest(const QByteArray& digest, EVP_PKEY* key, const quint16 padding, const EVP_MD* md)
+{
+    try {
+        std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> context { QRsaKey::createContext(key, QRsaKey::Operation::Sign, padding, md), EVP_PKEY_CTX_free };
+
+        /* Determine signature length */
+        std::size_t signatureLength = 0;
+        if (EVP_PKEY_sign(context.get(), nullptr, &signatureLength, reinterpret_cast<const unsigned char*>(digest.constData()), digest.size()) <= 0) {
+            throw std::runtime_error("Couldn't determine signature length. EVP_PKEY_sign(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        QByteArray signature(static_cast<qint32>(signatureLength), Qt::Uninitialized);
+        if (EVP_PKEY_sign(context.get(), reinterpret_cast<unsigned char*>(signature.data()), &signatureLength, reinterpret_cast<const unsigned char*>(digest.constData()), digest.size()) <= 0) {
+            throw std::runtime_error("Couldn't sign digest. EVP_PKEY_sign(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        signature.resize(static_cast<qint32>(signatureLength));
+        return signature;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::verify - Function hashes data and verifies signature with RSA public key.
+/// \param data - Signed data.
+/// \param signature - Signature.
+/// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+/// \param md - Hash algorithm (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \return Returns 'true' if signature is valid.
+///
+bool QSimpleCrypto::QRsa::verify(const QByteArray& data, const QByteArray& signature, EVP_PKEY* key, const quint16 padding, const EVP_MD* md)
+{
+    try {
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        const quint32 hashLength = digest(data.constData(), data.size(), md, hash);
+
+        return verifyDigest(QByteArray(reinterpret_cast<const char*>(hash), hashLength), signature, key, padding, md);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::verifyDigest - Function verifies signature of precomputed hash with RSA public key.
+/// \param digest - Hash of signed data computed with 'md'.
+/// \param signature - Signature.
+/// \param key - RSA public key. Must be provided with not null EVP_PKEY OpenSSL struct.
+/// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+/// \param md - Hash algorithm, that digest was computed with (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \return Returns 'true' if signature is valid.
+///
+bool QSimpleCrypto::QRsa::verifyDigest(const QByteArray& digest, const QByteArray& signature, EVP_PKEY* key, const quint16 padding, const EVP_MD* md)
+{
+    try {
+        std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> context { QRsaKey::createContext(key, QRsaKey::Operation::Verify, padding, md), EVP_PKEY_CTX_free };
+
+        /* Invalid signature is a result, not an error, so its reason is not left in error queue */
+        const bool valid = EVP_PKEY_verify(context.get(), reinterpret_cast<const unsigned char*>(signature.constData()), signature.size(),
+                               reinterpret_cast<const unsigned char*>(digest.constData()), digest.size())
+            == 1;
+        if (!valid) {
+            ERR_clear_error();
+        }
+
+        return valid;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::verifyBatch - Function verifies many (message, signature, key) tuples on several threads.
+/// \param messages - Arena with all messages stored one after another.
+/// \param messageOffsets - Offsets of messages in arena. Message 'i' starts at 'messageOffsets[i]' and ends at 'messageOffsets[i + 1]', so size is tuples count plus one.
+/// \param signatures - Arena with all signatures stored one after another.
+/// \param signatureOffsets - Offsets of signatures in arena, in the same format.
+/// \param keys - RSA public key of every tuple. The same key may be used by many tuples. Tuples with null or non RSA key are not valid.
+/// \param padding - OpenSSL RSA padding can be used with: 'RSA_PKCS1_PSS_PADDING' and 'RSA_PKCS1_PADDING'.
+/// \param md - Hash algorithm (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \param threadCount - Number of threads. '0' means QThread::idealThreadCount().
+/// \return Returns bitmap, where bit 'i' is set if signature 'i' is valid.
+///
+QBitArray QSimpleCrypto::QRsa::verifyBatch(const QByteArray& messages, const QVector<qint64>& messageOffsets, const QByteArray& signatures,
+    const QVector<qint64>& signatureOffsets, const QVector<EVP_PKEY*>& keys, const quint16 padding, const EVP_MD* md, const qint32 threadCount)
+{
+    try {
+        if (messageOffsets.isEmpty() || messageOffsets.first() < 0 || messageOffsets.last() > messages.size()) {
+            throw std::runtime_error("Offsets don't describe messages arena.");
+        }
+
+        if (signatureOffsets.isEmpty() || signatureOffsets.first() < 0 || signatureOffsets.last() > signatures.size()) {
+            throw std::runtime_error("Offsets don't describe signatures arena.");
+        }
+
+        const qint64 count = messageOffsets.size() - 1;
+        if (signatureOffsets.size() - 1 != count || keys.size() != count) {
+            throw std::runtime_error("Messages, signatures and keys must have the same count.");
+        }
+
+        for (qint64 i = 0; i < count; ++i) {
+            if (messageOffsets[i + 1] < messageOffsets[i] || signatureOffsets[i + 1] < signatureOffsets[i]) {
+                throw std::runtime_error("Offsets must be non-decreasing.");
+            }
+        }
+
+        /* QBitArray can't be written from several threads, so every tuple gets own byte. Pointer is taken once, so threads never detach array */
+        QByteArray flags(count, 0);
+        char* out = flags.data();
+        const char* messageData = messages.constData();
+        const unsigned char* signatureData = reinterpret_cast<const unsigned char*>(signatures.constData());
+
+        /* One verification costs tens of microseconds, so even short ranges are worth a thread */
+        QBatchRunner::run(count, QBatchRunner::threadCount(threadCount, count, 8), [&](const qint64 begin, const qint64 end) {
+            /* Every range initializes context once for every distinct key */
+            QHash<EVP_PKEY*, EVP_PKEY_CTX*> contexts;
+            std::vector<std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)>> ownedContexts;
+
+            unsigned char hash[EVP_MAX_MD_SIZE];
+            for (qint64 i = begin; i < end; ++i) {
+                /* Null or non RSA key fails only its own tuples. Its context is remembered as 'nullptr' */
+                if (!contexts.contains(keys[i])) {
+                    EVP_PKEY_CTX* created = nullptr;
+                    if (keys[i] && EVP_PKEY_get_base_id(keys[i]) == EVP_PKEY_RSA) {
+                        try {
+                            created = QRsaKey::createContext(keys[i], QRsaKey::Operation::Verify, padding, md);
+                            ownedContexts.emplace_back(created, EVP_PKEY_CTX_free);
+                        } catch (const std::exception&) {
+                        }
+                    }
+
+                    contexts.insert(keys[i], created);
+                }
+
+                EVP_PKEY_CTX* context = contexts.value(keys[i]);
+                if (!context) {
+                    continue;
+                }
+
+                const quint32 hashLength = digest(messageData + messageOffsets[i], messageOffsets[i + 1] - messageOffsets[i], md, hash);
+                out[i] = EVP_PKEY_verify(context, signatureData + signatureOffsets[i], signatureOffsets[i + 1] - signatureOffsets[i], hash, hashLength) == 1;
+            }
+
+            ERR_clear_error();
+        });
+
+        QBitArray result(static_cast<qint32>(count));
+        for (qint64 i = 0; i < count; ++i) {
+            result.setBit(static_cast<qint32>(i), flags.at(static_cast<qint32>(i)));
+        }
+
+        return result;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::writePrivateKeyDer - Function writes private key as DER PKCS#8, encrypted if password is set.
+/// \param output - Output BIO.
+/// \param key - Private key.
+/// \param password - Private key password.
+/// \param cipher - Cipher of encrypted PKCS#8. 'nullptr' means EVP_aes_256_cbc().
+///
+void QSimpleCrypto::QRsa::writePrivateKeyDer(BIO* output, EVP_PKEY* key, const QByteArray& password, const EVP_CIPHER* cipher)
+{
+    /* Password without cipher would write key in clear, so AES-256-CBC with PBKDF2 is used */
+    const EVP_CIPHER* keyCipher = password.isEmpty() ? nullptr : (cipher ? cipher : EVP_aes_256_cbc());
+    if (!i2d_PKCS8PrivateKey_bio(output, key, keyCipher, password.isEmpty() ? nullptr : const_cast<char*>(password.constData()), password.size(), nullptr, nullptr)) {
+        throw std::runtime_error("Couldn't save private key. i2d_PKCS8PrivateKey_bio(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::readFile - Function reads whole key file.
+/// \param filePath - File path.
+/// \return Returns file content.
+///
+QByteArray QSimpleCrypto::QRsa::readFile(const QByteArray& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Couldn't open key file. QFile::open(). Error: " + file.errorString().toUtf8());
+    }
+
+    return file.readAll();
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::isPem - Function checks, if encoded key is PEM.
+/// \param data - Encoded key.
+/// \return Returns 'true' if data starts with PEM boundary, leading whitespace is skipped.
+///
+bool QSimpleCrypto::QRsa::isPem(const QByteArray& data)
+{
+    qint32 position = 0;
+    while (position < data.size() && (data.at(position) == ' ' || data.at(position) == '\t' || data.at(position) == '\r' || data.at(position) == '\n')) {
+        ++position;
+    }
+
+    return data.mid(position, 10) == "-----BEGIN";
+}
+
+///
+/// \brief QSimpleCrypto::QRsa::digest - Function hashes data.
+/// \param data - Pointer to data.
+/// \param size - Size of data.
+/// \param md - Hash algorithm.
+/// \param output - Output buffer with at least EVP_MAX_MD_SIZE bytes.
+/// \return Returns hash size.
+///
+quint32 QSimpleCrypto::QRsa::digest(const char* data, const qint64 size, const EVP_MD* md, unsigned char* output)
+{
+    quint32 outputLength = 0;
+    if (!EVP_Digest(data, size, output, &outputLength, md, nullptr)) {
+        throw std::runtime_error("Couldn't compute hash. EVP_Digest(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    return outputLength;
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QRsaKey.h"
+
+#include <functional>
+
+///
+/// \brief QSimpleCrypto::QRsaKey::QRsaKey - Takes ownership of key and prepares template contexts.
+/// \param key - RSA key. Must be provided with not null EVP_PKEY OpenSSL struct. Freed by handle.
+/// \param encryptionPadding - OpenSSL RSA padding for encryption: 'RSA_PKCS1_OAEP_PADDING', 'RSA_PKCS1_PADDING' or 'RSA_NO_PADDING'.
+/// \param md - Hash algorithm for OAEP and signatures (OpenSSL EVP_MD). Example: EVP_sha256().
+/// \param signaturePadding - OpenSSL RSA padding for signatures: 'RSA_PKCS1_PSS_PADDING' or 'RSA_PKCS1_PADDING'.
+/// \details If constructor throws, key is not taken and must be freed by caller.
+///
+QSimpleCrypto::QRsaKey::QRsaKey(EVP_PKEY* key, const qint32 encryptionPadding, const EVP_MD* md, const qint32 signaturePadding)
+    : m_md(md)
+    , m_shards(new Shard[rsaKeyPoolShards])
+{
+    try {
+        if (!key || EVP_PKEY_get_base_id(key) != EVP_PKEY_RSA) {
+            throw std::runtime_error("Key must be RSA key.");
+        }
+
+        m_templates[static_cast<qint32>(Operation::Encrypt)].reset(createContext(key, Operation::Encrypt, encryptionPadding, md));
+        m_templates[static_cast<qint32>(Operation::Decrypt)].reset(createContext(key, Operation::Decrypt, encryptionPadding, md));
+        m_templates[static_cast<qint32>(Operation::Sign)].reset(createContext(key, Operation::Sign, signaturePadding, md));
+        m_templates[static_cast<qint32>(Operation::Verify)].reset(createContext(key, Operation::Verify, signaturePadding, md));
+
+        /* Ownership is taken only when handle is ready, so caller still owns key if constructor throws */
+        m_key.reset(key);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::~QRsaKey - Frees pooled contexts and key. No call may be running.
+///
+QSimpleCrypto::QRsaKey::~QRsaKey()
+{
+    for (qint32 i = 0; i < rsaKeyPoolShards; ++i) {
+        for (auto& idle : m_shards[i].idle) {
+            for (EVP_PKEY_CTX* context : idle) {
+                EVP_PKEY_CTX_free(context);
+            }
+        }
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::key - Function returns owned key.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Stays owned by handle.
+///
+EVP_PKEY* QSimpleCrypto::QRsaKey::key() const
+{
+    return m_key.get();
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::size - Function returns size of modulus, cipher text and signature.
+/// \return Returns size in bytes.
+///
+qint32 QSimpleCrypto::QRsaKey::size() const
+{
+    return EVP_PKEY_get_size(m_key.get());
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::encrypt - Function encrypts data with public key.
+/// \param plainText - Data that will be encrypted. Size is limited by key size and padding.
+/// \return Returns encrypted data.
+///
+QByteArray QSimpleCrypto::QRsaKey::encrypt(const QByteArray& plainText) const
+{
+    try {
+        Lease context(this, Operation::Encrypt);
+
+        /* Cipher text always has modulus size, so length query is skipped */
+        QByteArray cipherText(size(), Qt::Uninitialized);
+        std::size_t cipherTextLength = cipherText.size();
+
+        if (EVP_PKEY_encrypt(context.get(), reinterpret_cast<unsigned char*>(cipherText.data()), &cipherTextLength,
+                reinterpret_cast<const unsigned char*>(plainText.constData()), plainText.size())
+            <= 0) {
+            throw std::runtime_error("Couldn't encrypt data. EVP_PKEY_encrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        cipherText.resize(static_cast<qint32>(cipherTextLength));
+        return cipherText;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::decrypt - Function decrypts data with private key.
+/// \param cipherText - Data that will be decrypted.
+/// \return Returns decrypted data.
+///
+QByteArray QSimpleCrypto::QRsaKey::decrypt(const QByteArray& cipherText) const
+{
+    try {
+        Lease context(this, Operation::Decrypt);
+
+        QByteArray plainText(size(), Qt::Uninitialized);
+        std::size_t plainTextLength = plainText.size();
+
+        if (EVP_PKEY_decrypt(context.get(), reinterpret_cast<unsigned char*>(plainText.data()), &plainTextLength,
+                reinterpret_cast<const unsigned char*>(cipherText.constData()), cipherText.size())
+            <= 0) {
+            throw std::runtime_error("Couldn't decrypt data. EVP_PKEY_decrypt(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        plainText.resize(static_cast<qint32>(plainTextLength));
+        return plainText;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::sign - Function hashes data and signs hash with private key.
+/// \param data - Data that will be signed.
+/// \return Returns signature.
+///
+QByteArray QSimpleCrypto::QRsaKey::sign(const QByteArray& data) const
+{
+    return signDigest(digest(data));
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::signDigest - Function signs hash, that was already computed with key hash algorithm.
+/// \param digest - Hash of data.
+/// \return Returns signature.
+///
+QByteArray QSimpleCrypto::QRsaKey::signDigest(const QByteArray& digest) const
+{
+    try {
+        Lease context(this, Operation::Sign);
+
+        QByteArray signature(size(), Qt::Uninitialized);
+        std::size_t signatureLength = signature.size();
+
+        if (EVP_PKEY_sign(context.get(), reinterpret_cast<unsigned char*>(signature.data()), &signatureLength,
+                reinterpret_cast<const unsigned char*>(digest.constData()), digest.size())
+            <= 0) {
+            throw std::runtime_error("Couldn't sign data. EVP_PKEY_sign(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        signature.resize(static_cast<qint32>(signatureLength));
+        return signature;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::verify - Function hashes data and verifies signature with public key.
+/// \param data - Signed data.
+/// \param signature - Signature.
+/// \return Returns 'true' if signature is valid.
+///
+bool QSimpleCrypto::QRsaKey::verify(const QByteArray& data, const QByteArray& signature) const
+{
+    return verifyDigest(digest(data), signature);
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::verifyDigest - Function verifies signature of hash, that was already computed with key hash algorithm.
+/// \param digest - Hash of signed data.
+/// \param signature - Signature.
+/// \return Returns 'true' if signature is valid.
+///
+bool QSimpleCrypto::QRsaKey::verifyDigest(const QByteArray& digest, const QByteArray& signature) const
+{
+    try {
+        Lease context(this, Operation::Verify);
+
+        /* Malformed signature is reported as error, but for caller it is just invalid signature */
+        const bool valid = EVP_PKEY_verify(context.get(), reinterpret_cast<const unsigned char*>(signature.constData()), signature.size(),
+                               reinterpret_cast<const unsigned char*>(digest.constData()), digest.size())
+            == 1;
+
+        if (!valid) {
+            ERR_clear_error();
+        }
+
+        return valid;
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::Lease::Lease - Borrows context from pool.
+/// \param owner - Key handle.
+/// \param operation - Operation.
+///
+QSimpleCrypto::QRsaKey::Lease::Lease(const QRsaKey* owner, const Operation operation)
+    : m_owner(owner)
+    , m_operation(operation)
+    , m_context(owner->borrow(operation))
+{
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::Lease::~Lease - Gives context back to pool.
+///
+QSimpleCrypto::QRsaKey::Lease::~Lease()
+{
+    m_owner->release(m_operation, m_context);
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::borrow - Function takes idle context from shard of calling thread, or copies template.
+/// \param operation - Operation.
+/// \return Returns ready context.
+///
+EVP_PKEY_CTX* QSimpleCrypto::QRsaKey::borrow(const Operation operation) const
+{
+    {
+        Shard& current = shard();
+        std::lock_guard<std::mutex> lock(current.mutex);
+
+        auto& idle = current.idle[static_cast<qint32>(operation)];
+        if (!idle.empty()) {
+            EVP_PKEY_CTX* context = idle.back();
+            idle.pop_back();
+
+            return context;
+        }
+    }
+
+    /* Copy keeps initialized operation, padding and hash */
+    EVP_PKEY_CTX* context = EVP_PKEY_CTX_dup(m_templates[static_cast<qint32>(operation)].get());
+    if (!context) {
+        throw std::runtime_error("Couldn't copy EVP_PKEY_CTX. EVP_PKEY_CTX_dup(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    return context;
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::release - Function puts context back to shard of calling thread, or frees it when shard is full.
+/// \param operation - Operation.
+/// \param context - Context returned by borrow().
+///
+void QSimpleCrypto::QRsaKey::release(const Operation operation, EVP_PKEY_CTX* context) const
+{
+    {
+        Shard& current = shard();
+        std::lock_guard<std::mutex> lock(current.mutex);
+
+        auto& idle = current.idle[static_cast<qint32>(operation)];
+        if (idle.size() < rsaKeyPoolShardSize) {
+            idle.push_back(context);
+            return;
+        }
+    }
+
+    EVP_PKEY_CTX_free(context);
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::shard - Function returns shard of calling thread.
+/// \return Returns shard.
+///
+QSimpleCrypto::QRsaKey::Shard& QSimpleCrypto::QRsaKey::shard() const
+{
+    /* Thread ids are often aligned addresses, so they are mixed before low bits are taken */
+    const quint64 id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return m_shards[((id * Q_UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (rsaKeyPoolShards - 1)];
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::digest - Function hashes data with key hash algorithm.
+/// \param data - Data.
+/// \return Returns hash.
+///
+QByteArray QSimpleCrypto::QRsaKey::digest(const QByteArray& data) const
+{
+    QByteArray hash(EVP_MAX_MD_SIZE, Qt::Uninitialized);
+    quint32 hashLength = 0;
+
+    if (!EVP_Digest(data.constData(), data.size(), reinterpret_cast<unsigned char*>(hash.data()), &hashLength, m_md, nullptr)) {
+        throw std::runtime_error("Couldn't hash data. EVP_Digest(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    hash.resize(static_cast<qint32>(hashLength));
+    return hash;
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKey::createContext - Function creates context with initialized operation, padding and hash.
+/// \param key - RSA key.
+/// \param operation - Operation.
+/// \param padding - OpenSSL RSA padding.
+/// \param md - Hash algorithm for OAEP and signatures.
+/// \return Returns context. Must be cleaned up with 'EVP_PKEY_CTX_free()'.
+///
+EVP_PKEY_CTX* QSimpleCrypto::QRsaKey::createContext(EVP_PKEY* key, const Operation operation, const qint32 padding, const EVP_MD* md)
+{
+    if (!key) {
+        throw std::runtime_error("RSA key must be provided.");
+    }
+
+    std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> context { EVP_PKEY_CTX_new(key, nullptr), EVP_PKEY_CTX_free };
+    if (!context) {
+        throw std::runtime_error("Couldn't initialize EVP_PKEY_CTX. EVP_PKEY_CTX_new(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    /* Initialize operation once. Pooled copies of templates keep it */
+    qint32 initialized = 0;
+    switch (operation) {
+    case Operation::Encrypt:
+        initialized = EVP_PKEY_encrypt_init(context.get());
+        break;
+    case Operation::Decrypt:
+        initialized = EVP_PKEY_decrypt_init(context.get());
+        break;
+    case Operation::Sign:
+        initialized = EVP_PKEY_sign_init(context.get());
+        break;
+    case Operation::Verify:
+        initialized = EVP_PKEY_verify_init(context.get());
+        break;
+    }
+
+    if (initialized <= 0) {
+        throw std::runtime_error("Couldn't initialize RSA operation. EVP_PKEY_*_init(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    if (EVP_PKEY_CTX_set_rsa_padding(context.get(), padding) <= 0) {
+        throw std::runtime_error("Couldn't set RSA padding. EVP_PKEY_CTX_set_rsa_padding(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+    }
+
+    if (operation == Operation::Encrypt || operation == Operation::Decrypt) {
+        /* OAEP label hash and MGF1 hash are both 'md' */
+        if (padding == RSA_PKCS1_OAEP_PADDING && EVP_PKEY_CTX_set_rsa_oaep_md(context.get(), md) <= 0) {
+            throw std::runtime_error("Couldn't set OAEP hash. EVP_PKEY_CTX_set_rsa_oaep_md(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    } else {
+        if (EVP_PKEY_CTX_set_signature_md(context.get(), md) <= 0) {
+            throw std::runtime_error("Couldn't set signature hash. EVP_PKEY_CTX_set_signature_md(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+
+        /* Signatures use salt of hash length. Verification accepts any salt length, as other implementations choose differently */
+        const qint32 saltLength = operation == Operation::Sign ? RSA_PSS_SALTLEN_DIGEST : RSA_PSS_SALTLEN_AUTO;
+        if (padding == RSA_PKCS1_PSS_PADDING && EVP_PKEY_CTX_set_rsa_pss_saltlen(context.get(), saltLength) <= 0) {
+            throw std::runtime_error("Couldn't set PSS salt length. EVP_PKEY_CTX_set_rsa_pss_saltlen(). Error: " + QByteArray(ERR_error_string(ERR_get_error(), nullptr)));
+        }
+    }
+
+    return context.release();
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2023 BrutalWizard (https://github.com/bru74lw1z4rd). All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License"). You may not use
+ * this file except in compliance with the License. You can obtain a copy
+ * in the file LICENSE in the source distribution
+ */
+
+#include "include/QRsaKeyPool.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_LINUX)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+///
+/// \brief lowerThreadPriority - Function lowers scheduling priority of calling thread, so key generation yields to request threads.
+///
+void lowerThreadPriority()
+{
+#if defined(Q_OS_WIN)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(Q_OS_LINUX)
+    /* On Linux nice value belongs to thread, not to process */
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+} // namespace
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::QRsaKeyPool - Starts worker threads with lowered priority.
+/// \param targetSize - Number of ready keys, that pool keeps for every (bits, exponent).
+/// \param lowWatermark - Number of ready keys, at which refill starts. Must be lower than target size.
+/// \param workerCount - Number of worker threads. '0' means QThread::idealThreadCount().
+///
+QSimpleCrypto::QRsaKeyPool::QRsaKeyPool(const qint32 targetSize, const qint32 lowWatermark, const qint32 workerCount)
+    : m_targetSize(targetSize)
+    , m_lowWatermark(lowWatermark)
+{
+    try {
+        if (targetSize < 1 || lowWatermark < 0 || lowWatermark >= targetSize) {
+            throw std::runtime_error("Low watermark must be lower than target size.");
+        }
+
+        const qint32 workers = workerCount > 0 ? workerCount : qMax(1, QThread::idealThreadCount());
+        for (qint32 i = 0; i < workers; ++i) {
+            m_workers.emplace_back(&QRsaKeyPool::work, this);
+        }
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::~QRsaKeyPool - Waits for generations in progress and frees ready keys.
+///
+QSimpleCrypto::QRsaKeyPool::~QRsaKeyPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+
+    for (auto& entry : m_entries) {
+        for (EVP_PKEY* key : entry.second.keys) {
+            EVP_PKEY_free(key);
+        }
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::reserve - Function starts filling pool with keys of given size, so first take() doesn't wait for generation.
+/// \param bits - RSA key size. For example: 2048, 4096.
+/// \param exponent - Public exponent. For example: 65537.
+///
+void QSimpleCrypto::QRsaKeyPool::reserve(const quint32 bits, const quint64 exponent)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry& keys = entry(bits, exponent);
+        if (static_cast<qint64>(keys.keys.size()) + keys.generating < m_targetSize) {
+            keys.refilling = true;
+        }
+    }
+    m_condition.notify_all();
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::take - Function hands out ready key pair, or generates it on calling thread when pool is empty.
+/// \param bits - RSA key size. For example: 2048, 4096.
+/// \param exponent - Public exponent. For example: 65537.
+/// \return Returns 'OpenSSL EVP_PKEY structure'. Returned value must be cleaned up with 'EVP_PKEY_free()' to avoid memory leak.
+///
+EVP_PKEY* QSimpleCrypto::QRsaKeyPool::take(const quint32 bits, const quint64 exponent)
+{
+    try {
+        EVP_PKEY* key = nullptr;
+        bool refill = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Entry& keys = entry(bits, exponent);
+
+            /* Oldest key is handed out first, so no key stays in memory for long */
+            if (!keys.keys.empty()) {
+                key = keys.keys.front();
+                keys.keys.pop_front();
+                ++m_hits;
+            } else {
+                ++m_misses;
+            }
+
+            if (!keys.refilling && static_cast<qint64>(keys.keys.size()) <= m_lowWatermark) {
+                keys.refilling = true;
+                refill = true;
+            }
+        }
+
+        if (refill) {
+            m_condition.notify_all();
+        }
+
+        /* Empty pool means workers fall behind demand. Caller pays for generation, but is never queued behind other callers */
+        return key ? key : QRsa().generateRsaKeys(bits, exponent);
+    } catch (const std::exception& exception) {
+        std::throw_with_nested(exception);
+    } catch (...) {
+        throw;
+    }
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::available - Function returns number of ready keys of given size.
+/// \param bits - RSA key size.
+/// \param exponent - Public exponent.
+/// \return Returns number of ready keys.
+///
+qint64 QSimpleCrypto::QRsaKeyPool::available(const quint32 bits, const quint64 exponent) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto found = m_entries.find(std::make_pair(bits, exponent));
+    return found == m_entries.end() ? 0 : static_cast<qint64>(found->second.keys.size());
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::metrics - Function returns number of ready keys and counters.
+/// \return Returns metrics snapshot.
+///
+QSimpleCrypto::QRsaKeyPool::Metrics QSimpleCrypto::QRsaKeyPool::metrics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Metrics metrics;
+    for (const auto& entry : m_entries) {
+        metrics.available += static_cast<qint64>(entry.second.keys.size());
+        metrics.generating += entry.second.generating;
+    }
+    metrics.hits = m_hits;
+    metrics.misses = m_misses;
+    metrics.generated = m_generated;
+    metrics.failures = m_failures;
+
+    return metrics;
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::entry - Function returns entry of given size, creating it if needed. Must be called with m_mutex locked.
+/// \param bits - RSA key size.
+/// \param exponent - Public exponent.
+/// \return Returns entry.
+///
+QSimpleCrypto::QRsaKeyPool::Entry& QSimpleCrypto::QRsaKeyPool::entry(const quint32 bits, const quint64 exponent)
+{
+    return m_entries[std::make_pair(bits, exponent)];
+}
+
+///
+/// \brief QSimpleCrypto::QRsaKeyPool::work - Worker thread function.
+///
+void QSimpleCrypto::QRsaKeyPool::work()
+{
+    lowerThreadPriority();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        /* Size with fewest ready keys goes first, so one slow 4096 bit refill doesn't starve others */
+        std::pair<quint32, quint64> size;
+        Entry* next = nullptr;
+        m_condition.wait(lock, [&] {
+            next = nullptr;
+            for (auto& entry : m_entries) {
+                const qint64 planned = static_cast<qint64>(entry.second.keys.size()) + entry.second.generating;
+                if (entry.second.refilling && planned < m_targetSize
+                    && (!next || planned < static_cast<qint64>(next->keys.size()) + next->generating)) {
+                    size = entry.first;
+                    next = &entry.second;
+                }
+            }
+
+            return m_stopped || next;
+        });
+
+        if (m_stopped) {
+            return;
+        }
+
+        ++next->generating;
+        lock.unlock();
+
+        EVP_PKEY* key = nullptr;
+        try {
+            key = QRsa().generateRsaKeys(size.first, size.second);
+        } catch (...) {
+            key = nullptr;
+        }
+
+        lock.lock();
+        --next->generating;
+
+        /* Failure is reported by take(), that generates on calling thread. Refill is retried at next low watermark */
+        if (!key) {
+            ++m_failures;
+            next->refilling = false;
+            continue;
+        }
+
+        next->keys.push_back(key);
+        ++m_generated;
+        if (static_cast<qint64>(next->keys.size()) >= m_targetSize) {
+            next->refilling = false;
+        }
+    }
+}